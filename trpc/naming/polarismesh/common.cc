@@ -13,6 +13,7 @@
 
 #include "trpc/naming/polarismesh/common.h"
 
+#include <cstdlib>
 #include <iostream>
 #include <sstream>
 #include <string>
@@ -97,4 +98,20 @@ polaris::CallRetStatus FrameworkRetToPolarisRet(ReadersWriterData<std::set<int>>
   }
 }
 
+ExcludedInstances ParseExcludedInstances(const std::string& value) {
+  ExcludedInstances excluded;
+  std::size_t begin = 0;
+  while (begin < value.size()) {
+    std::size_t end = value.find(',', begin);
+    if (end == std::string::npos) {
+      end = value.size();
+    }
+    if (end > begin) {
+      excluded.Add(std::strtoull(value.c_str() + begin, nullptr, 10));
+    }
+    begin = end + 1;
+  }
+  return excluded;
+}
+
 }  // namespace trpc
@@ -13,6 +13,8 @@
 
 #pragma once
 
+#include <array>
+#include <functional>
 #include <map>
 #include <memory>
 #include <string>
@@ -126,6 +128,16 @@ inline void ConvertInstancesNoIsolated(const std::vector<polaris::Instance>& ins
   }
 }
 
+/// @brief Get the stable id of an instance converted by ConvertPolarisInstance, the address is used if the meta
+///        information is not filled
+inline std::string GetEndpointInstanceId(const TrpcEndpointInfo& endpoint) {
+  auto iter = endpoint.meta.find("instance_id");
+  if (iter != endpoint.meta.end()) {
+    return iter->second;
+  }
+  return endpoint.host + ":" + std::to_string(endpoint.port);
+}
+
 /// @brief Obtain the key corresponding to the key from Metadata
 /// @param[in] metadata data set
 /// @param[in] key key
@@ -254,6 +266,14 @@ inline bool ServiceKeyEqual(const polaris::ServiceKey& service_key1, const polar
   return false;
 }
 
+/// @brief The hash of the serviceKey, by which the service keys are looked up in the hash maps
+struct ServiceKeyHash {
+  std::size_t operator()(const polaris::ServiceKey& service_key) const {
+    std::size_t seed = std::hash<std::string>()(service_key.namespace_);
+    return seed ^ (std::hash<std::string>()(service_key.name_) + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+  }
+};
+
 /// @brief Integrate all information in config into config.orig_selector_config
 ///        Follow -up can construct the Context of the Arctic SDK through Orig_selector_config
 /// @param config polarismesh plug -in configuration
@@ -266,4 +286,41 @@ void SetPolarisMeshSelectorConf(trpc::naming::PolarisMeshNamingConfig& config);
 /// @return polarismesh::CallRetStatus polarismesh melting error code
 polaris::CallRetStatus FrameworkRetToPolarisRet(ReadersWriterData<std::set<int>>& whitelist, int framework_ret);
 
+/// @brief The instances excluded from the selection of a request (e.g. the instances failed in the previous tries),
+///        kept as a small fixed-size array of the local ids of the instances
+struct ExcludedInstances {
+  static constexpr std::size_t kMaxSize = 4;
+
+  std::array<uint64_t, kMaxSize> local_ids{};
+  std::size_t size{0};
+
+  bool Empty() const { return size == 0; }
+
+  bool Contains(uint64_t local_id) const {
+    for (std::size_t i = 0; i < size; ++i) {
+      if (local_ids[i] == local_id) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /// @brief Add an instance, the earliest one is dropped if the array is full
+  void Add(uint64_t local_id) {
+    if (Contains(local_id)) {
+      return;
+    }
+    if (size == kMaxSize) {
+      for (std::size_t i = 1; i < kMaxSize; ++i) {
+        local_ids[i - 1] = local_ids[i];
+      }
+      --size;
+    }
+    local_ids[size++] = local_id;
+  }
+};
+
+/// @brief Parse the excluded instances from the comma separated local ids, the last ones are kept if there are too many
+ExcludedInstances ParseExcludedInstances(const std::string& value);
+
 }  // namespace trpc
@@ -99,6 +99,16 @@ TEST(ServiceKeyTest, Compare) {
   ASSERT_EQ(false, ServiceKeyEqual(service_key1, service_key2));
 }
 
+TEST(ServiceKeyTest, Hash) {
+  polaris::ServiceKey service_key1 = {"Test", "service1"};
+  polaris::ServiceKey service_key2 = {"Test", "service2"};
+  polaris::ServiceKey service_key3 = {"Testservice1", ""};
+  ServiceKeyHash hash;
+  ASSERT_EQ(hash(service_key1), hash(polaris::ServiceKey{"Test", "service1"}));
+  ASSERT_NE(hash(service_key1), hash(service_key2));
+  ASSERT_NE(hash(service_key1), hash(service_key3));
+}
+
 TEST(SetPolarisMeshSelectorConfTest, Run) {
   int ret = TrpcConfig::GetInstance()->Init("./trpc/naming/polarismesh/testing/polarismesh_test.yaml");
   ASSERT_EQ(0, ret);
@@ -133,6 +143,32 @@ TEST(FrameworkRetToPolarisRet, Convert) {
             polaris::CallRetStatus::kCallRetOk);
 }
 
+TEST(ExcludedInstances, AddAndParse) {
+  ExcludedInstances excluded;
+  ASSERT_TRUE(excluded.Empty());
+  excluded.Add(1);
+  excluded.Add(2);
+  excluded.Add(2);
+  ASSERT_EQ(2, excluded.size);
+  ASSERT_TRUE(excluded.Contains(1));
+  ASSERT_FALSE(excluded.Contains(3));
+
+  // The earliest one is dropped if the array is full
+  for (uint64_t local_id = 3; local_id <= 5; ++local_id) {
+    excluded.Add(local_id);
+  }
+  ASSERT_EQ(ExcludedInstances::kMaxSize, excluded.size);
+  ASSERT_FALSE(excluded.Contains(1));
+  ASSERT_TRUE(excluded.Contains(5));
+
+  ExcludedInstances parsed = ParseExcludedInstances("7,,8,9,10,11");
+  ASSERT_EQ(ExcludedInstances::kMaxSize, parsed.size);
+  ASSERT_FALSE(parsed.Contains(7));
+  ASSERT_TRUE(parsed.Contains(8));
+  ASSERT_TRUE(parsed.Contains(11));
+  ASSERT_TRUE(ParseExcludedInstances("").Empty());
+}
+
 }  // namespace trpc
 
 int main(int argc, char** argv) {
@@ -28,11 +28,56 @@ void ServiceConfig::Display() const {
   TRPC_LOG_DEBUG("--------------------------------");
 }
 
+void LoadReportConfig::Display() const {
+  TRPC_LOG_DEBUG("--------------------------------");
+
+  TRPC_LOG_DEBUG("enable:" << enable);
+  TRPC_LOG_DEBUG("sample_interval:" << sample_interval);
+  TRPC_LOG_DEBUG("publish_interval:" << publish_interval);
+  TRPC_LOG_DEBUG("smoothing:" << smoothing);
+  TRPC_LOG_DEBUG("min_weight:" << min_weight);
+  TRPC_LOG_DEBUG("change_threshold:" << change_threshold);
+  TRPC_LOG_DEBUG("max_cpu:" << max_cpu);
+  TRPC_LOG_DEBUG("max_inflight:" << max_inflight);
+  TRPC_LOG_DEBUG("max_queue_size:" << max_queue_size);
+  TRPC_LOG_DEBUG("max_qps:" << max_qps);
+
+  TRPC_LOG_DEBUG("--------------------------------");
+}
+
+void OverloadProtectConfig::Display() const {
+  TRPC_LOG_DEBUG("--------------------------------");
+
+  TRPC_LOG_DEBUG("enable:" << enable);
+  TRPC_LOG_DEBUG("window:" << window);
+  TRPC_LOG_DEBUG("min_requests:" << min_requests);
+  TRPC_LOG_DEBUG("reject_rate:" << reject_rate);
+  TRPC_LOG_DEBUG("max_queue_size:" << max_queue_size);
+  TRPC_LOG_DEBUG("recover_percent:" << recover_percent);
+  TRPC_LOG_DEBUG("recover_windows:" << recover_windows);
+  TRPC_LOG_DEBUG("overload_weight:" << overload_weight);
+  TRPC_LOG_DEBUG("isolate:" << isolate);
+
+  TRPC_LOG_DEBUG("--------------------------------");
+}
+
 void RegistryConfig::Display() const {
   TRPC_LOG_DEBUG("--------------------------------");
 
   TRPC_LOG_DEBUG("heartbeat_interval:" << heartbeat_interval);
   TRPC_LOG_DEBUG("heartbeat_timeout:" << heartbeat_timeout);
+  TRPC_LOG_DEBUG("coalesce_heartbeat:" << coalesce_heartbeat);
+  TRPC_LOG_DEBUG("heartbeat_jitter:" << heartbeat_jitter);
+  TRPC_LOG_DEBUG("heartbeat_backoff_limit:" << heartbeat_backoff_limit);
+  TRPC_LOG_DEBUG("drain_delay:" << drain_delay);
+  TRPC_LOG_DEBUG("drain_timeout:" << drain_timeout);
+  TRPC_LOG_DEBUG("metadata_update_delay:" << metadata_update_delay);
+  TRPC_LOG_DEBUG("metadata_update_max_delay:" << metadata_update_max_delay);
+  TRPC_LOG_DEBUG("register_retry:" << register_retry);
+  TRPC_LOG_DEBUG("register_retry_min_interval:" << register_retry_min_interval);
+  TRPC_LOG_DEBUG("register_retry_max_interval:" << register_retry_max_interval);
+  load_report_config.Display();
+  overload_protect_config.Display();
   for (auto& item : services_config) {
     item.Display();
   }
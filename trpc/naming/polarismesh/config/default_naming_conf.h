@@ -30,9 +30,83 @@ struct ServiceConfig {
   void Display() const;
 };
 
+/// @brief The configuration of reporting the load of the server by the weights of its instances
+struct LoadReportConfig {
+  bool enable{false};
+  /// The interval to sample the load, unit: ms
+  uint64_t sample_interval{1000};
+  /// The min interval to publish the weights, unit: ms
+  uint64_t publish_interval{30000};
+  /// The smoothing factor of the weights, the larger the faster to follow the load
+  float smoothing{0.3};
+  /// The min weight of an instance, in percent of its registered weight
+  uint32_t min_weight{10};
+  /// The weights are published only if they change by more than the threshold, in percent of the registered weights
+  uint32_t change_threshold{10};
+  /// The cpu usage at which the server is saturated, in percent of all the cores
+  uint32_t max_cpu{80};
+  /// The in-flight requests at which the server is saturated, not sampled if it is 0
+  uint64_t max_inflight{0};
+  /// The request queue size at which the server is saturated, not sampled if it is 0
+  uint64_t max_queue_size{0};
+  /// The qps at which the server is saturated, not sampled if it is 0
+  uint64_t max_qps{0};
+
+  void Display() const;
+};
+
+/// @brief The configuration of lowering the weights of the instances when the server is overloaded
+struct OverloadProtectConfig {
+  bool enable{false};
+  /// The window to evaluate the overload, unit: ms
+  uint64_t window{1000};
+  /// The min requests in a window to evaluate the rejection rate of the limiter
+  uint64_t min_requests{20};
+  /// The rejection rate of the limiter at which the server is overloaded, in percent
+  uint32_t reject_rate{20};
+  /// The request queue size at which the server is overloaded, not evaluated if it is 0
+  uint64_t max_queue_size{0};
+  /// The server recovers when the signals fall below the percent of the overload thresholds
+  uint32_t recover_percent{50};
+  /// The consecutive windows below the recover thresholds to restore the weights
+  uint32_t recover_windows{3};
+  /// The weights of the overloaded instances, in percent of their registered weights
+  uint32_t overload_weight{10};
+  /// Whether to isolate the overloaded instances by setting their weights to 0, otherwise their weights are kept at
+  /// least 1. When all the instances of a service are overloaded together, e.g. by a traffic spike, the isolated
+  /// service gets no traffic at all
+  bool isolate{false};
+
+  void Display() const;
+};
+
 struct RegistryConfig {
   uint64_t heartbeat_interval{3000};
   uint64_t heartbeat_timeout{2000};
+  /// Whether to send the heartbeats of all the registered instances on one timer of the plugin, the heartbeat calls of
+  /// the framework only add the instances to the timer
+  bool coalesce_heartbeat{false};
+  /// The random jitter of the heartbeat interval of an instance, in percent of the interval
+  uint32_t heartbeat_jitter{10};
+  /// The max heartbeat interval of an instance backed off by the failed heartbeats, in percent of the TTL of the
+  /// instance. The heartbeats are not backed off if it is not greater than the heartbeat interval
+  uint32_t heartbeat_backoff_limit{80};
+  /// The time to wait for the callers to refresh a draining instance whose weight is set to 0, unit: ms
+  uint64_t drain_delay{10000};
+  /// The max time to wait for the in-flight requests of a draining instance after the drain delay, unit: ms
+  uint64_t drain_timeout{30000};
+  /// The time to wait for more metadata changes of an instance before updating it, unit: ms
+  uint64_t metadata_update_delay{1000};
+  /// The max time to delay the metadata update of an instance which keeps changing, unit: ms
+  uint64_t metadata_update_max_delay{5000};
+  /// Whether to retry the failed registrations in the background until they succeed or the instances are deregistered
+  bool register_retry{false};
+  /// The interval to retry a failed registration, which doubles on each failure, unit: ms
+  uint64_t register_retry_min_interval{1000};
+  /// The max interval to retry a failed registration, unit: ms
+  uint64_t register_retry_max_interval{30000};
+  LoadReportConfig load_report_config;
+  OverloadProtectConfig overload_protect_config;
   std::vector<ServiceConfig> services_config;
 
   void Display() const;
@@ -85,6 +159,146 @@ struct convert<trpc::naming::ServiceConfig> {
   }
 };
 
+template <>
+struct convert<trpc::naming::LoadReportConfig> {
+  static YAML::Node encode(const trpc::naming::LoadReportConfig& config) {
+    YAML::Node node;
+
+    node["enable"] = config.enable;
+
+    node["sample_interval"] = config.sample_interval;
+
+    node["publish_interval"] = config.publish_interval;
+
+    node["smoothing"] = config.smoothing;
+
+    node["min_weight"] = config.min_weight;
+
+    node["change_threshold"] = config.change_threshold;
+
+    node["max_cpu"] = config.max_cpu;
+
+    node["max_inflight"] = config.max_inflight;
+
+    node["max_queue_size"] = config.max_queue_size;
+
+    node["max_qps"] = config.max_qps;
+
+    return node;
+  }
+
+  static bool decode(const YAML::Node& node, trpc::naming::LoadReportConfig& config) {
+    if (node["enable"]) {
+      config.enable = node["enable"].as<bool>();
+    }
+
+    if (node["sample_interval"]) {
+      config.sample_interval = node["sample_interval"].as<uint64_t>();
+    }
+
+    if (node["publish_interval"]) {
+      config.publish_interval = node["publish_interval"].as<uint64_t>();
+    }
+
+    if (node["smoothing"]) {
+      config.smoothing = node["smoothing"].as<float>();
+    }
+
+    if (node["min_weight"]) {
+      config.min_weight = node["min_weight"].as<uint32_t>();
+    }
+
+    if (node["change_threshold"]) {
+      config.change_threshold = node["change_threshold"].as<uint32_t>();
+    }
+
+    if (node["max_cpu"]) {
+      config.max_cpu = node["max_cpu"].as<uint32_t>();
+    }
+
+    if (node["max_inflight"]) {
+      config.max_inflight = node["max_inflight"].as<uint64_t>();
+    }
+
+    if (node["max_queue_size"]) {
+      config.max_queue_size = node["max_queue_size"].as<uint64_t>();
+    }
+
+    if (node["max_qps"]) {
+      config.max_qps = node["max_qps"].as<uint64_t>();
+    }
+
+    return true;
+  }
+};
+
+template <>
+struct convert<trpc::naming::OverloadProtectConfig> {
+  static YAML::Node encode(const trpc::naming::OverloadProtectConfig& config) {
+    YAML::Node node;
+
+    node["enable"] = config.enable;
+
+    node["window"] = config.window;
+
+    node["min_requests"] = config.min_requests;
+
+    node["reject_rate"] = config.reject_rate;
+
+    node["max_queue_size"] = config.max_queue_size;
+
+    node["recover_percent"] = config.recover_percent;
+
+    node["recover_windows"] = config.recover_windows;
+
+    node["overload_weight"] = config.overload_weight;
+
+    node["isolate"] = config.isolate;
+
+    return node;
+  }
+
+  static bool decode(const YAML::Node& node, trpc::naming::OverloadProtectConfig& config) {
+    if (node["enable"]) {
+      config.enable = node["enable"].as<bool>();
+    }
+
+    if (node["window"]) {
+      config.window = node["window"].as<uint64_t>();
+    }
+
+    if (node["min_requests"]) {
+      config.min_requests = node["min_requests"].as<uint64_t>();
+    }
+
+    if (node["reject_rate"]) {
+      config.reject_rate = node["reject_rate"].as<uint32_t>();
+    }
+
+    if (node["max_queue_size"]) {
+      config.max_queue_size = node["max_queue_size"].as<uint64_t>();
+    }
+
+    if (node["recover_percent"]) {
+      config.recover_percent = node["recover_percent"].as<uint32_t>();
+    }
+
+    if (node["recover_windows"]) {
+      config.recover_windows = node["recover_windows"].as<uint32_t>();
+    }
+
+    if (node["overload_weight"]) {
+      config.overload_weight = node["overload_weight"].as<uint32_t>();
+    }
+
+    if (node["isolate"]) {
+      config.isolate = node["isolate"].as<bool>();
+    }
+
+    return true;
+  }
+};
+
 template <>
 struct convert<trpc::naming::RegistryConfig> {
   static YAML::Node encode(const trpc::naming::RegistryConfig& config) {
@@ -94,6 +308,30 @@ struct convert<trpc::naming::RegistryConfig> {
 
     node["heartbeat_timeout"] = config.heartbeat_timeout;
 
+    node["coalesce_heartbeat"] = config.coalesce_heartbeat;
+
+    node["heartbeat_jitter"] = config.heartbeat_jitter;
+
+    node["heartbeat_backoff_limit"] = config.heartbeat_backoff_limit;
+
+    node["drain_delay"] = config.drain_delay;
+
+    node["drain_timeout"] = config.drain_timeout;
+
+    node["metadata_update_delay"] = config.metadata_update_delay;
+
+    node["metadata_update_max_delay"] = config.metadata_update_max_delay;
+
+    node["register_retry"] = config.register_retry;
+
+    node["register_retry_min_interval"] = config.register_retry_min_interval;
+
+    node["register_retry_max_interval"] = config.register_retry_max_interval;
+
+    node["load_report"] = config.load_report_config;
+
+    node["overload_protect"] = config.overload_protect_config;
+
     node["service"] = config.services_config;
 
     return node;
@@ -108,6 +346,54 @@ struct convert<trpc::naming::RegistryConfig> {
       config.heartbeat_timeout = node["heartbeat_timeout"].as<uint64_t>();
     }
 
+    if (node["coalesce_heartbeat"]) {
+      config.coalesce_heartbeat = node["coalesce_heartbeat"].as<bool>();
+    }
+
+    if (node["heartbeat_jitter"]) {
+      config.heartbeat_jitter = node["heartbeat_jitter"].as<uint32_t>();
+    }
+
+    if (node["heartbeat_backoff_limit"]) {
+      config.heartbeat_backoff_limit = node["heartbeat_backoff_limit"].as<uint32_t>();
+    }
+
+    if (node["drain_delay"]) {
+      config.drain_delay = node["drain_delay"].as<uint64_t>();
+    }
+
+    if (node["drain_timeout"]) {
+      config.drain_timeout = node["drain_timeout"].as<uint64_t>();
+    }
+
+    if (node["metadata_update_delay"]) {
+      config.metadata_update_delay = node["metadata_update_delay"].as<uint64_t>();
+    }
+
+    if (node["metadata_update_max_delay"]) {
+      config.metadata_update_max_delay = node["metadata_update_max_delay"].as<uint64_t>();
+    }
+
+    if (node["register_retry"]) {
+      config.register_retry = node["register_retry"].as<bool>();
+    }
+
+    if (node["register_retry_min_interval"]) {
+      config.register_retry_min_interval = node["register_retry_min_interval"].as<uint64_t>();
+    }
+
+    if (node["register_retry_max_interval"]) {
+      config.register_retry_max_interval = node["register_retry_max_interval"].as<uint64_t>();
+    }
+
+    if (node["load_report"]) {
+      config.load_report_config = node["load_report"].as<trpc::naming::LoadReportConfig>();
+    }
+
+    if (node["overload_protect"]) {
+      config.overload_protect_config = node["overload_protect"].as<trpc::naming::OverloadProtectConfig>();
+    }
+
     if (node["service"]) {
       config.services_config = node["service"].as<std::vector<trpc::naming::ServiceConfig>>();
     }
@@ -32,6 +32,35 @@ TEST(DefaultNamingConfTest, default_naming_conf_test) {
   naming::RegistryConfig registry_config;
   registry_config.heartbeat_interval = 3333;
   registry_config.heartbeat_timeout = 2222;
+  registry_config.coalesce_heartbeat = true;
+  registry_config.heartbeat_jitter = 20;
+  registry_config.heartbeat_backoff_limit = 60;
+  registry_config.drain_delay = 5555;
+  registry_config.drain_timeout = 6666;
+  registry_config.metadata_update_delay = 7777;
+  registry_config.metadata_update_max_delay = 8888;
+  registry_config.register_retry = true;
+  registry_config.register_retry_min_interval = 500;
+  registry_config.register_retry_max_interval = 9999;
+  registry_config.load_report_config.enable = true;
+  registry_config.load_report_config.sample_interval = 2000;
+  registry_config.load_report_config.publish_interval = 20000;
+  registry_config.load_report_config.smoothing = 0.5;
+  registry_config.load_report_config.min_weight = 20;
+  registry_config.load_report_config.change_threshold = 5;
+  registry_config.load_report_config.max_cpu = 70;
+  registry_config.load_report_config.max_inflight = 100;
+  registry_config.load_report_config.max_queue_size = 200;
+  registry_config.load_report_config.max_qps = 1000;
+  registry_config.overload_protect_config.enable = true;
+  registry_config.overload_protect_config.window = 2000;
+  registry_config.overload_protect_config.min_requests = 50;
+  registry_config.overload_protect_config.reject_rate = 30;
+  registry_config.overload_protect_config.max_queue_size = 100;
+  registry_config.overload_protect_config.recover_percent = 40;
+  registry_config.overload_protect_config.recover_windows = 5;
+  registry_config.overload_protect_config.overload_weight = 20;
+  registry_config.overload_protect_config.isolate = true;
   registry_config.services_config.push_back(service_config);
   registry_config.Display();
 
@@ -44,6 +73,35 @@ TEST(DefaultNamingConfTest, default_naming_conf_test) {
   tmp.Display();
   ASSERT_EQ(registry_config.heartbeat_interval, tmp.heartbeat_interval);
   ASSERT_EQ(registry_config.heartbeat_timeout, tmp.heartbeat_timeout);
+  ASSERT_EQ(registry_config.coalesce_heartbeat, tmp.coalesce_heartbeat);
+  ASSERT_EQ(registry_config.heartbeat_jitter, tmp.heartbeat_jitter);
+  ASSERT_EQ(registry_config.heartbeat_backoff_limit, tmp.heartbeat_backoff_limit);
+  ASSERT_EQ(registry_config.drain_delay, tmp.drain_delay);
+  ASSERT_EQ(registry_config.drain_timeout, tmp.drain_timeout);
+  ASSERT_EQ(registry_config.metadata_update_delay, tmp.metadata_update_delay);
+  ASSERT_EQ(registry_config.metadata_update_max_delay, tmp.metadata_update_max_delay);
+  ASSERT_EQ(registry_config.register_retry, tmp.register_retry);
+  ASSERT_EQ(registry_config.register_retry_min_interval, tmp.register_retry_min_interval);
+  ASSERT_EQ(registry_config.register_retry_max_interval, tmp.register_retry_max_interval);
+  ASSERT_EQ(registry_config.load_report_config.enable, tmp.load_report_config.enable);
+  ASSERT_EQ(registry_config.load_report_config.sample_interval, tmp.load_report_config.sample_interval);
+  ASSERT_EQ(registry_config.load_report_config.publish_interval, tmp.load_report_config.publish_interval);
+  ASSERT_FLOAT_EQ(registry_config.load_report_config.smoothing, tmp.load_report_config.smoothing);
+  ASSERT_EQ(registry_config.load_report_config.min_weight, tmp.load_report_config.min_weight);
+  ASSERT_EQ(registry_config.load_report_config.change_threshold, tmp.load_report_config.change_threshold);
+  ASSERT_EQ(registry_config.load_report_config.max_cpu, tmp.load_report_config.max_cpu);
+  ASSERT_EQ(registry_config.load_report_config.max_inflight, tmp.load_report_config.max_inflight);
+  ASSERT_EQ(registry_config.load_report_config.max_queue_size, tmp.load_report_config.max_queue_size);
+  ASSERT_EQ(registry_config.load_report_config.max_qps, tmp.load_report_config.max_qps);
+  ASSERT_EQ(registry_config.overload_protect_config.enable, tmp.overload_protect_config.enable);
+  ASSERT_EQ(registry_config.overload_protect_config.window, tmp.overload_protect_config.window);
+  ASSERT_EQ(registry_config.overload_protect_config.min_requests, tmp.overload_protect_config.min_requests);
+  ASSERT_EQ(registry_config.overload_protect_config.reject_rate, tmp.overload_protect_config.reject_rate);
+  ASSERT_EQ(registry_config.overload_protect_config.max_queue_size, tmp.overload_protect_config.max_queue_size);
+  ASSERT_EQ(registry_config.overload_protect_config.recover_percent, tmp.overload_protect_config.recover_percent);
+  ASSERT_EQ(registry_config.overload_protect_config.recover_windows, tmp.overload_protect_config.recover_windows);
+  ASSERT_EQ(registry_config.overload_protect_config.overload_weight, tmp.overload_protect_config.overload_weight);
+  ASSERT_EQ(registry_config.overload_protect_config.isolate, tmp.overload_protect_config.isolate);
   ASSERT_EQ(1, tmp.services_config.size());
   ASSERT_EQ(service_config.name, tmp.services_config[0].name);
   ASSERT_EQ(service_config.namespace_, tmp.services_config[0].namespace_);
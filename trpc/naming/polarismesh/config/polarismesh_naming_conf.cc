@@ -233,12 +233,115 @@ void DynamicWeightConfig::Display() const {
   TRPC_LOG_DEBUG("open_dynamic_weight:" << open_dynamic_weight);
 }
 
+void SlowStartConfig::Display() const {
+  TRPC_LOG_DEBUG("---------------SlowStartConfig begin-----------------");
+  TRPC_LOG_DEBUG("enable:" << enable);
+  TRPC_LOG_DEBUG("window:" << window);
+  TRPC_LOG_DEBUG("min_weight_percent:" << min_weight_percent);
+  TRPC_LOG_DEBUG("curve:" << curve);
+}
+
+void FlapDampingConfig::Display() const {
+  TRPC_LOG_DEBUG("---------------FlapDampingConfig begin-----------------");
+  TRPC_LOG_DEBUG("enable:" << enable);
+  TRPC_LOG_DEBUG("up_delay:" << up_delay);
+  TRPC_LOG_DEBUG("down_delay:" << down_delay);
+  TRPC_LOG_DEBUG("min_dwell:" << min_dwell);
+  TRPC_LOG_DEBUG("churn_budget:" << churn_budget);
+  TRPC_LOG_DEBUG("churn_window:" << churn_window);
+}
+
+void SubsetConfig::Display() const {
+  TRPC_LOG_DEBUG("---------------SubsetConfig begin-----------------");
+  TRPC_LOG_DEBUG("enable:" << enable);
+  TRPC_LOG_DEBUG("subset_size:" << subset_size);
+  TRPC_LOG_DEBUG("client_id:" << client_id);
+}
+
+void HedgingConfig::Display() const {
+  TRPC_LOG_DEBUG("---------------HedgingConfig begin-----------------");
+  TRPC_LOG_DEBUG("enable:" << enable);
+  TRPC_LOG_DEBUG("percentile:" << percentile);
+  TRPC_LOG_DEBUG("min_samples:" << min_samples);
+  TRPC_LOG_DEBUG("min_delay:" << min_delay);
+  TRPC_LOG_DEBUG("max_delay:" << max_delay);
+  TRPC_LOG_DEBUG("window:" << window);
+  TRPC_LOG_DEBUG("prefer_other_zone:" << prefer_other_zone);
+}
+
+void LocalityBreakerConfig::Display() const {
+  TRPC_LOG_DEBUG("---------------LocalityBreakerConfig begin-----------------");
+  TRPC_LOG_DEBUG("enable:" << enable);
+  TRPC_LOG_DEBUG("error_rate_threshold:" << error_rate_threshold);
+  TRPC_LOG_DEBUG("min_requests:" << min_requests);
+  TRPC_LOG_DEBUG("window:" << window);
+  TRPC_LOG_DEBUG("sleep_window:" << sleep_window);
+  TRPC_LOG_DEBUG("half_open_requests:" << half_open_requests);
+}
+
+void LatencyRouterConfig::Display() const {
+  TRPC_LOG_DEBUG("---------------LatencyRouterConfig begin-----------------");
+  TRPC_LOG_DEBUG("enable:" << enable);
+  TRPC_LOG_DEBUG("hysteresis:" << hysteresis);
+  TRPC_LOG_DEBUG("min_samples:" << min_samples);
+  TRPC_LOG_DEBUG("expire:" << expire);
+  TRPC_LOG_DEBUG("min_healthy_instances:" << min_healthy_instances);
+  TRPC_LOG_DEBUG("probe_ratio:" << probe_ratio);
+}
+
+void SpilloverConfig::Display() const {
+  TRPC_LOG_DEBUG("---------------SpilloverConfig begin-----------------");
+  TRPC_LOG_DEBUG("enable:" << enable);
+  TRPC_LOG_DEBUG("tolerance:" << tolerance);
+  TRPC_LOG_DEBUG("min_inflight:" << min_inflight);
+  TRPC_LOG_DEBUG("max_ratio:" << max_ratio);
+}
+
+void ConcurrencyLimitConfig::Display() const {
+  TRPC_LOG_DEBUG("---------------ConcurrencyLimitConfig begin-----------------");
+  TRPC_LOG_DEBUG("enable:" << enable);
+  TRPC_LOG_DEBUG("initial_limit:" << initial_limit);
+  TRPC_LOG_DEBUG("min_limit:" << min_limit);
+  TRPC_LOG_DEBUG("max_limit:" << max_limit);
+  TRPC_LOG_DEBUG("smoothing:" << smoothing);
+  TRPC_LOG_DEBUG("long_window:" << long_window);
+}
+
+void RetryBudgetConfig::Display() const {
+  TRPC_LOG_DEBUG("---------------RetryBudgetConfig begin-----------------");
+  TRPC_LOG_DEBUG("enable:" << enable);
+  TRPC_LOG_DEBUG("ratio:" << ratio);
+  TRPC_LOG_DEBUG("max_tokens:" << max_tokens);
+  TRPC_LOG_DEBUG("metrics_name:" << metrics_name);
+}
+
+void AdaptiveTimeoutConfig::Display() const {
+  TRPC_LOG_DEBUG("---------------AdaptiveTimeoutConfig begin-----------------");
+  TRPC_LOG_DEBUG("enable:" << enable);
+  TRPC_LOG_DEBUG("apply_timeout:" << apply_timeout);
+  TRPC_LOG_DEBUG("percentile:" << percentile);
+  TRPC_LOG_DEBUG("factor:" << factor);
+  TRPC_LOG_DEBUG("min_samples:" << min_samples);
+  TRPC_LOG_DEBUG("min_timeout:" << min_timeout);
+  TRPC_LOG_DEBUG("window:" << window);
+}
+
 void SelectorConfig::Display() const {
   TRPC_LOG_DEBUG("--------------------------------");
 
   global_config.Display();
   consumer_config.Display();
   dynamic_weight_config.Display();
+  slow_start_config.Display();
+  flap_damping_config.Display();
+  subset_config.Display();
+  hedging_config.Display();
+  locality_breaker_config.Display();
+  latency_router_config.Display();
+  spillover_config.Display();
+  concurrency_limit_config.Display();
+  retry_budget_config.Display();
+  adaptive_timeout_config.Display();
 
   TRPC_LOG_DEBUG("--------------------------------");
 }
@@ -259,11 +259,209 @@ struct DynamicWeightConfig {
   void Display() const;
 };
 
+// Slow start configuration of the plugin side load balancing, the weight of a newly discovered instance ramps up from
+// a floor to its full weight in the window
+struct SlowStartConfig {
+  // Whether to enable slow start
+  bool enable{false};
+  // The slow start window after an instance is discovered, unit: ms
+  uint64_t window{60000};
+  // The effective weight at the beginning of the window, as a percentage of the instance weight
+  uint32_t min_weight_percent{10};
+  // The curve of the weight ramp: "linear" or "exponential"
+  std::string curve{"linear"};
+
+  // Print information
+  void Display() const;
+};
+
+// Flap damping configuration of the instance availability changes seen by the framework, all times are in ms
+struct FlapDampingConfig {
+  // Whether to enable flap damping
+  bool enable{false};
+  // How long an instance must stay available before it is published as available
+  uint64_t up_delay{10000};
+  // How long an instance must stay unavailable before it is published as unavailable
+  uint64_t down_delay{3000};
+  // The minimum time between two published changes of one instance
+  uint64_t min_dwell{30000};
+  // The maximum published changes of one service in the churn window, 0 means unlimited
+  uint32_t churn_budget{0};
+  // The window of the churn budget
+  uint64_t churn_window{60000};
+
+  // Print information
+  void Display() const;
+};
+
+// Client side subsetting configuration, each client connects to a stable subset of the instances of a callee service
+struct SubsetConfig {
+  // Whether to enable subsetting
+  bool enable{false};
+  // The number of the instances in the subset
+  uint32_t subset_size{100};
+  // The identity of the client to pick the subset. If it is empty, the local ip, the server name and the pid are used.
+  // A sequential number (e.g. the ordinal of the client) balances the subsets exactly
+  std::string client_id;
+
+  // Print information
+  void Display() const;
+};
+
+// Hedging configuration of the selector filter: a backup request is sent to another instance if the request does not
+// return in the delay, which is the observed latency percentile of the callee service
+struct HedgingConfig {
+  // Whether to enable hedging
+  bool enable{false};
+  // The latency percentile used as the hedging delay, range: 1-99
+  uint32_t percentile{95};
+  // The minimum latency samples of a service in the window before hedging its requests
+  uint64_t min_samples{100};
+  // The bounds of the hedging delay, unit: ms
+  uint64_t min_delay{5};
+  uint64_t max_delay{1000};
+  // The window of the latency samples, unit: ms
+  uint64_t window{60000};
+  // Whether to prefer the backup instance in another zone than the first instance
+  bool prefer_other_zone{true};
+
+  // Print information
+  void Display() const;
+};
+
+// Circuit breaking configuration of the localities (zones and sets) of the callee services, the call results are
+// aggregated per locality on the plugin side, and the selection fails over to the next nearby level when the whole
+// locality is broken
+struct LocalityBreakerConfig {
+  // Whether to enable the circuit breaking of the localities
+  bool enable{false};
+  // The error rate to break a locality, unit: percent
+  uint32_t error_rate_threshold{50};
+  // The minimum requests of a locality in the window to break it
+  uint64_t min_requests{20};
+  // The window of the call results, unit: ms
+  uint64_t window{10000};
+  // How long a broken locality is skipped before it is tried again, unit: ms
+  uint64_t sleep_window{30000};
+  // The probe requests admitted to a half-open locality after the sleep window, which close it if all of them succeed.
+  // 0 means the locality is closed right after the sleep window
+  uint64_t half_open_requests{10};
+
+  // Print information
+  void Display() const;
+};
+
+// Latency-aware routing configuration, the instances are routed to the locality (region, zone and campus) with the
+// lowest measured latency within the max match level of the nearby router, instead of the static location labels
+struct LatencyRouterConfig {
+  // Whether to enable the latency-aware routing
+  bool enable{false};
+  // The routed locality is switched only if another one is faster by this ratio, unit: percent
+  uint32_t hysteresis{20};
+  // The minimum latency samples of a locality before its latency is trusted
+  uint64_t min_samples{10};
+  // The latency of a locality expires if it has no samples for this long, unit: ms
+  uint64_t expire{60000};
+  // The minimum healthy instances of a locality to route to it
+  uint32_t min_healthy_instances{1};
+  // The ratio of the requests sent to the other localities to measure their latency, unit: percent
+  uint32_t probe_ratio{1};
+
+  // Print information
+  void Display() const;
+};
+
+// Cross-zone spillover configuration, a part of the requests is spilled over from the local zone to the other zones
+// when the local instances are more loaded, so that the load per instance is kept even
+struct SpilloverConfig {
+  // Whether to enable the cross-zone spillover
+  bool enable{false};
+  // The local zone is preferred until its load per instance exceeds the other zones by this ratio, unit: percent
+  uint32_t tolerance{20};
+  // The minimum in-flight requests per local instance before spilling over
+  uint32_t min_inflight{2};
+  // The maximum ratio of the requests spilled over, unit: percent
+  uint32_t max_ratio{50};
+
+  // Print information
+  void Display() const;
+};
+
+// Adaptive concurrency limit configuration of the callee instances, the limit of each instance is learned from the
+// latency changes by the gradient of the long-term and the current latency, the instances at their limit are skipped
+// by the selection
+struct ConcurrencyLimitConfig {
+  // Whether to enable the adaptive concurrency limits
+  bool enable{false};
+  // The initial concurrency limit of an instance
+  uint32_t initial_limit{20};
+  // The minimum concurrency limit of an instance
+  uint32_t min_limit{1};
+  // The maximum concurrency limit of an instance
+  uint32_t max_limit{200};
+  // The weight of a new limit in the smoothed limit, unit: percent
+  uint32_t smoothing{20};
+  // The number of samples of the long-term latency average
+  uint32_t long_window{600};
+
+  // Print information
+  void Display() const;
+};
+
+// Retry budget configuration of the callee services, each successful call deposits a ratio of a token into the
+// budget of the service, and each retry or sent backup request withdraws one, the retries are rejected locally once the
+// budget is spent
+struct RetryBudgetConfig {
+  // Whether to enable the retry budget
+  bool enable{false};
+  // The ratio of the retries to the successful calls, unit: percent
+  uint32_t ratio{10};
+  // The maximum tokens of a service, which is also the initial tokens
+  uint32_t max_tokens{10};
+  // The name of the metrics plugin to report the budget state to, not reported if empty
+  std::string metrics_name;
+
+  // Print information
+  void Display() const;
+};
+
+// Adaptive timeout configuration, the latency of each method of the callee services is observed to recommend the
+// request timeout, which is the latency percentile times a factor and capped by the static timeout
+struct AdaptiveTimeoutConfig {
+  // Whether to observe the latency and recommend the timeout
+  bool enable{false};
+  // Whether the selector filter sets the recommended timeout to the requests
+  bool apply_timeout{false};
+  // The latency percentile of the recommended timeout, range: 1-99
+  uint32_t percentile{99};
+  // The factor of the latency percentile, unit: percent
+  uint32_t factor{200};
+  // The minimum latency samples of a method in the window before recommending the timeout
+  uint64_t min_samples{100};
+  // The minimum recommended timeout, unit: ms
+  uint64_t min_timeout{10};
+  // The window of the latency samples, unit: ms
+  uint64_t window{60000};
+
+  // Print information
+  void Display() const;
+};
+
 // Route Select Configuration
 struct SelectorConfig {
   GlobalConfig global_config;
   ConsumerConfig consumer_config;
   DynamicWeightConfig dynamic_weight_config;
+  SlowStartConfig slow_start_config;
+  FlapDampingConfig flap_damping_config;
+  SubsetConfig subset_config;
+  HedgingConfig hedging_config;
+  LocalityBreakerConfig locality_breaker_config;
+  LatencyRouterConfig latency_router_config;
+  SpilloverConfig spillover_config;
+  ConcurrencyLimitConfig concurrency_limit_config;
+  RetryBudgetConfig retry_budget_config;
+  AdaptiveTimeoutConfig adaptive_timeout_config;
 
   // Print information
   void Display() const;
@@ -730,6 +928,454 @@ struct convert<trpc::naming::DynamicWeightConfig> {
   }
 };
 
+template <>
+struct convert<trpc::naming::SlowStartConfig> {
+  static YAML::Node encode(const trpc::naming::SlowStartConfig& config) {
+    YAML::Node node;
+
+    node["enable"] = config.enable;
+
+    node["window"] = config.window;
+
+    node["minWeightPercent"] = config.min_weight_percent;
+
+    node["curve"] = config.curve;
+
+    return node;
+  }
+
+  static bool decode(const YAML::Node& node, trpc::naming::SlowStartConfig& config) {
+    if (node["enable"]) {
+      config.enable = node["enable"].as<bool>();
+    }
+
+    if (node["window"]) {
+      config.window = node["window"].as<uint64_t>();
+    }
+
+    if (node["minWeightPercent"]) {
+      config.min_weight_percent = node["minWeightPercent"].as<uint32_t>();
+    }
+
+    if (node["curve"]) {
+      config.curve = node["curve"].as<std::string>();
+    }
+
+    return true;
+  }
+};
+
+template <>
+struct convert<trpc::naming::FlapDampingConfig> {
+  static YAML::Node encode(const trpc::naming::FlapDampingConfig& config) {
+    YAML::Node node;
+
+    node["enable"] = config.enable;
+
+    node["upDelay"] = config.up_delay;
+
+    node["downDelay"] = config.down_delay;
+
+    node["minDwell"] = config.min_dwell;
+
+    node["churnBudget"] = config.churn_budget;
+
+    node["churnWindow"] = config.churn_window;
+
+    return node;
+  }
+
+  static bool decode(const YAML::Node& node, trpc::naming::FlapDampingConfig& config) {
+    if (node["enable"]) {
+      config.enable = node["enable"].as<bool>();
+    }
+
+    if (node["upDelay"]) {
+      config.up_delay = node["upDelay"].as<uint64_t>();
+    }
+
+    if (node["downDelay"]) {
+      config.down_delay = node["downDelay"].as<uint64_t>();
+    }
+
+    if (node["minDwell"]) {
+      config.min_dwell = node["minDwell"].as<uint64_t>();
+    }
+
+    if (node["churnBudget"]) {
+      config.churn_budget = node["churnBudget"].as<uint32_t>();
+    }
+
+    if (node["churnWindow"]) {
+      config.churn_window = node["churnWindow"].as<uint64_t>();
+    }
+
+    return true;
+  }
+};
+
+template <>
+struct convert<trpc::naming::SubsetConfig> {
+  static YAML::Node encode(const trpc::naming::SubsetConfig& config) {
+    YAML::Node node;
+
+    node["enable"] = config.enable;
+
+    node["subsetSize"] = config.subset_size;
+
+    node["clientId"] = config.client_id;
+
+    return node;
+  }
+
+  static bool decode(const YAML::Node& node, trpc::naming::SubsetConfig& config) {
+    if (node["enable"]) {
+      config.enable = node["enable"].as<bool>();
+    }
+
+    if (node["subsetSize"]) {
+      config.subset_size = node["subsetSize"].as<uint32_t>();
+    }
+
+    if (node["clientId"]) {
+      config.client_id = node["clientId"].as<std::string>();
+    }
+
+    return true;
+  }
+};
+
+template <>
+struct convert<trpc::naming::HedgingConfig> {
+  static YAML::Node encode(const trpc::naming::HedgingConfig& config) {
+    YAML::Node node;
+
+    node["enable"] = config.enable;
+
+    node["percentile"] = config.percentile;
+
+    node["minSamples"] = config.min_samples;
+
+    node["minDelay"] = config.min_delay;
+
+    node["maxDelay"] = config.max_delay;
+
+    node["window"] = config.window;
+
+    node["preferOtherZone"] = config.prefer_other_zone;
+
+    return node;
+  }
+
+  static bool decode(const YAML::Node& node, trpc::naming::HedgingConfig& config) {
+    if (node["enable"]) {
+      config.enable = node["enable"].as<bool>();
+    }
+
+    if (node["percentile"]) {
+      config.percentile = node["percentile"].as<uint32_t>();
+    }
+
+    if (node["minSamples"]) {
+      config.min_samples = node["minSamples"].as<uint64_t>();
+    }
+
+    if (node["minDelay"]) {
+      config.min_delay = node["minDelay"].as<uint64_t>();
+    }
+
+    if (node["maxDelay"]) {
+      config.max_delay = node["maxDelay"].as<uint64_t>();
+    }
+
+    if (node["window"]) {
+      config.window = node["window"].as<uint64_t>();
+    }
+
+    if (node["preferOtherZone"]) {
+      config.prefer_other_zone = node["preferOtherZone"].as<bool>();
+    }
+
+    return true;
+  }
+};
+
+template <>
+struct convert<trpc::naming::LocalityBreakerConfig> {
+  static YAML::Node encode(const trpc::naming::LocalityBreakerConfig& config) {
+    YAML::Node node;
+
+    node["enable"] = config.enable;
+
+    node["errorRateThreshold"] = config.error_rate_threshold;
+
+    node["minRequests"] = config.min_requests;
+
+    node["window"] = config.window;
+
+    node["sleepWindow"] = config.sleep_window;
+
+    node["halfOpenRequests"] = config.half_open_requests;
+
+    return node;
+  }
+
+  static bool decode(const YAML::Node& node, trpc::naming::LocalityBreakerConfig& config) {
+    if (node["enable"]) {
+      config.enable = node["enable"].as<bool>();
+    }
+
+    if (node["errorRateThreshold"]) {
+      config.error_rate_threshold = node["errorRateThreshold"].as<uint32_t>();
+    }
+
+    if (node["minRequests"]) {
+      config.min_requests = node["minRequests"].as<uint64_t>();
+    }
+
+    if (node["window"]) {
+      config.window = node["window"].as<uint64_t>();
+    }
+
+    if (node["sleepWindow"]) {
+      config.sleep_window = node["sleepWindow"].as<uint64_t>();
+    }
+
+    if (node["halfOpenRequests"]) {
+      config.half_open_requests = node["halfOpenRequests"].as<uint64_t>();
+    }
+
+    return true;
+  }
+};
+
+template <>
+struct convert<trpc::naming::LatencyRouterConfig> {
+  static YAML::Node encode(const trpc::naming::LatencyRouterConfig& config) {
+    YAML::Node node;
+
+    node["enable"] = config.enable;
+
+    node["hysteresis"] = config.hysteresis;
+
+    node["minSamples"] = config.min_samples;
+
+    node["expire"] = config.expire;
+
+    node["minHealthyInstances"] = config.min_healthy_instances;
+
+    node["probeRatio"] = config.probe_ratio;
+
+    return node;
+  }
+
+  static bool decode(const YAML::Node& node, trpc::naming::LatencyRouterConfig& config) {
+    if (node["enable"]) {
+      config.enable = node["enable"].as<bool>();
+    }
+
+    if (node["hysteresis"]) {
+      config.hysteresis = node["hysteresis"].as<uint32_t>();
+    }
+
+    if (node["minSamples"]) {
+      config.min_samples = node["minSamples"].as<uint64_t>();
+    }
+
+    if (node["expire"]) {
+      config.expire = node["expire"].as<uint64_t>();
+    }
+
+    if (node["minHealthyInstances"]) {
+      config.min_healthy_instances = node["minHealthyInstances"].as<uint32_t>();
+    }
+
+    if (node["probeRatio"]) {
+      config.probe_ratio = node["probeRatio"].as<uint32_t>();
+    }
+
+    return true;
+  }
+};
+
+template <>
+struct convert<trpc::naming::SpilloverConfig> {
+  static YAML::Node encode(const trpc::naming::SpilloverConfig& config) {
+    YAML::Node node;
+
+    node["enable"] = config.enable;
+
+    node["tolerance"] = config.tolerance;
+
+    node["minInflight"] = config.min_inflight;
+
+    node["maxRatio"] = config.max_ratio;
+
+    return node;
+  }
+
+  static bool decode(const YAML::Node& node, trpc::naming::SpilloverConfig& config) {
+    if (node["enable"]) {
+      config.enable = node["enable"].as<bool>();
+    }
+
+    if (node["tolerance"]) {
+      config.tolerance = node["tolerance"].as<uint32_t>();
+    }
+
+    if (node["minInflight"]) {
+      config.min_inflight = node["minInflight"].as<uint32_t>();
+    }
+
+    if (node["maxRatio"]) {
+      config.max_ratio = node["maxRatio"].as<uint32_t>();
+    }
+
+    return true;
+  }
+};
+
+template <>
+struct convert<trpc::naming::ConcurrencyLimitConfig> {
+  static YAML::Node encode(const trpc::naming::ConcurrencyLimitConfig& config) {
+    YAML::Node node;
+
+    node["enable"] = config.enable;
+
+    node["initialLimit"] = config.initial_limit;
+
+    node["minLimit"] = config.min_limit;
+
+    node["maxLimit"] = config.max_limit;
+
+    node["smoothing"] = config.smoothing;
+
+    node["longWindow"] = config.long_window;
+
+    return node;
+  }
+
+  static bool decode(const YAML::Node& node, trpc::naming::ConcurrencyLimitConfig& config) {
+    if (node["enable"]) {
+      config.enable = node["enable"].as<bool>();
+    }
+
+    if (node["initialLimit"]) {
+      config.initial_limit = node["initialLimit"].as<uint32_t>();
+    }
+
+    if (node["minLimit"]) {
+      config.min_limit = node["minLimit"].as<uint32_t>();
+    }
+
+    if (node["maxLimit"]) {
+      config.max_limit = node["maxLimit"].as<uint32_t>();
+    }
+
+    if (node["smoothing"]) {
+      config.smoothing = node["smoothing"].as<uint32_t>();
+    }
+
+    if (node["longWindow"]) {
+      config.long_window = node["longWindow"].as<uint32_t>();
+    }
+
+    return true;
+  }
+};
+
+template <>
+struct convert<trpc::naming::RetryBudgetConfig> {
+  static YAML::Node encode(const trpc::naming::RetryBudgetConfig& config) {
+    YAML::Node node;
+
+    node["enable"] = config.enable;
+
+    node["ratio"] = config.ratio;
+
+    node["maxTokens"] = config.max_tokens;
+
+    node["metricsName"] = config.metrics_name;
+
+    return node;
+  }
+
+  static bool decode(const YAML::Node& node, trpc::naming::RetryBudgetConfig& config) {
+    if (node["enable"]) {
+      config.enable = node["enable"].as<bool>();
+    }
+
+    if (node["ratio"]) {
+      config.ratio = node["ratio"].as<uint32_t>();
+    }
+
+    if (node["maxTokens"]) {
+      config.max_tokens = node["maxTokens"].as<uint32_t>();
+    }
+
+    if (node["metricsName"]) {
+      config.metrics_name = node["metricsName"].as<std::string>();
+    }
+
+    return true;
+  }
+};
+
+template <>
+struct convert<trpc::naming::AdaptiveTimeoutConfig> {
+  static YAML::Node encode(const trpc::naming::AdaptiveTimeoutConfig& config) {
+    YAML::Node node;
+
+    node["enable"] = config.enable;
+
+    node["applyTimeout"] = config.apply_timeout;
+
+    node["percentile"] = config.percentile;
+
+    node["factor"] = config.factor;
+
+    node["minSamples"] = config.min_samples;
+
+    node["minTimeout"] = config.min_timeout;
+
+    node["window"] = config.window;
+
+    return node;
+  }
+
+  static bool decode(const YAML::Node& node, trpc::naming::AdaptiveTimeoutConfig& config) {
+    if (node["enable"]) {
+      config.enable = node["enable"].as<bool>();
+    }
+
+    if (node["applyTimeout"]) {
+      config.apply_timeout = node["applyTimeout"].as<bool>();
+    }
+
+    if (node["percentile"]) {
+      config.percentile = node["percentile"].as<uint32_t>();
+    }
+
+    if (node["factor"]) {
+      config.factor = node["factor"].as<uint32_t>();
+    }
+
+    if (node["minSamples"]) {
+      config.min_samples = node["minSamples"].as<uint64_t>();
+    }
+
+    if (node["minTimeout"]) {
+      config.min_timeout = node["minTimeout"].as<uint64_t>();
+    }
+
+    if (node["window"]) {
+      config.window = node["window"].as<uint64_t>();
+    }
+
+    return true;
+  }
+};
+
 template <>
 struct convert<trpc::naming::SelectorConfig> {
   static YAML::Node encode(const trpc::naming::SelectorConfig& config) {
@@ -741,6 +1387,26 @@ struct convert<trpc::naming::SelectorConfig> {
 
     node["dynamic_weight"] = config.dynamic_weight_config;
 
+    node["slow_start"] = config.slow_start_config;
+
+    node["flap_damping"] = config.flap_damping_config;
+
+    node["subset"] = config.subset_config;
+
+    node["hedging"] = config.hedging_config;
+
+    node["locality_breaker"] = config.locality_breaker_config;
+
+    node["latency_router"] = config.latency_router_config;
+
+    node["spillover"] = config.spillover_config;
+
+    node["concurrency_limit"] = config.concurrency_limit_config;
+
+    node["retry_budget"] = config.retry_budget_config;
+
+    node["adaptive_timeout"] = config.adaptive_timeout_config;
+
     return node;
   }
 
@@ -764,6 +1430,46 @@ struct convert<trpc::naming::SelectorConfig> {
       config.dynamic_weight_config = node["dynamic_weight"].as<trpc::naming::DynamicWeightConfig>();
     }
 
+    if (node["slow_start"]) {
+      config.slow_start_config = node["slow_start"].as<trpc::naming::SlowStartConfig>();
+    }
+
+    if (node["flap_damping"]) {
+      config.flap_damping_config = node["flap_damping"].as<trpc::naming::FlapDampingConfig>();
+    }
+
+    if (node["subset"]) {
+      config.subset_config = node["subset"].as<trpc::naming::SubsetConfig>();
+    }
+
+    if (node["hedging"]) {
+      config.hedging_config = node["hedging"].as<trpc::naming::HedgingConfig>();
+    }
+
+    if (node["locality_breaker"]) {
+      config.locality_breaker_config = node["locality_breaker"].as<trpc::naming::LocalityBreakerConfig>();
+    }
+
+    if (node["latency_router"]) {
+      config.latency_router_config = node["latency_router"].as<trpc::naming::LatencyRouterConfig>();
+    }
+
+    if (node["spillover"]) {
+      config.spillover_config = node["spillover"].as<trpc::naming::SpilloverConfig>();
+    }
+
+    if (node["concurrency_limit"]) {
+      config.concurrency_limit_config = node["concurrency_limit"].as<trpc::naming::ConcurrencyLimitConfig>();
+    }
+
+    if (node["retry_budget"]) {
+      config.retry_budget_config = node["retry_budget"].as<trpc::naming::RetryBudgetConfig>();
+    }
+
+    if (node["adaptive_timeout"]) {
+      config.adaptive_timeout_config = node["adaptive_timeout"].as<trpc::naming::AdaptiveTimeoutConfig>();
+    }
+
     return true;
   }
 };
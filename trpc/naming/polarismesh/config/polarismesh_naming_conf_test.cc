@@ -79,6 +79,232 @@ TEST(loadBalancerConfig, load_balance_config_test) {
   ASSERT_EQ(load_balance_config.compatible_golang, tmp.compatible_golang);
 }
 
+TEST(loadBalancerConfig, slow_start_config_test) {
+  trpc::naming::SlowStartConfig slow_start_config;
+  slow_start_config.enable = true;
+  slow_start_config.window = 30000;
+  slow_start_config.min_weight_percent = 20;
+  slow_start_config.curve = "exponential";
+  slow_start_config.Display();
+
+  YAML::convert<trpc::naming::SlowStartConfig> c;
+  YAML::Node config_node = c.encode(slow_start_config);
+
+  trpc::naming::SlowStartConfig tmp;
+  ASSERT_TRUE(c.decode(config_node, tmp));
+
+  ASSERT_EQ(slow_start_config.enable, tmp.enable);
+  ASSERT_EQ(slow_start_config.window, tmp.window);
+  ASSERT_EQ(slow_start_config.min_weight_percent, tmp.min_weight_percent);
+  ASSERT_EQ(slow_start_config.curve, tmp.curve);
+}
+
+TEST(selectorConfig, flap_damping_config_test) {
+  trpc::naming::FlapDampingConfig flap_damping_config;
+  flap_damping_config.enable = true;
+  flap_damping_config.up_delay = 5000;
+  flap_damping_config.down_delay = 1000;
+  flap_damping_config.min_dwell = 20000;
+  flap_damping_config.churn_budget = 3;
+  flap_damping_config.churn_window = 30000;
+  flap_damping_config.Display();
+
+  YAML::convert<trpc::naming::FlapDampingConfig> c;
+  YAML::Node config_node = c.encode(flap_damping_config);
+
+  trpc::naming::FlapDampingConfig tmp;
+  ASSERT_TRUE(c.decode(config_node, tmp));
+
+  ASSERT_EQ(flap_damping_config.enable, tmp.enable);
+  ASSERT_EQ(flap_damping_config.up_delay, tmp.up_delay);
+  ASSERT_EQ(flap_damping_config.down_delay, tmp.down_delay);
+  ASSERT_EQ(flap_damping_config.min_dwell, tmp.min_dwell);
+  ASSERT_EQ(flap_damping_config.churn_budget, tmp.churn_budget);
+  ASSERT_EQ(flap_damping_config.churn_window, tmp.churn_window);
+}
+
+TEST(selectorConfig, subset_config_test) {
+  trpc::naming::SubsetConfig subset_config;
+  subset_config.enable = true;
+  subset_config.subset_size = 20;
+  subset_config.client_id = "7";
+  subset_config.Display();
+
+  YAML::convert<trpc::naming::SubsetConfig> c;
+  YAML::Node config_node = c.encode(subset_config);
+
+  trpc::naming::SubsetConfig tmp;
+  ASSERT_TRUE(c.decode(config_node, tmp));
+
+  ASSERT_EQ(subset_config.enable, tmp.enable);
+  ASSERT_EQ(subset_config.subset_size, tmp.subset_size);
+  ASSERT_EQ(subset_config.client_id, tmp.client_id);
+}
+
+TEST(selectorConfig, hedging_config_test) {
+  trpc::naming::HedgingConfig hedging_config;
+  hedging_config.enable = true;
+  hedging_config.percentile = 99;
+  hedging_config.min_samples = 10;
+  hedging_config.min_delay = 1;
+  hedging_config.max_delay = 200;
+  hedging_config.window = 10000;
+  hedging_config.prefer_other_zone = false;
+  hedging_config.Display();
+
+  YAML::convert<trpc::naming::HedgingConfig> c;
+  YAML::Node config_node = c.encode(hedging_config);
+
+  trpc::naming::HedgingConfig tmp;
+  ASSERT_TRUE(c.decode(config_node, tmp));
+
+  ASSERT_EQ(hedging_config.enable, tmp.enable);
+  ASSERT_EQ(hedging_config.percentile, tmp.percentile);
+  ASSERT_EQ(hedging_config.min_samples, tmp.min_samples);
+  ASSERT_EQ(hedging_config.min_delay, tmp.min_delay);
+  ASSERT_EQ(hedging_config.max_delay, tmp.max_delay);
+  ASSERT_EQ(hedging_config.window, tmp.window);
+  ASSERT_EQ(hedging_config.prefer_other_zone, tmp.prefer_other_zone);
+}
+
+TEST(selectorConfig, locality_breaker_config_test) {
+  trpc::naming::LocalityBreakerConfig locality_breaker_config;
+  locality_breaker_config.enable = true;
+  locality_breaker_config.error_rate_threshold = 30;
+  locality_breaker_config.min_requests = 5;
+  locality_breaker_config.window = 5000;
+  locality_breaker_config.sleep_window = 10000;
+  locality_breaker_config.half_open_requests = 3;
+  locality_breaker_config.Display();
+
+  YAML::convert<trpc::naming::LocalityBreakerConfig> c;
+  YAML::Node config_node = c.encode(locality_breaker_config);
+
+  trpc::naming::LocalityBreakerConfig tmp;
+  ASSERT_TRUE(c.decode(config_node, tmp));
+
+  ASSERT_EQ(locality_breaker_config.enable, tmp.enable);
+  ASSERT_EQ(locality_breaker_config.error_rate_threshold, tmp.error_rate_threshold);
+  ASSERT_EQ(locality_breaker_config.min_requests, tmp.min_requests);
+  ASSERT_EQ(locality_breaker_config.window, tmp.window);
+  ASSERT_EQ(locality_breaker_config.sleep_window, tmp.sleep_window);
+  ASSERT_EQ(locality_breaker_config.half_open_requests, tmp.half_open_requests);
+}
+
+TEST(selectorConfig, latency_router_config_test) {
+  trpc::naming::LatencyRouterConfig latency_router_config;
+  latency_router_config.enable = true;
+  latency_router_config.hysteresis = 30;
+  latency_router_config.min_samples = 5;
+  latency_router_config.expire = 30000;
+  latency_router_config.min_healthy_instances = 2;
+  latency_router_config.probe_ratio = 5;
+  latency_router_config.Display();
+
+  YAML::convert<trpc::naming::LatencyRouterConfig> c;
+  YAML::Node config_node = c.encode(latency_router_config);
+
+  trpc::naming::LatencyRouterConfig tmp;
+  ASSERT_TRUE(c.decode(config_node, tmp));
+
+  ASSERT_EQ(latency_router_config.enable, tmp.enable);
+  ASSERT_EQ(latency_router_config.hysteresis, tmp.hysteresis);
+  ASSERT_EQ(latency_router_config.min_samples, tmp.min_samples);
+  ASSERT_EQ(latency_router_config.expire, tmp.expire);
+  ASSERT_EQ(latency_router_config.min_healthy_instances, tmp.min_healthy_instances);
+  ASSERT_EQ(latency_router_config.probe_ratio, tmp.probe_ratio);
+}
+
+TEST(selectorConfig, spillover_config_test) {
+  trpc::naming::SpilloverConfig spillover_config;
+  spillover_config.enable = true;
+  spillover_config.tolerance = 30;
+  spillover_config.min_inflight = 4;
+  spillover_config.max_ratio = 80;
+  spillover_config.Display();
+
+  YAML::convert<trpc::naming::SpilloverConfig> c;
+  YAML::Node config_node = c.encode(spillover_config);
+
+  trpc::naming::SpilloverConfig tmp;
+  ASSERT_TRUE(c.decode(config_node, tmp));
+
+  ASSERT_EQ(spillover_config.enable, tmp.enable);
+  ASSERT_EQ(spillover_config.tolerance, tmp.tolerance);
+  ASSERT_EQ(spillover_config.min_inflight, tmp.min_inflight);
+  ASSERT_EQ(spillover_config.max_ratio, tmp.max_ratio);
+}
+
+TEST(selectorConfig, concurrency_limit_config_test) {
+  trpc::naming::ConcurrencyLimitConfig concurrency_limit_config;
+  concurrency_limit_config.enable = true;
+  concurrency_limit_config.initial_limit = 10;
+  concurrency_limit_config.min_limit = 2;
+  concurrency_limit_config.max_limit = 100;
+  concurrency_limit_config.smoothing = 50;
+  concurrency_limit_config.long_window = 100;
+  concurrency_limit_config.Display();
+
+  YAML::convert<trpc::naming::ConcurrencyLimitConfig> c;
+  YAML::Node config_node = c.encode(concurrency_limit_config);
+
+  trpc::naming::ConcurrencyLimitConfig tmp;
+  ASSERT_TRUE(c.decode(config_node, tmp));
+
+  ASSERT_EQ(concurrency_limit_config.enable, tmp.enable);
+  ASSERT_EQ(concurrency_limit_config.initial_limit, tmp.initial_limit);
+  ASSERT_EQ(concurrency_limit_config.min_limit, tmp.min_limit);
+  ASSERT_EQ(concurrency_limit_config.max_limit, tmp.max_limit);
+  ASSERT_EQ(concurrency_limit_config.smoothing, tmp.smoothing);
+  ASSERT_EQ(concurrency_limit_config.long_window, tmp.long_window);
+}
+
+TEST(selectorConfig, retry_budget_config_test) {
+  trpc::naming::RetryBudgetConfig retry_budget_config;
+  retry_budget_config.enable = true;
+  retry_budget_config.ratio = 20;
+  retry_budget_config.max_tokens = 20;
+  retry_budget_config.metrics_name = "test_metrics";
+  retry_budget_config.Display();
+
+  YAML::convert<trpc::naming::RetryBudgetConfig> c;
+  YAML::Node config_node = c.encode(retry_budget_config);
+
+  trpc::naming::RetryBudgetConfig tmp;
+  ASSERT_TRUE(c.decode(config_node, tmp));
+
+  ASSERT_EQ(retry_budget_config.enable, tmp.enable);
+  ASSERT_EQ(retry_budget_config.ratio, tmp.ratio);
+  ASSERT_EQ(retry_budget_config.max_tokens, tmp.max_tokens);
+  ASSERT_EQ(retry_budget_config.metrics_name, tmp.metrics_name);
+}
+
+TEST(selectorConfig, adaptive_timeout_config_test) {
+  trpc::naming::AdaptiveTimeoutConfig adaptive_timeout_config;
+  adaptive_timeout_config.enable = true;
+  adaptive_timeout_config.apply_timeout = true;
+  adaptive_timeout_config.percentile = 95;
+  adaptive_timeout_config.factor = 300;
+  adaptive_timeout_config.min_samples = 50;
+  adaptive_timeout_config.min_timeout = 20;
+  adaptive_timeout_config.window = 30000;
+  adaptive_timeout_config.Display();
+
+  YAML::convert<trpc::naming::AdaptiveTimeoutConfig> c;
+  YAML::Node config_node = c.encode(adaptive_timeout_config);
+
+  trpc::naming::AdaptiveTimeoutConfig tmp;
+  ASSERT_TRUE(c.decode(config_node, tmp));
+
+  ASSERT_EQ(adaptive_timeout_config.enable, tmp.enable);
+  ASSERT_EQ(adaptive_timeout_config.apply_timeout, tmp.apply_timeout);
+  ASSERT_EQ(adaptive_timeout_config.percentile, tmp.percentile);
+  ASSERT_EQ(adaptive_timeout_config.factor, tmp.factor);
+  ASSERT_EQ(adaptive_timeout_config.min_samples, tmp.min_samples);
+  ASSERT_EQ(adaptive_timeout_config.min_timeout, tmp.min_timeout);
+  ASSERT_EQ(adaptive_timeout_config.window, tmp.window);
+}
+
 TEST(loadBalancerConfig, load_service_router_config_test) {
   // Configure the nearby route plug-in
   trpc::naming::NearbyBasedRouterConfig nearby_based_router_config;
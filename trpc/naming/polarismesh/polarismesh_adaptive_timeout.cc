@@ -0,0 +1,48 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_adaptive_timeout.h"
+
+#include <algorithm>
+
+namespace trpc {
+
+void TimeoutAdvisor::SetConfig(const naming::AdaptiveTimeoutConfig& config) {
+  config_ = config;
+  config_.percentile = std::clamp<uint32_t>(config_.percentile, 1, 99);
+  sketches_.SetWindow(config_.window);
+}
+
+uint64_t TimeoutAdvisor::GetTimeout(const std::string& method, uint64_t now_ms) {
+  if (!Enabled()) {
+    return 0;
+  }
+
+  uint64_t latency = 0;
+  if (!sketches_.GetPercentile(method, config_.percentile, config_.min_samples, now_ms, latency)) {
+    return 0;
+  }
+  return std::max(latency * config_.factor / 100, config_.min_timeout);
+}
+
+void TimeoutAdvisor::RecordLatency(const std::string& method, uint64_t latency_ms, uint64_t now_ms) {
+  sketches_.Record(method, latency_ms, now_ms);
+}
+
+void TimeoutAdvisor::RecordTimeout(const std::string& method, uint64_t timeout_ms, uint64_t now_ms) {
+  sketches_.Record(method, timeout_ms, now_ms);
+}
+
+void TimeoutAdvisor::Clear() { sketches_.Clear(); }
+
+}  // namespace trpc
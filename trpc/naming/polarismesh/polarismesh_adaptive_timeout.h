@@ -0,0 +1,51 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "trpc/naming/polarismesh/config/polarismesh_naming_conf.h"
+#include "trpc/naming/polarismesh/polarismesh_hedging.h"
+
+namespace trpc {
+
+/// @brief Recommends the request timeout of the methods of the callee services by their observed latency
+class TimeoutAdvisor {
+ public:
+  void SetConfig(const naming::AdaptiveTimeoutConfig& config);
+
+  bool Enabled() const { return config_.enable; }
+
+  const naming::AdaptiveTimeoutConfig& GetConfig() const { return config_; }
+
+  /// @brief Get the recommended timeout of the method
+  /// @param method The key of the method, e.g. service name and method name
+  /// @return The latency percentile times the factor, at least the min timeout, 0 if there are not enough samples
+  uint64_t GetTimeout(const std::string& method, uint64_t now_ms);
+
+  void RecordLatency(const std::string& method, uint64_t latency_ms, uint64_t now_ms);
+
+  /// @brief Record a timed out call, whose latency is known to be at least the timeout only, as a sample at the
+  ///        timeout, so that the recommendation rises when the calls time out instead of being fitted to the fast ones
+  void RecordTimeout(const std::string& method, uint64_t timeout_ms, uint64_t now_ms);
+
+  void Clear();
+
+ private:
+  naming::AdaptiveTimeoutConfig config_;
+  LatencySketchTable sketches_;
+};
+
+}  // namespace trpc
@@ -0,0 +1,85 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_adaptive_timeout.h"
+
+#include "gtest/gtest.h"
+
+namespace trpc {
+
+TEST(TimeoutAdvisorTest, GetTimeout) {
+  naming::AdaptiveTimeoutConfig config;
+  config.enable = true;
+  config.percentile = 99;
+  config.factor = 200;
+  config.min_samples = 10;
+  config.min_timeout = 10;
+  TimeoutAdvisor advisor;
+  advisor.SetConfig(config);
+  ASSERT_TRUE(advisor.Enabled());
+  ASSERT_EQ(0, advisor.GetTimeout("test.service/Echo", 100));
+
+  // Not enough samples
+  for (int i = 0; i < 9; ++i) {
+    advisor.RecordLatency("test.service/Echo", 40, 100);
+  }
+  ASSERT_EQ(0, advisor.GetTimeout("test.service/Echo", 100));
+  advisor.RecordLatency("test.service/Echo", 40, 100);
+  uint64_t timeout = advisor.GetTimeout("test.service/Echo", 100);
+  ASSERT_GE(timeout, 80);
+  ASSERT_LE(timeout, 90);
+  // The methods are separated
+  ASSERT_EQ(0, advisor.GetTimeout("test.service/Hello", 100));
+
+  // At least the min timeout
+  for (int i = 0; i < 10; ++i) {
+    advisor.RecordLatency("test.service/Fast", 1, 100);
+  }
+  ASSERT_EQ(10, advisor.GetTimeout("test.service/Fast", 100));
+
+  advisor.Clear();
+  ASSERT_EQ(0, advisor.GetTimeout("test.service/Echo", 100));
+}
+
+TEST(TimeoutAdvisorTest, RecordTimeout) {
+  naming::AdaptiveTimeoutConfig config;
+  config.enable = true;
+  config.percentile = 90;
+  config.factor = 100;
+  config.min_samples = 10;
+  config.min_timeout = 1;
+  TimeoutAdvisor advisor;
+  advisor.SetConfig(config);
+  for (int i = 0; i < 80; ++i) {
+    advisor.RecordLatency("test.service/Echo", 10, 100);
+  }
+  ASSERT_EQ(10, advisor.GetTimeout("test.service/Echo", 100));
+
+  // The timed out calls are counted at the timeout, which raises the recommendation
+  for (int i = 0; i < 20; ++i) {
+    advisor.RecordTimeout("test.service/Echo", 50, 100);
+  }
+  uint64_t timeout = advisor.GetTimeout("test.service/Echo", 100);
+  ASSERT_GE(timeout, 50);
+  ASSERT_LE(timeout, 55);
+}
+
+TEST(TimeoutAdvisorTest, Disabled) {
+  TimeoutAdvisor advisor;
+  advisor.SetConfig(naming::AdaptiveTimeoutConfig());
+  ASSERT_FALSE(advisor.Enabled());
+  advisor.RecordLatency("test.service/Echo", 40, 100);
+  ASSERT_EQ(0, advisor.GetTimeout("test.service/Echo", 100));
+}
+
+}  // namespace trpc
@@ -0,0 +1,69 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_concurrency_limit.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace trpc {
+
+namespace {
+
+// The limit is shrunk to at most half by one update
+constexpr double kMinGradient = 0.5;
+
+}  // namespace
+
+uint32_t ConcurrencyLimit::GetLimit(const naming::ConcurrencyLimitConfig& config) const {
+  uint32_t limit = current_limit_.load(std::memory_order_relaxed);
+  return limit == 0 ? config.initial_limit : limit;
+}
+
+void ConcurrencyLimit::Update(const naming::ConcurrencyLimitConfig& config, uint64_t latency_ms, uint64_t inflight,
+                              bool success) {
+  std::scoped_lock<std::mutex> lock(mutex_);
+  if (limit_ == 0) {
+    limit_ = config.initial_limit;
+  }
+
+  double latency = std::max(static_cast<double>(latency_ms), 1.0);
+  double gradient = kMinGradient;
+  if (success) {
+    if (long_latency_ms_ == 0) {
+      long_latency_ms_ = latency;
+    } else {
+      long_latency_ms_ += (latency - long_latency_ms_) / std::max(config.long_window, 1u);
+    }
+    // The long-term latency recovers quicker after a long overload, otherwise the limit keeps low
+    if (long_latency_ms_ > latency * 2) {
+      long_latency_ms_ *= 0.95;
+    }
+    gradient = std::clamp(long_latency_ms_ / latency, kMinGradient, 1.0);
+  }
+
+  // A queue allowance is added to probe for more concurrency while the requests succeed, and the limit is not grown
+  // by the requests which do not use it up
+  double new_limit = limit_ * gradient + (success ? std::sqrt(limit_) : 0);
+  if (new_limit > limit_ && inflight * 2 < limit_) {
+    return;
+  }
+
+  double smoothing = std::min(config.smoothing, 100u) / 100.0;
+  limit_ = limit_ * (1 - smoothing) + new_limit * smoothing;
+  limit_ = std::clamp(limit_, static_cast<double>(std::max(config.min_limit, 1u)),
+                      static_cast<double>(std::max(config.max_limit, config.min_limit)));
+  current_limit_.store(static_cast<uint32_t>(limit_), std::memory_order_relaxed);
+}
+
+}  // namespace trpc
@@ -0,0 +1,47 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "trpc/naming/polarismesh/config/polarismesh_naming_conf.h"
+
+namespace trpc {
+
+/// @brief The adaptive concurrency limit of one callee instance, learned by the gradient of the long-term and the
+///        current latency: the limit shrinks when the latency grows (the requests queue up in the instance) or the
+///        requests fail, and grows by a queue allowance while the latency is stable
+class ConcurrencyLimit {
+ public:
+  /// @brief Get the current limit
+  uint32_t GetLimit(const naming::ConcurrencyLimitConfig& config) const;
+
+  /// @brief Update the limit by the result of a request
+  /// @param latency_ms The latency of the request
+  /// @param inflight The in-flight requests of the instance when the request is finished
+  /// @param success Whether the request succeeded, a failed request shrinks the limit
+  void Update(const naming::ConcurrencyLimitConfig& config, uint64_t latency_ms, uint64_t inflight, bool success);
+
+ private:
+  std::mutex mutex_;
+  // The smoothed limit, 0 before the first update
+  double limit_{0};
+  // The long-term average of the latency
+  double long_latency_ms_{0};
+  std::atomic<uint32_t> current_limit_{0};
+};
+
+}  // namespace trpc
@@ -0,0 +1,70 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_concurrency_limit.h"
+
+#include "gtest/gtest.h"
+
+namespace trpc {
+
+namespace {
+
+naming::ConcurrencyLimitConfig MakeConfig() {
+  naming::ConcurrencyLimitConfig config;
+  config.enable = true;
+  config.initial_limit = 20;
+  config.min_limit = 2;
+  config.max_limit = 100;
+  config.smoothing = 100;
+  config.long_window = 100;
+  return config;
+}
+
+}  // namespace
+
+TEST(ConcurrencyLimitTest, Grow) {
+  naming::ConcurrencyLimitConfig config = MakeConfig();
+  ConcurrencyLimit limit;
+  ASSERT_EQ(20, limit.GetLimit(config));
+
+  // Not grown if the limit is not used up
+  limit.Update(config, 10, 1, true);
+  ASSERT_EQ(20, limit.GetLimit(config));
+
+  // Grown while the latency is stable, up to the max limit
+  for (int i = 0; i < 100; ++i) {
+    limit.Update(config, 10, limit.GetLimit(config), true);
+  }
+  ASSERT_EQ(100, limit.GetLimit(config));
+}
+
+TEST(ConcurrencyLimitTest, Shrink) {
+  naming::ConcurrencyLimitConfig config = MakeConfig();
+  ConcurrencyLimit limit;
+  for (int i = 0; i < 10; ++i) {
+    limit.Update(config, 10, limit.GetLimit(config), true);
+  }
+  uint32_t stable_limit = limit.GetLimit(config);
+
+  // The latency grows as the requests queue up
+  limit.Update(config, 40, stable_limit, true);
+  ASSERT_LT(limit.GetLimit(config), stable_limit);
+
+  // The failures shrink the limit down to the min limit
+  for (int i = 0; i < 100; ++i) {
+    limit.Update(config, 10, 0, false);
+  }
+  ASSERT_EQ(2, limit.GetLimit(config));
+}
+
+}  // namespace trpc
@@ -0,0 +1,131 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_flap_damper.h"
+
+#include <atomic>
+#include <functional>
+#include <utility>
+
+#include "trpc/naming/polarismesh/common.h"
+
+namespace trpc {
+
+namespace {
+
+// Generations are unique in the process, so that a generation never matches the one of a dropped endpoint set
+std::atomic<uint64_t> g_damper_generation{0};
+
+// The max number of the endpoint sets, which are keyed by the routing inputs of the callers
+constexpr std::size_t kMaxEndpointSetsNum = 4096;
+
+void CombineHash(uint64_t& seed, uint64_t value) { seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2); }
+
+}  // namespace
+
+uint64_t FlapDamper::Apply(const std::string& key, std::vector<TrpcEndpointInfo>& endpoints, uint64_t now_ms) {
+  std::scoped_lock<std::mutex> lock(mutex_);
+  auto state_it = endpoint_sets_.find(key);
+  // The first endpoints of a set are published without delay
+  bool bootstrap = state_it == endpoint_sets_.end();
+  if (bootstrap && endpoint_sets_.size() >= kMaxEndpointSetsNum) {
+    endpoint_sets_.clear();
+  }
+  EndpointSetState& state = bootstrap ? endpoint_sets_[key] : state_it->second;
+
+  for (auto& item : state.instances) {
+    item.second.present = false;
+  }
+  for (auto& endpoint : endpoints) {
+    bool up = endpoint.status != 0;
+    auto result = state.instances.try_emplace(GetEndpointInstanceId(endpoint));
+    InstanceState& instance = result.first->second;
+    instance.endpoint = std::move(endpoint);
+    instance.present = true;
+    if (result.second) {
+      instance.raw_up = up;
+      instance.raw_since_ms = now_ms;
+      instance.published_up = bootstrap && up;
+    } else if (instance.raw_up != up) {
+      instance.raw_up = up;
+      instance.raw_since_ms = now_ms;
+    }
+  }
+
+  for (auto it = state.instances.begin(); it != state.instances.end();) {
+    InstanceState& instance = it->second;
+    if (!instance.present && instance.raw_up) {
+      instance.raw_up = false;
+      instance.raw_since_ms = now_ms;
+    }
+
+    if (instance.raw_up != instance.published_up) {
+      uint64_t delay = instance.raw_up ? config_.up_delay : config_.down_delay;
+      if (instance.raw_since_ms + delay <= now_ms && instance.published_since_ms + config_.min_dwell <= now_ms &&
+          HasChurnBudget(state, now_ms)) {
+        instance.published_up = instance.raw_up;
+        instance.published_since_ms = now_ms;
+        state.changes_ms.push_back(now_ms);
+      }
+    }
+
+    // The instance is gone and no longer published, keep it until the dwell time passes to damp its comeback
+    if (!instance.present && !instance.published_up && instance.published_since_ms + config_.min_dwell <= now_ms) {
+      it = state.instances.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  endpoints.clear();
+  uint64_t fingerprint = 0;
+  for (const auto& item : state.instances) {
+    const InstanceState& instance = item.second;
+    if (instance.published_up) {
+      endpoints.push_back(instance.endpoint);
+      endpoints.back().status = true;
+    } else if (instance.present && !instance.raw_up) {
+      // The unhealthy instance is returned by the SDK (e.g. include_unhealthy), keep it as unhealthy
+      endpoints.push_back(instance.endpoint);
+    } else {
+      continue;
+    }
+    const TrpcEndpointInfo& endpoint = endpoints.back();
+    CombineHash(fingerprint, std::hash<std::string>{}(item.first));
+    CombineHash(fingerprint, endpoint.weight);
+    CombineHash(fingerprint, endpoint.status);
+  }
+
+  if (state.generation == 0 || fingerprint != state.fingerprint) {
+    state.fingerprint = fingerprint;
+    state.generation = ++g_damper_generation;
+  }
+  return state.generation;
+}
+
+bool FlapDamper::HasChurnBudget(EndpointSetState& state, uint64_t now_ms) const {
+  if (config_.churn_budget == 0) {
+    return true;
+  }
+  while (!state.changes_ms.empty() && state.changes_ms.front() + config_.churn_window <= now_ms) {
+    state.changes_ms.pop_front();
+  }
+  return state.changes_ms.size() < config_.churn_budget;
+}
+
+void FlapDamper::Clear() {
+  std::scoped_lock<std::mutex> lock(mutex_);
+  endpoint_sets_.clear();
+}
+
+}  // namespace trpc
@@ -0,0 +1,77 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "trpc/naming/common/common_defs.h"
+#include "trpc/naming/polarismesh/config/polarismesh_naming_conf.h"
+
+namespace trpc {
+
+/// @brief Damps the availability changes of the instances before they are seen by the framework
+/// @note An instance is available if it is in the instances returned by the SDK and is healthy. The published
+///       availability follows the SDK with hysteresis (different delays for going up and down), a minimum dwell time
+///       between two changes of one instance, and a per-service budget of changes in a window
+class FlapDamper {
+ public:
+  void SetConfig(const naming::FlapDampingConfig& config) { config_ = config; }
+
+  bool Enabled() const { return config_.enable; }
+
+  /// @brief Apply the damping to the endpoints returned by the SDK
+  /// @param key The key of the endpoint set, e.g. the service, the select policy and the routing inputs
+  /// @param[in,out] endpoints The endpoints returned by the SDK, replaced by the damped endpoints
+  /// @param now_ms Current time, unit: ms
+  /// @return The generation of the damped endpoints, which changes only when the damped endpoints change
+  uint64_t Apply(const std::string& key, std::vector<TrpcEndpointInfo>& endpoints, uint64_t now_ms);
+
+  void Clear();
+
+ private:
+  struct InstanceState {
+    TrpcEndpointInfo endpoint;
+    // Whether the instance is in the latest endpoints of the SDK
+    bool present{false};
+    // The availability reported by the SDK, and since when
+    bool raw_up{false};
+    uint64_t raw_since_ms{0};
+    // The availability seen by the framework, and since when
+    bool published_up{false};
+    uint64_t published_since_ms{0};
+  };
+
+  struct EndpointSetState {
+    std::map<std::string, InstanceState> instances;
+    // The time of the published changes in the churn window
+    std::deque<uint64_t> changes_ms;
+    uint64_t fingerprint{0};
+    uint64_t generation{0};
+  };
+
+  bool HasChurnBudget(EndpointSetState& state, uint64_t now_ms) const;
+
+ private:
+  naming::FlapDampingConfig config_;
+  std::mutex mutex_;
+  std::unordered_map<std::string, EndpointSetState> endpoint_sets_;
+};
+
+}  // namespace trpc
@@ -0,0 +1,208 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_flap_damper.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace trpc {
+
+namespace {
+
+TrpcEndpointInfo MakeEndpoint(const std::string& id, int port, bool healthy) {
+  TrpcEndpointInfo endpoint;
+  endpoint.host = "127.0.0.1";
+  endpoint.port = port;
+  endpoint.status = healthy;
+  endpoint.weight = 100;
+  endpoint.meta["instance_id"] = id;
+  return endpoint;
+}
+
+naming::FlapDampingConfig MakeConfig() {
+  naming::FlapDampingConfig config;
+  config.enable = true;
+  config.up_delay = 1000;
+  config.down_delay = 500;
+  config.min_dwell = 2000;
+  return config;
+}
+
+bool IsAvailable(const std::vector<TrpcEndpointInfo>& endpoints, int port) {
+  for (const auto& endpoint : endpoints) {
+    if (endpoint.port == port) {
+      return endpoint.status != 0;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+TEST(FlapDamperTest, FirstEndpointsPublishedImmediately) {
+  FlapDamper damper;
+  damper.SetConfig(MakeConfig());
+  ASSERT_TRUE(damper.Enabled());
+
+  std::vector<TrpcEndpointInfo> endpoints{MakeEndpoint("a", 10001, true), MakeEndpoint("b", 10002, false)};
+  uint64_t generation = damper.Apply("key", endpoints, 1000);
+  ASSERT_EQ(2, endpoints.size());
+  ASSERT_TRUE(IsAvailable(endpoints, 10001));
+  ASSERT_FALSE(IsAvailable(endpoints, 10002));
+
+  // Nothing changes, so does the generation
+  endpoints = {MakeEndpoint("a", 10001, true), MakeEndpoint("b", 10002, false)};
+  ASSERT_EQ(generation, damper.Apply("key", endpoints, 1100));
+}
+
+TEST(FlapDamperTest, Hysteresis) {
+  FlapDamper damper;
+  damper.SetConfig(MakeConfig());
+
+  std::vector<TrpcEndpointInfo> endpoints{MakeEndpoint("a", 10001, true), MakeEndpoint("b", 10002, true)};
+  uint64_t generation = damper.Apply("key", endpoints, 0);
+
+  // The instance is filtered out by the SDK, it is published after the down delay
+  endpoints = {MakeEndpoint("b", 10002, true)};
+  ASSERT_EQ(generation, damper.Apply("key", endpoints, 10000));
+  ASSERT_TRUE(IsAvailable(endpoints, 10001));
+  endpoints = {MakeEndpoint("b", 10002, true)};
+  uint64_t down_generation = damper.Apply("key", endpoints, 10500);
+  ASSERT_NE(generation, down_generation);
+  ASSERT_FALSE(IsAvailable(endpoints, 10001));
+
+  // A short recovery is not published
+  endpoints = {MakeEndpoint("a", 10001, true), MakeEndpoint("b", 10002, true)};
+  ASSERT_EQ(down_generation, damper.Apply("key", endpoints, 13000));
+  ASSERT_FALSE(IsAvailable(endpoints, 10001));
+  endpoints = {MakeEndpoint("b", 10002, true)};
+  ASSERT_EQ(down_generation, damper.Apply("key", endpoints, 13500));
+
+  // A stable recovery is published after the up delay
+  endpoints = {MakeEndpoint("a", 10001, true), MakeEndpoint("b", 10002, true)};
+  damper.Apply("key", endpoints, 14000);
+  ASSERT_FALSE(IsAvailable(endpoints, 10001));
+  endpoints = {MakeEndpoint("a", 10001, true), MakeEndpoint("b", 10002, true)};
+  ASSERT_NE(down_generation, damper.Apply("key", endpoints, 15000));
+  ASSERT_TRUE(IsAvailable(endpoints, 10001));
+}
+
+TEST(FlapDamperTest, UnhealthyInstanceReturnedBySdk) {
+  FlapDamper damper;
+  damper.SetConfig(MakeConfig());
+
+  std::vector<TrpcEndpointInfo> endpoints{MakeEndpoint("a", 10001, true)};
+  damper.Apply("key", endpoints, 0);
+
+  // The unhealthy instance is published as healthy until the down delay passes
+  endpoints = {MakeEndpoint("a", 10001, false)};
+  damper.Apply("key", endpoints, 10000);
+  ASSERT_EQ(1, endpoints.size());
+  ASSERT_TRUE(IsAvailable(endpoints, 10001));
+  endpoints = {MakeEndpoint("a", 10001, false)};
+  damper.Apply("key", endpoints, 10500);
+  ASSERT_EQ(1, endpoints.size());
+  ASSERT_FALSE(IsAvailable(endpoints, 10001));
+}
+
+TEST(FlapDamperTest, MinDwell) {
+  FlapDamper damper;
+  damper.SetConfig(MakeConfig());
+
+  std::vector<TrpcEndpointInfo> endpoints{MakeEndpoint("a", 10001, true)};
+  damper.Apply("key", endpoints, 0);
+  endpoints = {MakeEndpoint("a", 10001, false)};
+  damper.Apply("key", endpoints, 10000);
+  endpoints = {MakeEndpoint("a", 10001, false)};
+  damper.Apply("key", endpoints, 10500);
+  ASSERT_FALSE(IsAvailable(endpoints, 10001));
+
+  // The up delay passes, but the instance has to stay down for the dwell time
+  endpoints = {MakeEndpoint("a", 10001, true)};
+  damper.Apply("key", endpoints, 10600);
+  endpoints = {MakeEndpoint("a", 10001, true)};
+  damper.Apply("key", endpoints, 11600);
+  ASSERT_FALSE(IsAvailable(endpoints, 10001));
+  endpoints = {MakeEndpoint("a", 10001, true)};
+  damper.Apply("key", endpoints, 12500);
+  ASSERT_TRUE(IsAvailable(endpoints, 10001));
+}
+
+TEST(FlapDamperTest, NewAndRemovedInstance) {
+  FlapDamper damper;
+  damper.SetConfig(MakeConfig());
+
+  std::vector<TrpcEndpointInfo> endpoints{MakeEndpoint("a", 10001, true)};
+  damper.Apply("key", endpoints, 0);
+
+  // A new instance is published after the up delay
+  endpoints = {MakeEndpoint("a", 10001, true), MakeEndpoint("b", 10002, true)};
+  damper.Apply("key", endpoints, 10000);
+  ASSERT_EQ(1, endpoints.size());
+  endpoints = {MakeEndpoint("a", 10001, true), MakeEndpoint("b", 10002, true)};
+  damper.Apply("key", endpoints, 11000);
+  ASSERT_EQ(2, endpoints.size());
+
+  // A removed instance is kept until the down delay passes
+  endpoints = {MakeEndpoint("b", 10002, true)};
+  damper.Apply("key", endpoints, 20000);
+  ASSERT_EQ(2, endpoints.size());
+  ASSERT_TRUE(IsAvailable(endpoints, 10001));
+  endpoints = {MakeEndpoint("b", 10002, true)};
+  damper.Apply("key", endpoints, 20500);
+  ASSERT_EQ(1, endpoints.size());
+  ASSERT_EQ(10002, endpoints[0].port);
+}
+
+TEST(FlapDamperTest, ChurnBudget) {
+  naming::FlapDampingConfig config = MakeConfig();
+  config.churn_budget = 1;
+  config.churn_window = 5000;
+  FlapDamper damper;
+  damper.SetConfig(config);
+
+  std::vector<TrpcEndpointInfo> endpoints{MakeEndpoint("a", 10001, true), MakeEndpoint("b", 10002, true)};
+  damper.Apply("key", endpoints, 0);
+
+  // Both instances go down, only one change is published in the window
+  endpoints = {MakeEndpoint("a", 10001, false), MakeEndpoint("b", 10002, false)};
+  damper.Apply("key", endpoints, 10000);
+  endpoints = {MakeEndpoint("a", 10001, false), MakeEndpoint("b", 10002, false)};
+  damper.Apply("key", endpoints, 10500);
+  ASSERT_FALSE(IsAvailable(endpoints, 10001));
+  ASSERT_TRUE(IsAvailable(endpoints, 10002));
+
+  endpoints = {MakeEndpoint("a", 10001, false), MakeEndpoint("b", 10002, false)};
+  damper.Apply("key", endpoints, 15500);
+  ASSERT_FALSE(IsAvailable(endpoints, 10001));
+  ASSERT_FALSE(IsAvailable(endpoints, 10002));
+}
+
+TEST(FlapDamperTest, Clear) {
+  FlapDamper damper;
+  damper.SetConfig(MakeConfig());
+
+  std::vector<TrpcEndpointInfo> endpoints{MakeEndpoint("a", 10001, true)};
+  damper.Apply("key", endpoints, 0);
+  damper.Clear();
+
+  // Published immediately after the state is cleared
+  endpoints = {MakeEndpoint("a", 10001, false)};
+  damper.Apply("key", endpoints, 100);
+  ASSERT_FALSE(IsAvailable(endpoints, 10001));
+}
+
+}  // namespace trpc
@@ -0,0 +1,136 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_heartbeat_scheduler.h"
+
+#include <utility>
+
+namespace trpc {
+
+namespace {
+
+// The max exponent of the backoff of the heartbeat interval
+constexpr uint32_t kMaxBackoffShift = 10;
+
+}  // namespace
+
+HeartbeatScheduler::HeartbeatScheduler() : random_(std::random_device{}()) {}
+
+void HeartbeatScheduler::SetConfig(uint64_t interval, uint32_t jitter, uint32_t backoff_limit) {
+  std::scoped_lock<std::mutex> lock(mutex_);
+  interval_ = interval == 0 ? 1 : interval;
+  jitter_ = jitter > 100 ? 100 : jitter;
+  backoff_limit_ = backoff_limit;
+}
+
+std::string HeartbeatScheduler::MakeKey(const std::string& service_name, const std::string& host, int port) {
+  return service_name + "/" + host + ":" + std::to_string(port);
+}
+
+uint64_t HeartbeatScheduler::GetPhase(const std::string& key, uint64_t interval) {
+  // FNV-1a, which does not depend on the implementation of the standard library
+  uint64_t hash = 14695981039346656037ULL;
+  for (char c : key) {
+    hash ^= static_cast<uint8_t>(c);
+    hash *= 1099511628211ULL;
+  }
+  return interval == 0 ? 0 : hash % interval;
+}
+
+uint64_t HeartbeatScheduler::AlignUp(uint64_t time_ms, uint64_t phase) const {
+  uint64_t aligned = time_ms - time_ms % interval_ + phase;
+  return aligned < time_ms ? aligned + interval_ : aligned;
+}
+
+uint64_t HeartbeatScheduler::NextJitter(uint64_t max_jitter) {
+  uint64_t range = interval_ * jitter_ / 100;
+  if (range > max_jitter) {
+    range = max_jitter;
+  }
+  return range == 0 ? 0 : random_() % (range + 1);
+}
+
+uint64_t HeartbeatScheduler::GetBackoffInterval(const HeartbeatTarget& target) const {
+  uint32_t failures = target.failures.load(std::memory_order_relaxed);
+  uint64_t limit = target.ttl * backoff_limit_ / 100;
+  if (failures == 0 || limit <= interval_) {
+    return interval_;
+  }
+  uint64_t interval = interval_ << (failures < kMaxBackoffShift ? failures : kMaxBackoffShift);
+  return interval < limit ? interval : limit;
+}
+
+void HeartbeatScheduler::Add(const std::string& key, HeartbeatTargetPtr target, uint64_t now_ms) {
+  std::scoped_lock<std::mutex> lock(mutex_);
+  Entry& entry = entries_[key];
+  entry.target = std::move(target);
+  entry.phase = GetPhase(key, interval_);
+  entry.slot_ms = AlignUp(now_ms, entry.phase);
+  entry.next_beat_ms = entry.slot_ms;
+  entry.last_slot_ms = 0;
+}
+
+bool HeartbeatScheduler::Remove(const std::string& key) {
+  std::scoped_lock<std::mutex> lock(mutex_);
+  return entries_.erase(key) > 0;
+}
+
+bool HeartbeatScheduler::Contains(const std::string& key) const {
+  std::scoped_lock<std::mutex> lock(mutex_);
+  return entries_.find(key) != entries_.end();
+}
+
+std::size_t HeartbeatScheduler::Size() const {
+  std::scoped_lock<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+void HeartbeatScheduler::Schedule(Entry& entry, uint64_t slot_ms, uint64_t now_ms) {
+  entry.slot_ms = slot_ms;
+  entry.next_beat_ms = slot_ms - NextJitter(slot_ms - now_ms - 1);
+}
+
+std::vector<HeartbeatTargetPtr> HeartbeatScheduler::TakeDue(uint64_t now_ms) {
+  std::vector<HeartbeatTargetPtr> due;
+  std::scoped_lock<std::mutex> lock(mutex_);
+  for (auto& [key, entry] : entries_) {
+    if (now_ms < entry.next_beat_ms) {
+      continue;
+    }
+
+    // The heartbeat is deferred while the heartbeats of the instance fail, whose results are known before the next
+    // heartbeat is due since the heartbeat timeout is shorter than the interval. The next phase is at most the backed
+    // off interval later than the last heartbeat, so that the TTL of the instance is never exceeded
+    if (entry.last_slot_ms != 0) {
+      uint64_t interval = GetBackoffInterval(*entry.target);
+      uint64_t backoff_slot_ms = AlignUp(entry.last_slot_ms + interval - interval_ + 1, entry.phase);
+      if (backoff_slot_ms > entry.slot_ms && backoff_slot_ms > now_ms) {
+        Schedule(entry, backoff_slot_ms, now_ms);
+        continue;
+      }
+    }
+
+    due.push_back(entry.target);
+    // Scheduled from now if the timer is late, so that the missed heartbeats are not sent in a burst
+    entry.last_slot_ms = entry.slot_ms > now_ms ? entry.slot_ms : now_ms;
+    Schedule(entry, AlignUp(entry.last_slot_ms + 1, entry.phase), now_ms);
+  }
+  return due;
+}
+
+void HeartbeatScheduler::Clear() {
+  std::scoped_lock<std::mutex> lock(mutex_);
+  entries_.clear();
+}
+
+}  // namespace trpc
@@ -0,0 +1,115 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "polaris/model.h"
+#include "polaris/provider.h"
+
+namespace trpc {
+
+/// @brief The heartbeat of a registered instance, whose request is built once when the instance is added
+struct HeartbeatTarget {
+  polaris::ServiceKey service_key;
+  std::unique_ptr<polaris::InstanceHeartbeatRequest> request;
+  /// The TTL of the instance, in milliseconds
+  uint64_t ttl{0};
+  /// The consecutive failed heartbeats of the instance, which is updated by the heartbeat callbacks
+  mutable std::atomic<uint32_t> failures{0};
+  /// Set when a heartbeat succeeds after the failed ones, and cleared when the registry reconciles the instance
+  mutable std::atomic<bool> recovered{false};
+};
+
+using HeartbeatTargetPtr = std::shared_ptr<const HeartbeatTarget>;
+
+/// @brief Schedules the heartbeats of all the registered instances of the process on one timer.
+///        Each instance is beaten in its own phase of the interval, which is derived from the key of the instance and
+///        aligned to the wall clock, so that the heartbeats of a fleet restarted together are spread over the interval.
+///        The interval of an instance is backed off exponentially while its heartbeats fail, up to a limit below its
+///        TTL.
+/// @note The timer is driven by the caller through TakeDue
+class HeartbeatScheduler {
+ public:
+  HeartbeatScheduler();
+
+  /// @param interval The heartbeat interval of each instance, in milliseconds
+  /// @param jitter The random jitter of the interval, in percent of the interval. A heartbeat is sent earlier than its
+  ///        phase by the jitter, and never later
+  /// @param backoff_limit The max backed off interval, in percent of the TTL of the instance
+  void SetConfig(uint64_t interval, uint32_t jitter, uint32_t backoff_limit);
+
+  /// @brief Make the key of an instance
+  static std::string MakeKey(const std::string& service_name, const std::string& host, int port);
+
+  /// @brief Get the phase of an instance in the interval, which is the same in all processes
+  static uint64_t GetPhase(const std::string& key, uint64_t interval);
+
+  /// @brief Add an instance, or replace the heartbeat of the instance. The first heartbeat is sent at the next phase
+  ///        of the instance
+  void Add(const std::string& key, HeartbeatTargetPtr target, uint64_t now_ms);
+
+  /// @brief Remove an instance
+  /// @return Whether the instance was added
+  bool Remove(const std::string& key);
+
+  bool Contains(const std::string& key) const;
+
+  std::size_t Size() const;
+
+  /// @brief Get the instances whose heartbeats are due and schedule their next heartbeats
+  std::vector<HeartbeatTargetPtr> TakeDue(uint64_t now_ms);
+
+  /// @brief Get the interval of the next heartbeat of the instance, which is backed off by its failed heartbeats
+  uint64_t GetBackoffInterval(const HeartbeatTarget& target) const;
+
+  void Clear();
+
+ private:
+  struct Entry {
+    HeartbeatTargetPtr target;
+    uint64_t phase{0};
+    // The phase time of the next heartbeat
+    uint64_t slot_ms{0};
+    uint64_t next_beat_ms{0};
+    // The phase time of the last heartbeat, 0 if the instance is not beaten yet
+    uint64_t last_slot_ms{0};
+  };
+
+  // Get the first time which is not earlier than `time_ms` in the phase
+  uint64_t AlignUp(uint64_t time_ms, uint64_t phase) const;
+
+  // Must be called with the lock held
+  void Schedule(Entry& entry, uint64_t slot_ms, uint64_t now_ms);
+
+  // Must be called with the lock held
+  uint64_t NextJitter(uint64_t max_jitter);
+
+ private:
+  uint64_t interval_{3000};
+  uint32_t jitter_{10};
+  uint32_t backoff_limit_{80};
+  mutable std::mutex mutex_;
+  std::unordered_map<std::string, Entry> entries_;
+  std::mt19937_64 random_;
+};
+
+}  // namespace trpc
@@ -0,0 +1,156 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_heartbeat_scheduler.h"
+
+#include <set>
+
+#include "gtest/gtest.h"
+
+namespace trpc {
+
+namespace {
+
+HeartbeatTargetPtr MakeTarget(const std::string& name, uint64_t ttl = 5000) {
+  auto target = std::make_shared<HeartbeatTarget>();
+  target->service_key = polaris::ServiceKey{"Test", name};
+  target->request = std::make_unique<polaris::InstanceHeartbeatRequest>("token", name + "_id");
+  target->ttl = ttl;
+  return target;
+}
+
+}  // namespace
+
+TEST(HeartbeatSchedulerTest, MakeKey) {
+  ASSERT_EQ("test.service/127.0.0.1:80", HeartbeatScheduler::MakeKey("test.service", "127.0.0.1", 80));
+}
+
+TEST(HeartbeatSchedulerTest, GetPhase) {
+  std::string key = HeartbeatScheduler::MakeKey("test.service", "127.0.0.1", 80);
+  ASSERT_EQ(HeartbeatScheduler::GetPhase(key, 1000), HeartbeatScheduler::GetPhase(key, 1000));
+  ASSERT_LT(HeartbeatScheduler::GetPhase(key, 1000), 1000);
+  ASSERT_EQ(0, HeartbeatScheduler::GetPhase(key, 0));
+
+  // The phases of the instances are spread over the interval
+  std::size_t first_half = 0;
+  for (int port = 0; port < 100; ++port) {
+    if (HeartbeatScheduler::GetPhase(HeartbeatScheduler::MakeKey("test.service", "127.0.0.1", port), 1000) < 500) {
+      ++first_half;
+    }
+  }
+  ASSERT_GT(first_half, 20);
+  ASSERT_LT(first_half, 80);
+}
+
+TEST(HeartbeatSchedulerTest, AddAndRemove) {
+  HeartbeatScheduler scheduler;
+  scheduler.SetConfig(1000, 10, 80);
+  scheduler.Add("a", MakeTarget("a"), 0);
+  scheduler.Add("b", MakeTarget("b"), 0);
+  // Replace the heartbeat of the instance
+  scheduler.Add("b", MakeTarget("b"), 0);
+  ASSERT_EQ(2, scheduler.Size());
+  ASSERT_TRUE(scheduler.Contains("a"));
+
+  ASSERT_TRUE(scheduler.Remove("a"));
+  ASSERT_FALSE(scheduler.Remove("a"));
+  ASSERT_FALSE(scheduler.Contains("a"));
+  ASSERT_EQ(1, scheduler.Size());
+
+  scheduler.Clear();
+  ASSERT_EQ(0, scheduler.Size());
+  ASSERT_TRUE(scheduler.TakeDue(10000).empty());
+}
+
+TEST(HeartbeatSchedulerTest, Phase) {
+  HeartbeatScheduler scheduler;
+  scheduler.SetConfig(1000, 0, 80);
+  uint64_t phase = HeartbeatScheduler::GetPhase("a", 1000);
+
+  // The first heartbeat is sent at the phase of the instance, whenever it is added
+  scheduler.Add("a", MakeTarget("a"), 100000 + phase + 1);
+  ASSERT_TRUE(scheduler.TakeDue(101000 + phase - 1).empty());
+  ASSERT_EQ(1, scheduler.TakeDue(101000 + phase).size());
+
+  // Beaten once per interval in the phase
+  ASSERT_TRUE(scheduler.TakeDue(102000 + phase - 1).empty());
+  ASSERT_EQ(1, scheduler.TakeDue(102000 + phase).size());
+
+  // The heartbeats missed by a late timer are sent once
+  ASSERT_EQ(1, scheduler.TakeDue(110000 + phase + 10).size());
+  ASSERT_TRUE(scheduler.TakeDue(111000 + phase - 1).empty());
+  ASSERT_EQ(1, scheduler.TakeDue(111000 + phase).size());
+}
+
+TEST(HeartbeatSchedulerTest, Jitter) {
+  HeartbeatScheduler scheduler;
+  scheduler.SetConfig(1000, 10, 80);
+  for (int i = 0; i < 100; ++i) {
+    scheduler.Add(std::to_string(i), MakeTarget(std::to_string(i)), 0);
+  }
+  ASSERT_EQ(100, scheduler.TakeDue(999).size());
+
+  // The heartbeats are sent earlier than the next phase by the jitter, and never later
+  std::set<std::string> beaten;
+  for (uint64_t now_ms = 1000; now_ms < 1900; ++now_ms) {
+    for (const auto& target : scheduler.TakeDue(now_ms)) {
+      uint64_t slot_ms = 1000 + HeartbeatScheduler::GetPhase(target->service_key.name_, 1000);
+      ASSERT_LE(now_ms, slot_ms);
+      ASSERT_GE(now_ms + 100, slot_ms);
+      ASSERT_TRUE(beaten.insert(target->service_key.name_).second);
+    }
+  }
+  for (int i = 0; i < 100; ++i) {
+    std::string key = std::to_string(i);
+    if (HeartbeatScheduler::GetPhase(key, 1000) < 800) {
+      ASSERT_EQ(1, beaten.count(key));
+    }
+  }
+}
+
+TEST(HeartbeatSchedulerTest, Backoff) {
+  HeartbeatScheduler scheduler;
+  scheduler.SetConfig(1000, 0, 80);
+  HeartbeatTargetPtr target = MakeTarget("a", 10000);
+  ASSERT_EQ(1000, scheduler.GetBackoffInterval(*target));
+
+  // Backed off exponentially, up to the limit of the TTL
+  target->failures = 1;
+  ASSERT_EQ(2000, scheduler.GetBackoffInterval(*target));
+  target->failures = 2;
+  ASSERT_EQ(4000, scheduler.GetBackoffInterval(*target));
+  target->failures = 3;
+  ASSERT_EQ(8000, scheduler.GetBackoffInterval(*target));
+  target->failures = 100;
+  ASSERT_EQ(8000, scheduler.GetBackoffInterval(*target));
+
+  // The limit is not greater than the interval
+  HeartbeatTargetPtr short_ttl_target = MakeTarget("b", 1000);
+  short_ttl_target->failures = 3;
+  ASSERT_EQ(1000, scheduler.GetBackoffInterval(*short_ttl_target));
+
+  uint64_t phase = HeartbeatScheduler::GetPhase("a", 1000);
+  target->failures = 2;
+  scheduler.Add("a", target, 0);
+  ASSERT_EQ(1, scheduler.TakeDue(phase).size());
+  ASSERT_TRUE(scheduler.TakeDue(phase + 1000).empty());
+  ASSERT_TRUE(scheduler.TakeDue(phase + 3999).empty());
+  ASSERT_EQ(1, scheduler.TakeDue(phase + 4000).size());
+
+  // Recovered
+  target->failures = 0;
+  ASSERT_TRUE(scheduler.TakeDue(phase + 4999).empty());
+  ASSERT_EQ(1, scheduler.TakeDue(phase + 5000).size());
+}
+
+}  // namespace trpc
@@ -0,0 +1,175 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_hedging.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace trpc {
+
+std::size_t LatencySketch::BucketIndex(uint64_t value) {
+  if (value < 16) {
+    return static_cast<std::size_t>(value);
+  }
+  // The highest bit selects the power of two, the next 3 bits select the bucket in it
+  std::size_t msb = 63 - __builtin_clzll(value);
+  std::size_t sub = (value >> (msb - 3)) & 7;
+  return 16 + (msb - 4) * 8 + sub;
+}
+
+uint64_t LatencySketch::BucketUpperBound(std::size_t index) {
+  if (index < 16) {
+    return index;
+  }
+  std::size_t msb = (index - 16) / 8 + 4;
+  std::size_t sub = (index - 16) % 8;
+  std::size_t shift = msb - 3;
+  return ((8 + sub) << shift) + (uint64_t{1} << shift) - 1;
+}
+
+void LatencySketch::Window::Reset() {
+  for (auto& bucket : buckets) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  count.store(0, std::memory_order_relaxed);
+}
+
+void LatencySketch::Rotate(uint64_t now_ms) {
+  if (now_ms < window_start_ms_.load(std::memory_order_acquire) + window_ms_) {
+    return;
+  }
+
+  std::scoped_lock<std::mutex> lock(rotate_mutex_);
+  uint64_t window_start_ms = window_start_ms_.load(std::memory_order_relaxed);
+  if (now_ms < window_start_ms + window_ms_) {
+    return;
+  }
+  if (now_ms >= window_start_ms + 2 * window_ms_) {
+    // Both windows are expired
+    windows_[0].Reset();
+    windows_[1].Reset();
+    window_start_ms = now_ms;
+  } else {
+    uint32_t next = 1 - current_.load(std::memory_order_relaxed);
+    windows_[next].Reset();
+    current_.store(next, std::memory_order_relaxed);
+    window_start_ms += window_ms_;
+  }
+  window_start_ms_.store(window_start_ms, std::memory_order_release);
+}
+
+void LatencySketch::Record(uint64_t latency_ms, uint64_t now_ms) {
+  Rotate(now_ms);
+  // A sample racing with the rotation may be dropped, which is acceptable for the statistics
+  Window& window = windows_[current_.load(std::memory_order_relaxed)];
+  window.buckets[BucketIndex(latency_ms)].fetch_add(1, std::memory_order_relaxed);
+  window.count.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t LatencySketch::Count(uint64_t now_ms) {
+  Rotate(now_ms);
+  return windows_[0].count.load(std::memory_order_relaxed) + windows_[1].count.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencySketch::Quantile(double q, uint64_t now_ms) {
+  uint64_t total = Count(now_ms);
+  if (total == 0) {
+    return 0;
+  }
+
+  uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(std::min(q, 1.0) * total)));
+  uint64_t cumulative = 0;
+  for (std::size_t i = 0; i < kBucketNum; ++i) {
+    cumulative += windows_[0].buckets[i].load(std::memory_order_relaxed) +
+                  windows_[1].buckets[i].load(std::memory_order_relaxed);
+    if (cumulative >= rank) {
+      return BucketUpperBound(i);
+    }
+  }
+  // The buckets are updated after the count
+  return BucketUpperBound(kBucketNum - 1);
+}
+
+bool LatencySketchTable::GetPercentile(const std::string& key, uint32_t percentile, uint64_t min_samples,
+                                       uint64_t now_ms, uint64_t& latency) {
+  LatencySketchPtr sketch;
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = sketches_.find(key);
+    if (it == sketches_.end()) {
+      return false;
+    }
+    sketch = it->second;
+  }
+
+  // Too few samples to tell the tail latency
+  if (sketch->Count(now_ms) < std::max<uint64_t>(min_samples, 1)) {
+    return false;
+  }
+  latency = sketch->Quantile(percentile / 100.0, now_ms);
+  return true;
+}
+
+void LatencySketchTable::Record(const std::string& key, uint64_t latency_ms, uint64_t now_ms) {
+  GetOrCreate(key)->Record(latency_ms, now_ms);
+}
+
+LatencySketchPtr LatencySketchTable::GetOrCreate(const std::string& key) {
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = sketches_.find(key);
+    if (it != sketches_.end()) {
+      return it->second;
+    }
+  }
+
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  LatencySketchPtr& sketch = sketches_[key];
+  if (sketch == nullptr) {
+    sketch = std::make_shared<LatencySketch>(window_ms_);
+  }
+  return sketch;
+}
+
+void LatencySketchTable::Clear() {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  sketches_.clear();
+}
+
+void HedgingPolicy::SetConfig(const naming::HedgingConfig& config) {
+  config_ = config;
+  config_.percentile = std::clamp<uint32_t>(config_.percentile, 1, 99);
+  config_.max_delay = std::max(config_.min_delay, config_.max_delay);
+  sketches_.SetWindow(config_.window);
+}
+
+uint64_t HedgingPolicy::GetDelay(const std::string& service_name, uint64_t now_ms) {
+  if (!Enabled()) {
+    return 0;
+  }
+
+  uint64_t latency = 0;
+  if (!sketches_.GetPercentile(service_name, config_.percentile, config_.min_samples, now_ms, latency)) {
+    return 0;
+  }
+  return std::clamp(latency, config_.min_delay, config_.max_delay);
+}
+
+void HedgingPolicy::RecordLatency(const std::string& service_name, uint64_t latency_ms, uint64_t now_ms) {
+  sketches_.Record(service_name, latency_ms, now_ms);
+}
+
+void HedgingPolicy::Clear() { sketches_.Clear(); }
+
+}  // namespace trpc
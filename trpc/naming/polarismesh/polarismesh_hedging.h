@@ -0,0 +1,119 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+#include "trpc/naming/polarismesh/config/polarismesh_naming_conf.h"
+
+namespace trpc {
+
+/// @brief A lock-free latency histogram with log-linear buckets (relative error within 12.5%), the samples of the
+///        current and the previous window are counted
+class LatencySketch {
+ public:
+  /// Values less than 16 have their own buckets, larger values are divided into 8 buckets per power of two
+  static constexpr std::size_t kBucketNum = 16 + 60 * 8;
+
+  explicit LatencySketch(uint64_t window_ms) : window_ms_(window_ms == 0 ? 1 : window_ms) {}
+
+  void Record(uint64_t latency_ms, uint64_t now_ms);
+
+  /// @brief Get the quantile of the latency
+  /// @param q The quantile, range: (0, 1]
+  /// @return The upper bound of the bucket of the quantile, 0 if there is no sample
+  uint64_t Quantile(double q, uint64_t now_ms);
+
+  /// @brief Get the number of the samples
+  uint64_t Count(uint64_t now_ms);
+
+  static std::size_t BucketIndex(uint64_t value);
+
+  static uint64_t BucketUpperBound(std::size_t index);
+
+ private:
+  struct Window {
+    std::array<std::atomic<uint64_t>, kBucketNum> buckets{};
+    std::atomic<uint64_t> count{0};
+
+    void Reset();
+  };
+
+  void Rotate(uint64_t now_ms);
+
+ private:
+  uint64_t window_ms_;
+  std::array<Window, 2> windows_;
+  std::atomic<uint32_t> current_{0};
+  std::atomic<uint64_t> window_start_ms_{0};
+  std::mutex rotate_mutex_;
+};
+
+using LatencySketchPtr = std::shared_ptr<LatencySketch>;
+
+/// @brief The latency sketches of the callee services or methods, shared by the hedging delay and the adaptive timeout
+class LatencySketchTable {
+ public:
+  /// @brief Set the window of the sketches created later
+  void SetWindow(uint64_t window_ms) { window_ms_ = window_ms; }
+
+  /// @brief Get the latency percentile of the key
+  /// @param percentile The percentile, range: 1-99
+  /// @return false if there are fewer samples than min_samples (at least 1) in the window
+  bool GetPercentile(const std::string& key, uint32_t percentile, uint64_t min_samples, uint64_t now_ms,
+                     uint64_t& latency);
+
+  void Record(const std::string& key, uint64_t latency_ms, uint64_t now_ms);
+
+  void Clear();
+
+ private:
+  LatencySketchPtr GetOrCreate(const std::string& key);
+
+ private:
+  uint64_t window_ms_{0};
+  std::shared_mutex mutex_;
+  std::unordered_map<std::string, LatencySketchPtr> sketches_;
+};
+
+/// @brief Decides the delay of the hedged (backup) request of the callee services by their observed latency
+class HedgingPolicy {
+ public:
+  void SetConfig(const naming::HedgingConfig& config);
+
+  bool Enabled() const { return config_.enable; }
+
+  const naming::HedgingConfig& GetConfig() const { return config_; }
+
+  /// @brief Get the hedging delay of the service
+  /// @return The latency percentile clamped by the delay bounds, 0 if there are not enough samples to hedge
+  uint64_t GetDelay(const std::string& service_name, uint64_t now_ms);
+
+  void RecordLatency(const std::string& service_name, uint64_t latency_ms, uint64_t now_ms);
+
+  void Clear();
+
+ private:
+  naming::HedgingConfig config_;
+  LatencySketchTable sketches_;
+};
+
+}  // namespace trpc
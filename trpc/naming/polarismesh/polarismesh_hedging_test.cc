@@ -0,0 +1,132 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_hedging.h"
+
+#include "gtest/gtest.h"
+
+namespace trpc {
+
+TEST(LatencySketchTest, Buckets) {
+  for (uint64_t value = 0; value < 100000; ++value) {
+    std::size_t index = LatencySketch::BucketIndex(value);
+    ASSERT_LT(index, LatencySketch::kBucketNum);
+    ASSERT_LE(value, LatencySketch::BucketUpperBound(index));
+    // Relative error is bounded
+    ASSERT_LE(LatencySketch::BucketUpperBound(index) - value, value / 8 + 1);
+  }
+  ASSERT_EQ(LatencySketch::kBucketNum - 1, LatencySketch::BucketIndex(UINT64_MAX));
+  ASSERT_EQ(UINT64_MAX, LatencySketch::BucketUpperBound(LatencySketch::kBucketNum - 1));
+}
+
+TEST(LatencySketchTest, Quantile) {
+  LatencySketch sketch(1000);
+  ASSERT_EQ(0, sketch.Quantile(0.95, 100));
+
+  for (uint64_t i = 1; i <= 100; ++i) {
+    sketch.Record(i, 100);
+  }
+  ASSERT_EQ(100, sketch.Count(100));
+  uint64_t p95 = sketch.Quantile(0.95, 100);
+  ASSERT_GE(p95, 95);
+  ASSERT_LE(p95, 95 + 95 / 8);
+  ASSERT_EQ(10, sketch.Quantile(0.1, 100));
+}
+
+TEST(LatencySketchTest, Window) {
+  LatencySketch sketch(1000);
+  for (int i = 0; i < 10; ++i) {
+    sketch.Record(100, 100);
+  }
+
+  // The samples of the previous window are still counted
+  sketch.Record(10, 1200);
+  ASSERT_EQ(11, sketch.Count(1200));
+
+  // The first samples are expired
+  ASSERT_EQ(1, sketch.Count(2200));
+  ASSERT_EQ(10, sketch.Quantile(0.95, 2200));
+
+  // All samples are expired
+  ASSERT_EQ(0, sketch.Count(5000));
+}
+
+TEST(LatencySketchTableTest, GetPercentile) {
+  LatencySketchTable table;
+  table.SetWindow(1000);
+  uint64_t latency = 0;
+  ASSERT_FALSE(table.GetPercentile("test.service", 50, 2, 100, latency));
+
+  table.Record("test.service", 0, 100);
+  ASSERT_FALSE(table.GetPercentile("test.service", 50, 2, 100, latency));
+  // A percentile of 0 ms is still a percentile
+  table.Record("test.service", 0, 100);
+  ASSERT_TRUE(table.GetPercentile("test.service", 50, 2, 100, latency));
+  ASSERT_EQ(0, latency);
+  // At least one sample is required
+  ASSERT_FALSE(table.GetPercentile("other.service", 50, 0, 100, latency));
+  table.Record("other.service", 10, 100);
+  ASSERT_TRUE(table.GetPercentile("other.service", 50, 0, 100, latency));
+  ASSERT_EQ(10, latency);
+
+  // The samples expire with the window
+  ASSERT_FALSE(table.GetPercentile("test.service", 50, 2, 5000, latency));
+
+  table.Clear();
+  ASSERT_FALSE(table.GetPercentile("other.service", 50, 0, 100, latency));
+}
+
+TEST(HedgingPolicyTest, GetDelay) {
+  naming::HedgingConfig config;
+  config.enable = true;
+  config.percentile = 95;
+  config.min_samples = 10;
+  config.min_delay = 5;
+  config.max_delay = 50;
+  HedgingPolicy policy;
+  policy.SetConfig(config);
+  ASSERT_TRUE(policy.Enabled());
+  ASSERT_EQ(0, policy.GetDelay("test.service", 100));
+
+  // Not enough samples
+  for (int i = 0; i < 9; ++i) {
+    policy.RecordLatency("test.service", 20, 100);
+  }
+  ASSERT_EQ(0, policy.GetDelay("test.service", 100));
+  policy.RecordLatency("test.service", 20, 100);
+  uint64_t delay = policy.GetDelay("test.service", 100);
+  ASSERT_GE(delay, 20);
+  ASSERT_LE(delay, 23);
+  ASSERT_EQ(0, policy.GetDelay("other.service", 100));
+
+  // Clamped by the bounds
+  for (int i = 0; i < 100; ++i) {
+    policy.RecordLatency("slow.service", 1000, 100);
+    policy.RecordLatency("fast.service", 1, 100);
+  }
+  ASSERT_EQ(50, policy.GetDelay("slow.service", 100));
+  ASSERT_EQ(5, policy.GetDelay("fast.service", 100));
+
+  policy.Clear();
+  ASSERT_EQ(0, policy.GetDelay("test.service", 100));
+}
+
+TEST(HedgingPolicyTest, Disabled) {
+  HedgingPolicy policy;
+  policy.SetConfig(naming::HedgingConfig());
+  ASSERT_FALSE(policy.Enabled());
+  policy.RecordLatency("test.service", 20, 100);
+  ASSERT_EQ(0, policy.GetDelay("test.service", 100));
+}
+
+}  // namespace trpc
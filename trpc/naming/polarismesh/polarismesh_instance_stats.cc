@@ -0,0 +1,84 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_instance_stats.h"
+
+#include <mutex>
+
+#include "trpc/naming/polarismesh/polarismesh_locality_breaker.h"
+
+namespace trpc {
+
+InstanceStatsPtr InstanceStatsTable::GetOrCreate(const polaris::Instance& instance, uint64_t now_ms) {
+  uint64_t local_id = instance.GetLocalId();
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = stats_.find(local_id);
+    if (it != stats_.end()) {
+      it->second->last_active_ms.store(now_ms, std::memory_order_relaxed);
+      return it->second;
+    }
+  }
+
+  auto stats = std::make_shared<InstanceStats>();
+  stats->local_id = local_id;
+  stats->instance_id = instance.GetId();
+  stats->host = instance.GetHost();
+  stats->port = instance.GetPort();
+  stats->region = instance.GetRegion();
+  stats->zone = instance.GetZone();
+  stats->campus = instance.GetCampus();
+  stats->set_name = GetInstanceSetName(instance);
+  stats->last_active_ms.store(now_ms, std::memory_order_relaxed);
+
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  // Another thread may have inserted the same instance, keep the existing one
+  auto result = stats_.emplace(local_id, std::move(stats));
+  return result.first->second;
+}
+
+InstanceStatsPtr InstanceStatsTable::Find(uint64_t local_id) const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  auto it = stats_.find(local_id);
+  if (it != stats_.end()) {
+    return it->second;
+  }
+  return nullptr;
+}
+
+std::size_t InstanceStatsTable::EvictIdle(uint64_t now_ms, uint64_t idle_ms) {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  std::size_t evicted = 0;
+  for (auto it = stats_.begin(); it != stats_.end();) {
+    uint64_t last_active_ms = it->second->last_active_ms.load(std::memory_order_relaxed);
+    if (last_active_ms + idle_ms < now_ms) {
+      it = stats_.erase(it);
+      ++evicted;
+    } else {
+      ++it;
+    }
+  }
+  return evicted;
+}
+
+std::size_t InstanceStatsTable::Size() const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  return stats_.size();
+}
+
+void InstanceStatsTable::Clear() {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  stats_.clear();
+}
+
+}  // namespace trpc
@@ -0,0 +1,108 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+#include "polaris/model.h"
+
+#include "trpc/naming/polarismesh/polarismesh_concurrency_limit.h"
+
+namespace trpc {
+
+/// @brief Call statistics of one callee instance, kept on the plugin side
+/// @note The entry also keeps the polarismesh instance id, so that the call result can be reported to the SDK by id
+///       instead of letting the SDK search the instance by host and port
+struct InstanceStats {
+  /// The local id of the instance assigned by the SDK
+  uint64_t local_id{0};
+  /// The polarismesh instance id
+  std::string instance_id;
+  std::string host;
+  int port{0};
+  /// The locality of the instance
+  std::string region;
+  std::string zone;
+  std::string campus;
+  /// The set name of the instance, empty if the set is not enabled
+  std::string set_name;
+
+  std::atomic<uint64_t> total_calls{0};
+  std::atomic<uint64_t> failed_calls{0};
+  /// Sum of the call delay, unit: ms
+  std::atomic<uint64_t> total_delay{0};
+  /// Last time the instance is selected or reported, unit: ms
+  std::atomic<uint64_t> last_active_ms{0};
+  /// Requests which are selected but not reported yet
+  std::atomic<int64_t> inflight{0};
+  /// The adaptive concurrency limit of the instance
+  ConcurrencyLimit concurrency_limit;
+
+  /// @brief Whether the entry describes the instance listening on host:port
+  bool Match(const std::string& ip, int listen_port) const { return port == listen_port && host == ip; }
+
+  /// @brief Get the in-flight requests
+  uint64_t GetInflight() const {
+    int64_t value = inflight.load(std::memory_order_relaxed);
+    return value > 0 ? static_cast<uint64_t>(value) : 0;
+  }
+
+  /// @brief Release an in-flight request without recording the result
+  void ReleaseInflight() { inflight.fetch_sub(1, std::memory_order_relaxed); }
+
+  /// @brief Record the result of one call, and release the in-flight request
+  void RecordCall(bool success, uint64_t delay, uint64_t now_ms) {
+    ReleaseInflight();
+    total_calls.fetch_add(1, std::memory_order_relaxed);
+    if (!success) {
+      failed_calls.fetch_add(1, std::memory_order_relaxed);
+    }
+    total_delay.fetch_add(delay, std::memory_order_relaxed);
+    last_active_ms.store(now_ms, std::memory_order_relaxed);
+  }
+};
+
+using InstanceStatsPtr = std::shared_ptr<InstanceStats>;
+
+/// @brief Per-instance statistics indexed directly by the local id of the instance
+class InstanceStatsTable {
+ public:
+  /// @brief Get the statistics of the instance, create it when the instance is seen for the first time
+  /// @param instance The service instance returned by the SDK
+  /// @param now_ms Current time, unit: ms
+  InstanceStatsPtr GetOrCreate(const polaris::Instance& instance, uint64_t now_ms);
+
+  /// @brief Find the statistics by local id
+  /// @return nullptr if the instance has never been selected (or has been evicted)
+  InstanceStatsPtr Find(uint64_t local_id) const;
+
+  /// @brief Remove the entries that have not been selected or reported for idle_ms
+  /// @return The number of removed entries
+  std::size_t EvictIdle(uint64_t now_ms, uint64_t idle_ms);
+
+  std::size_t Size() const;
+
+  void Clear();
+
+ private:
+  mutable std::shared_mutex mutex_;
+  std::unordered_map<uint64_t, InstanceStatsPtr> stats_;
+};
+
+}  // namespace trpc
@@ -0,0 +1,70 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_instance_stats.h"
+
+#include "gtest/gtest.h"
+
+namespace trpc {
+
+TEST(InstanceStatsTableTest, GetOrCreateAndFind) {
+  InstanceStatsTable table;
+  polaris::Instance instance("instance_1", "127.0.0.1", 10001, 100);
+
+  InstanceStatsPtr stats = table.GetOrCreate(instance, 1000);
+  ASSERT_TRUE(stats != nullptr);
+  ASSERT_EQ("instance_1", stats->instance_id);
+  ASSERT_EQ("127.0.0.1", stats->host);
+  ASSERT_EQ(10001, stats->port);
+  ASSERT_TRUE(stats->Match("127.0.0.1", 10001));
+  ASSERT_FALSE(stats->Match("127.0.0.1", 10002));
+
+  // The same instance shares one entry
+  ASSERT_EQ(stats.get(), table.GetOrCreate(instance, 2000).get());
+  ASSERT_EQ(stats.get(), table.Find(instance.GetLocalId()).get());
+  ASSERT_EQ(1, table.Size());
+  ASSERT_EQ(2000, stats->last_active_ms.load());
+}
+
+TEST(InstanceStatsTableTest, RecordCall) {
+  InstanceStatsTable table;
+  polaris::Instance instance("instance_1", "127.0.0.1", 10001, 100);
+  InstanceStatsPtr stats = table.GetOrCreate(instance, 1000);
+  stats->inflight.fetch_add(2);
+  ASSERT_EQ(2, stats->GetInflight());
+
+  stats->RecordCall(true, 10, 1001);
+  stats->RecordCall(false, 30, 1002);
+  ASSERT_EQ(2, stats->total_calls.load());
+  ASSERT_EQ(1, stats->failed_calls.load());
+  ASSERT_EQ(40, stats->total_delay.load());
+  ASSERT_EQ(1002, stats->last_active_ms.load());
+  // The in-flight requests are released by the results
+  ASSERT_EQ(0, stats->GetInflight());
+  stats->ReleaseInflight();
+  ASSERT_EQ(0, stats->GetInflight());
+}
+
+TEST(InstanceStatsTableTest, EvictIdle) {
+  InstanceStatsTable table;
+  polaris::Instance instance("instance_1", "127.0.0.1", 10001, 100);
+  table.GetOrCreate(instance, 1000);
+
+  ASSERT_EQ(0, table.EvictIdle(1500, 1000));
+  ASSERT_EQ(1, table.Size());
+  ASSERT_EQ(1, table.EvictIdle(3000, 1000));
+  ASSERT_EQ(0, table.Size());
+  ASSERT_TRUE(table.Find(instance.GetLocalId()) == nullptr);
+}
+
+}  // namespace trpc
@@ -0,0 +1,174 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_instance_watcher.h"
+
+#include <utility>
+
+#include "trpc/naming/polarismesh/common.h"
+
+namespace trpc {
+
+namespace {
+
+bool IsEndpointChanged(const TrpcEndpointInfo& lhs, const TrpcEndpointInfo& rhs) {
+  return lhs.host != rhs.host || lhs.port != rhs.port || lhs.is_ipv6 != rhs.is_ipv6 || lhs.status != rhs.status ||
+         lhs.weight != rhs.weight || lhs.meta != rhs.meta;
+}
+
+void FillFullDelta(const polaris::ServiceKey& service_key, const std::string& revision,
+                   const std::map<std::string, TrpcEndpointInfo>& instances, InstanceDelta& delta) {
+  delta.service_name = service_key.name_;
+  delta.service_namespace = service_key.namespace_;
+  delta.revision = revision;
+  delta.added.reserve(instances.size());
+  for (const auto& item : instances) {
+    delta.added.push_back(item.second);
+  }
+}
+
+}  // namespace
+
+uint64_t InstanceWatcher::AddSubscriber(const polaris::ServiceKey& service_key, InstanceDeltaCallback callback) {
+  std::scoped_lock<std::mutex> lock(mutex_);
+  uint64_t subscription_id = next_subscription_id_++;
+  Subscriber subscriber;
+  subscriber.callback = std::move(callback);
+  services_[service_key].subscribers.emplace(subscription_id, std::move(subscriber));
+  subscriptions_.emplace(subscription_id, service_key);
+  return subscription_id;
+}
+
+bool InstanceWatcher::RemoveSubscriber(uint64_t subscription_id) {
+  std::scoped_lock<std::mutex> lock(mutex_);
+  auto it = subscriptions_.find(subscription_id);
+  if (it == subscriptions_.end()) {
+    return false;
+  }
+
+  auto service_it = services_.find(it->second);
+  if (service_it != services_.end()) {
+    service_it->second.subscribers.erase(subscription_id);
+    if (service_it->second.subscribers.empty()) {
+      services_.erase(service_it);
+    }
+  }
+  subscriptions_.erase(it);
+  return true;
+}
+
+std::vector<polaris::ServiceKey> InstanceWatcher::GetWatchedServices() const {
+  std::scoped_lock<std::mutex> lock(mutex_);
+  std::vector<polaris::ServiceKey> service_keys;
+  service_keys.reserve(services_.size());
+  for (const auto& item : services_) {
+    service_keys.push_back(item.first);
+  }
+  return service_keys;
+}
+
+void InstanceWatcher::OnInstancesUpdate(const polaris::ServiceKey& service_key, const std::string& revision,
+                                        const std::vector<polaris::Instance>& instances) {
+  if (!NeedUpdate(service_key, revision)) {
+    return;
+  }
+
+  std::vector<TrpcEndpointInfo> endpoints;
+  // Isolated instances or instances with weight 0 are not available for calling
+  ConvertInstancesNoIsolated(instances, endpoints);
+  OnEndpointsUpdate(service_key, revision, endpoints);
+}
+
+void InstanceWatcher::OnEndpointsUpdate(const polaris::ServiceKey& service_key, const std::string& revision,
+                                        const std::vector<TrpcEndpointInfo>& endpoints) {
+  std::vector<std::pair<InstanceDeltaCallback, InstanceDelta>> notifications;
+  {
+    std::scoped_lock<std::mutex> lock(mutex_);
+    auto service_it = services_.find(service_key);
+    if (service_it == services_.end()) {
+      return;
+    }
+    ServiceState& state = service_it->second;
+
+    InstanceDelta delta;
+    if (revision != state.revision) {
+      std::map<std::string, TrpcEndpointInfo> latest;
+      for (const auto& endpoint : endpoints) {
+        latest.emplace(GetEndpointInstanceId(endpoint), endpoint);
+      }
+
+      for (const auto& item : latest) {
+        auto it = state.instances.find(item.first);
+        if (it == state.instances.end()) {
+          delta.added.push_back(item.second);
+        } else if (IsEndpointChanged(it->second, item.second)) {
+          delta.modified.push_back(item.second);
+        }
+      }
+      for (const auto& item : state.instances) {
+        if (latest.find(item.first) == latest.end()) {
+          delta.removed.push_back(item.second);
+        }
+      }
+
+      delta.service_name = service_key.name_;
+      delta.service_namespace = service_key.namespace_;
+      delta.revision = revision;
+      state.revision = revision;
+      state.instances = std::move(latest);
+    }
+
+    for (auto& item : state.subscribers) {
+      Subscriber& subscriber = item.second;
+      if (!subscriber.synced) {
+        InstanceDelta full_delta;
+        FillFullDelta(service_key, state.revision, state.instances, full_delta);
+        notifications.emplace_back(subscriber.callback, std::move(full_delta));
+        subscriber.synced = true;
+      } else if (!delta.Empty()) {
+        notifications.emplace_back(subscriber.callback, delta);
+      }
+    }
+  }
+
+  for (auto& item : notifications) {
+    item.first(item.second);
+  }
+}
+
+bool InstanceWatcher::NeedUpdate(const polaris::ServiceKey& service_key, const std::string& revision) const {
+  std::scoped_lock<std::mutex> lock(mutex_);
+  auto service_it = services_.find(service_key);
+  if (service_it == services_.end()) {
+    return false;
+  }
+
+  const ServiceState& state = service_it->second;
+  if (revision != state.revision) {
+    return true;
+  }
+  for (const auto& item : state.subscribers) {
+    if (!item.second.synced) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void InstanceWatcher::Clear() {
+  std::scoped_lock<std::mutex> lock(mutex_);
+  services_.clear();
+  subscriptions_.clear();
+}
+
+}  // namespace trpc
@@ -0,0 +1,102 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "polaris/model.h"
+
+#include "trpc/naming/common/common_defs.h"
+
+namespace trpc {
+
+/// @brief Instance changes of a service between two revisions
+struct InstanceDelta {
+  std::string service_name;
+  std::string service_namespace;
+  /// The revision of the instance set after applying the delta
+  std::string revision;
+  /// Instances which are newly available
+  std::vector<TrpcEndpointInfo> added;
+  /// Instances which are removed, isolated or whose weight becomes 0
+  std::vector<TrpcEndpointInfo> removed;
+  /// Instances whose address, weight, health status or metadata is changed
+  std::vector<TrpcEndpointInfo> modified;
+
+  bool Empty() const { return added.empty() && removed.empty() && modified.empty(); }
+};
+
+/// @brief The callback to receive the instance changes, the first delta of a subscription contains all the instances
+///        as added
+using InstanceDeltaCallback = std::function<void(const InstanceDelta&)>;
+
+/// @brief Keeps the last instance set of the watched services and dispatches the deltas to the subscribers
+class InstanceWatcher {
+ public:
+  /// @brief Add a subscriber of the service
+  /// @return The subscription id, never be 0
+  uint64_t AddSubscriber(const polaris::ServiceKey& service_key, InstanceDeltaCallback callback);
+
+  /// @brief Remove a subscriber, the service is no longer watched when it has no subscribers
+  /// @return false if the subscription does not exist
+  bool RemoveSubscriber(uint64_t subscription_id);
+
+  /// @brief Get the services which have subscribers
+  std::vector<polaris::ServiceKey> GetWatchedServices() const;
+
+  /// @brief Feed the latest instances of the service
+  /// @note Nothing is computed if the revision is unchanged and all subscribers are synced. Callbacks are invoked in
+  ///       the calling thread, without holding the internal lock
+  void OnInstancesUpdate(const polaris::ServiceKey& service_key, const std::string& revision,
+                         const std::vector<polaris::Instance>& instances);
+
+  /// @brief Feed the latest available endpoints of the service, e.g. the endpoints after flap damping
+  /// @param endpoints The endpoints converted by ConvertPolarisInstance, isolated ones or ones with weight 0 are
+  ///        expected to be filtered out
+  void OnEndpointsUpdate(const polaris::ServiceKey& service_key, const std::string& revision,
+                         const std::vector<TrpcEndpointInfo>& endpoints);
+
+  void Clear();
+
+ private:
+  struct Subscriber {
+    InstanceDeltaCallback callback;
+    // Whether the subscriber has received the full instance set
+    bool synced{false};
+  };
+
+  struct ServiceState {
+    std::string revision;
+    // Available instances of the last revision, key is the polarismesh instance id
+    std::map<std::string, TrpcEndpointInfo> instances;
+    std::map<uint64_t, Subscriber> subscribers;
+  };
+
+  // Whether the revision is changed or some subscribers are not synced
+  bool NeedUpdate(const polaris::ServiceKey& service_key, const std::string& revision) const;
+
+ private:
+  mutable std::mutex mutex_;
+  uint64_t next_subscription_id_{1};
+  std::map<polaris::ServiceKey, ServiceState> services_;
+  std::unordered_map<uint64_t, polaris::ServiceKey> subscriptions_;
+};
+
+}  // namespace trpc
@@ -0,0 +1,136 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_instance_watcher.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace trpc {
+
+class InstanceWatcherTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    service_key_.namespace_ = "Test";
+    service_key_.name_ = "test.service";
+  }
+
+  uint64_t Subscribe() {
+    return watcher_.AddSubscriber(service_key_, [this](const InstanceDelta& delta) { deltas_.push_back(delta); });
+  }
+
+ protected:
+  InstanceWatcher watcher_;
+  polaris::ServiceKey service_key_;
+  std::vector<InstanceDelta> deltas_;
+};
+
+TEST_F(InstanceWatcherTest, FirstDeltaIsFullSet) {
+  uint64_t id = Subscribe();
+  ASSERT_NE(0, id);
+  ASSERT_EQ(1, watcher_.GetWatchedServices().size());
+
+  std::vector<polaris::Instance> instances;
+  instances.emplace_back("instance_1", "127.0.0.1", 10001, 100);
+  instances.emplace_back("instance_2", "127.0.0.1", 10002, 100);
+  // Weight 0 instance is not available
+  instances.emplace_back("instance_3", "127.0.0.1", 10003, 0);
+  watcher_.OnInstancesUpdate(service_key_, "rev1", instances);
+
+  ASSERT_EQ(1, deltas_.size());
+  ASSERT_EQ("rev1", deltas_[0].revision);
+  ASSERT_EQ("test.service", deltas_[0].service_name);
+  ASSERT_EQ(2, deltas_[0].added.size());
+  ASSERT_TRUE(deltas_[0].removed.empty());
+  ASSERT_TRUE(deltas_[0].modified.empty());
+
+  // Same revision, nothing is delivered
+  watcher_.OnInstancesUpdate(service_key_, "rev1", instances);
+  ASSERT_EQ(1, deltas_.size());
+}
+
+TEST_F(InstanceWatcherTest, DeltaBetweenRevisions) {
+  Subscribe();
+
+  std::vector<polaris::Instance> instances;
+  instances.emplace_back("instance_1", "127.0.0.1", 10001, 100);
+  instances.emplace_back("instance_2", "127.0.0.1", 10002, 100);
+  watcher_.OnInstancesUpdate(service_key_, "rev1", instances);
+  ASSERT_EQ(1, deltas_.size());
+
+  std::vector<polaris::Instance> new_instances;
+  new_instances.emplace_back("instance_2", "127.0.0.1", 10002, 50);
+  new_instances.emplace_back("instance_3", "127.0.0.1", 10003, 100);
+  watcher_.OnInstancesUpdate(service_key_, "rev2", new_instances);
+
+  ASSERT_EQ(2, deltas_.size());
+  const InstanceDelta& delta = deltas_[1];
+  ASSERT_EQ("rev2", delta.revision);
+  ASSERT_EQ(1, delta.added.size());
+  ASSERT_EQ(10003, delta.added[0].port);
+  ASSERT_EQ(1, delta.removed.size());
+  ASSERT_EQ(10001, delta.removed[0].port);
+  ASSERT_EQ(1, delta.modified.size());
+  ASSERT_EQ(50, delta.modified[0].weight);
+}
+
+TEST_F(InstanceWatcherTest, LateSubscriberGetsFullSet) {
+  Subscribe();
+  std::vector<polaris::Instance> instances;
+  instances.emplace_back("instance_1", "127.0.0.1", 10001, 100);
+  watcher_.OnInstancesUpdate(service_key_, "rev1", instances);
+  ASSERT_EQ(1, deltas_.size());
+
+  std::vector<InstanceDelta> late_deltas;
+  watcher_.AddSubscriber(service_key_, [&late_deltas](const InstanceDelta& delta) { late_deltas.push_back(delta); });
+  watcher_.OnInstancesUpdate(service_key_, "rev1", instances);
+  // Only the new subscriber gets the full set
+  ASSERT_EQ(1, deltas_.size());
+  ASSERT_EQ(1, late_deltas.size());
+  ASSERT_EQ(1, late_deltas[0].added.size());
+}
+
+TEST_F(InstanceWatcherTest, EndpointsUpdate) {
+  Subscribe();
+
+  TrpcEndpointInfo endpoint;
+  endpoint.host = "127.0.0.1";
+  endpoint.port = 10001;
+  endpoint.status = true;
+  endpoint.weight = 100;
+  endpoint.meta["instance_id"] = "instance_1";
+  watcher_.OnEndpointsUpdate(service_key_, "1", {endpoint});
+  ASSERT_EQ(1, deltas_.size());
+  ASSERT_EQ(1, deltas_[0].added.size());
+
+  endpoint.status = false;
+  watcher_.OnEndpointsUpdate(service_key_, "2", {endpoint});
+  ASSERT_EQ(2, deltas_.size());
+  ASSERT_EQ(1, deltas_[1].modified.size());
+  ASSERT_EQ(0, deltas_[1].modified[0].status);
+}
+
+TEST_F(InstanceWatcherTest, RemoveSubscriber) {
+  uint64_t id = Subscribe();
+  ASSERT_TRUE(watcher_.RemoveSubscriber(id));
+  ASSERT_FALSE(watcher_.RemoveSubscriber(id));
+  ASSERT_TRUE(watcher_.GetWatchedServices().empty());
+
+  std::vector<polaris::Instance> instances;
+  instances.emplace_back("instance_1", "127.0.0.1", 10001, 100);
+  watcher_.OnInstancesUpdate(service_key_, "rev1", instances);
+  ASSERT_TRUE(deltas_.empty());
+}
+
+}  // namespace trpc
@@ -0,0 +1,153 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_latency_router.h"
+
+#include <random>
+
+namespace trpc {
+
+namespace {
+
+// The weight of a new sample in the smoothed latency
+constexpr double kLatencyDecay = 0.1;
+
+uint32_t GetRandomPercent() {
+  thread_local std::mt19937 engine(std::random_device{}());
+  return std::uniform_int_distribution<uint32_t>(0, 99)(engine);
+}
+
+}  // namespace
+
+std::string MakeCampusLocality(const std::string& region, const std::string& zone, const std::string& campus) {
+  return region + "/" + zone + "/" + campus;
+}
+
+void LatencyRouter::SetConfig(const naming::LatencyRouterConfig& config) {
+  config_ = config;
+  if (config_.min_samples == 0) {
+    config_.min_samples = 1;
+  }
+}
+
+std::shared_ptr<LatencyRouter::ServiceState> LatencyRouter::FindService(const std::string& service) const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  auto it = services_.find(service);
+  return it == services_.end() ? nullptr : it->second;
+}
+
+void LatencyRouter::RecordLatency(const std::string& service, const std::string& locality, uint64_t latency_ms,
+                                  uint64_t now_ms) {
+  std::shared_ptr<ServiceState> state = FindService(service);
+  if (state == nullptr) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    std::shared_ptr<ServiceState>& new_state = services_[service];
+    if (new_state == nullptr) {
+      new_state = std::make_shared<ServiceState>();
+    }
+    state = new_state;
+  }
+
+  std::scoped_lock<std::mutex> lock(state->mutex);
+  LocalityLatency& latency = state->localities[locality];
+  // The expired latency is measured again from scratch
+  if (latency.samples == 0 || now_ms >= latency.last_sample_ms + config_.expire) {
+    latency.latency_ms = static_cast<double>(latency_ms);
+    latency.samples = 0;
+  } else {
+    latency.latency_ms += (static_cast<double>(latency_ms) - latency.latency_ms) * kLatencyDecay;
+  }
+  ++latency.samples;
+  latency.last_sample_ms = now_ms;
+}
+
+bool LatencyRouter::GetLatencyLocked(const ServiceState& state, const std::string& locality, uint64_t now_ms,
+                                     double& latency_ms) const {
+  auto it = state.localities.find(locality);
+  if (it == state.localities.end() || it->second.samples < config_.min_samples ||
+      now_ms >= it->second.last_sample_ms + config_.expire) {
+    return false;
+  }
+  latency_ms = it->second.latency_ms;
+  return true;
+}
+
+uint64_t LatencyRouter::GetLatency(const std::string& service, const std::string& locality, uint64_t now_ms) const {
+  std::shared_ptr<ServiceState> state = FindService(service);
+  if (state == nullptr) {
+    return 0;
+  }
+  std::scoped_lock<std::mutex> lock(state->mutex);
+  double latency_ms = 0;
+  if (!GetLatencyLocked(*state, locality, now_ms, latency_ms)) {
+    return 0;
+  }
+  // A measured latency is never reported as 0
+  return latency_ms < 1 ? 1 : static_cast<uint64_t>(latency_ms);
+}
+
+std::string LatencyRouter::Choose(const std::string& service, const std::vector<std::string>& candidates,
+                                  uint64_t now_ms) {
+  std::shared_ptr<ServiceState> state = FindService(service);
+  if (state == nullptr || candidates.empty()) {
+    return "";
+  }
+
+  std::scoped_lock<std::mutex> lock(state->mutex);
+  double best_latency = 0;
+  const std::string* best = nullptr;
+  std::vector<const std::string*> unmeasured;
+  for (const auto& candidate : candidates) {
+    double latency_ms = 0;
+    if (!GetLatencyLocked(*state, candidate, now_ms, latency_ms)) {
+      unmeasured.push_back(&candidate);
+    } else if (best == nullptr || latency_ms < best_latency) {
+      best = &candidate;
+      best_latency = latency_ms;
+    }
+  }
+
+  // Probe the other localities, the ones without a measured latency first
+  if (candidates.size() > 1 && config_.probe_ratio > 0 && GetRandomPercent() < config_.probe_ratio) {
+    if (!unmeasured.empty()) {
+      return *unmeasured[GetRandomPercent() % unmeasured.size()];
+    }
+    return candidates[GetRandomPercent() % candidates.size()];
+  }
+
+  if (best == nullptr) {
+    return "";
+  }
+
+  double current_latency = 0;
+  bool current_available = false;
+  for (const auto& candidate : candidates) {
+    if (candidate == state->current) {
+      current_available = GetLatencyLocked(*state, candidate, now_ms, current_latency);
+      break;
+    }
+  }
+  // Switch only if the best locality is faster than the current one by the hysteresis, so that the routing does not
+  // flip between the localities with similar latency
+  if (!current_available || best_latency * (100 + config_.hysteresis) < current_latency * 100) {
+    state->current = *best;
+  }
+  return state->current;
+}
+
+void LatencyRouter::Clear() {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  services_.clear();
+}
+
+}  // namespace trpc
@@ -0,0 +1,81 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "trpc/naming/polarismesh/config/polarismesh_naming_conf.h"
+
+namespace trpc {
+
+/// @brief Make the locality key of a campus, which is the finest location level of the instances
+std::string MakeCampusLocality(const std::string& region, const std::string& zone, const std::string& campus);
+
+/// @brief Routes the callee services to the locality with the lowest measured latency, instead of the static location
+///        labels
+/// @note The routed locality of a service is kept until another one is faster by the hysteresis, and a small ratio of
+///       the requests are sent to the other localities, so that their latency is measured too
+class LatencyRouter {
+ public:
+  void SetConfig(const naming::LatencyRouterConfig& config);
+
+  bool Enabled() const { return config_.enable; }
+
+  /// @brief Record the latency of a successful call to the locality
+  void RecordLatency(const std::string& service, const std::string& locality, uint64_t latency_ms, uint64_t now_ms);
+
+  /// @brief Get the latency of the locality
+  /// @return The smoothed latency, 0 if there are not enough recent samples
+  uint64_t GetLatency(const std::string& service, const std::string& locality, uint64_t now_ms) const;
+
+  /// @brief Choose the locality to route to
+  /// @param candidates The localities which have enough healthy instances
+  /// @return Empty if none of the candidates has a measured latency yet
+  std::string Choose(const std::string& service, const std::vector<std::string>& candidates, uint64_t now_ms);
+
+  void Clear();
+
+ private:
+  struct LocalityLatency {
+    double latency_ms{0};
+    uint64_t samples{0};
+    uint64_t last_sample_ms{0};
+  };
+
+  struct ServiceState {
+    std::mutex mutex;
+    std::unordered_map<std::string, LocalityLatency> localities;
+    // The locality which the service is routed to
+    std::string current;
+  };
+
+  std::shared_ptr<ServiceState> FindService(const std::string& service) const;
+
+  // Get the latency of the locality, return false if it is not trusted
+  bool GetLatencyLocked(const ServiceState& state, const std::string& locality, uint64_t now_ms,
+                        double& latency_ms) const;
+
+ private:
+  naming::LatencyRouterConfig config_;
+  mutable std::shared_mutex mutex_;
+  std::unordered_map<std::string, std::shared_ptr<ServiceState>> services_;
+};
+
+}  // namespace trpc
@@ -0,0 +1,107 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_latency_router.h"
+
+#include "gtest/gtest.h"
+
+namespace trpc {
+
+namespace {
+
+naming::LatencyRouterConfig MakeConfig() {
+  naming::LatencyRouterConfig config;
+  config.enable = true;
+  config.hysteresis = 20;
+  config.min_samples = 3;
+  config.expire = 1000;
+  config.probe_ratio = 0;
+  return config;
+}
+
+}  // namespace
+
+TEST(LatencyRouterTest, GetLatency) {
+  LatencyRouter router;
+  router.SetConfig(MakeConfig());
+  ASSERT_TRUE(router.Enabled());
+  ASSERT_EQ(0, router.GetLatency("test.service", "south/sz/a", 100));
+
+  // Not enough samples
+  router.RecordLatency("test.service", "south/sz/a", 10, 100);
+  router.RecordLatency("test.service", "south/sz/a", 10, 100);
+  ASSERT_EQ(0, router.GetLatency("test.service", "south/sz/a", 100));
+  router.RecordLatency("test.service", "south/sz/a", 10, 100);
+  ASSERT_EQ(10, router.GetLatency("test.service", "south/sz/a", 100));
+
+  // Smoothed
+  router.RecordLatency("test.service", "south/sz/a", 110, 200);
+  ASSERT_EQ(20, router.GetLatency("test.service", "south/sz/a", 200));
+
+  // Expired, then measured again from scratch
+  ASSERT_EQ(0, router.GetLatency("test.service", "south/sz/a", 1200));
+  for (int i = 0; i < 3; ++i) {
+    router.RecordLatency("test.service", "south/sz/a", 50, 1200);
+  }
+  ASSERT_EQ(50, router.GetLatency("test.service", "south/sz/a", 1200));
+
+  router.Clear();
+  ASSERT_EQ(0, router.GetLatency("test.service", "south/sz/a", 1200));
+}
+
+TEST(LatencyRouterTest, Choose) {
+  LatencyRouter router;
+  router.SetConfig(MakeConfig());
+  std::vector<std::string> candidates{"south/sz/a", "south/sz/b"};
+  ASSERT_EQ("", router.Choose("test.service", candidates, 100));
+
+  for (int i = 0; i < 3; ++i) {
+    router.RecordLatency("test.service", "south/sz/a", 10, 100);
+  }
+  ASSERT_EQ("south/sz/a", router.Choose("test.service", candidates, 100));
+
+  // Faster, but within the hysteresis
+  for (int i = 0; i < 3; ++i) {
+    router.RecordLatency("test.service", "south/sz/b", 9, 100);
+  }
+  ASSERT_EQ("south/sz/a", router.Choose("test.service", candidates, 100));
+
+  // Faster beyond the hysteresis
+  for (int i = 0; i < 50; ++i) {
+    router.RecordLatency("test.service", "south/sz/b", 5, 100);
+  }
+  ASSERT_EQ("south/sz/b", router.Choose("test.service", candidates, 100));
+
+  // The current locality has no healthy capacity
+  ASSERT_EQ("south/sz/a", router.Choose("test.service", {"south/sz/a"}, 100));
+  ASSERT_EQ("", router.Choose("test.service", {"south/gz/a"}, 100));
+}
+
+TEST(LatencyRouterTest, Probe) {
+  naming::LatencyRouterConfig config = MakeConfig();
+  config.probe_ratio = 100;
+  LatencyRouter router;
+  router.SetConfig(config);
+  for (int i = 0; i < 3; ++i) {
+    router.RecordLatency("test.service", "south/sz/a", 10, 100);
+  }
+
+  // The locality without a measured latency is probed first
+  ASSERT_EQ("south/sz/b", router.Choose("test.service", {"south/sz/a", "south/sz/b"}, 100));
+  // A single candidate is not probed
+  ASSERT_EQ("south/sz/a", router.Choose("test.service", {"south/sz/a"}, 100));
+}
+
+TEST(LatencyRouterTest, MakeCampusLocality) { ASSERT_EQ("south/sz/a", MakeCampusLocality("south", "sz", "a")); }
+
+}  // namespace trpc
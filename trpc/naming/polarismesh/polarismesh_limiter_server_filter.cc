@@ -17,6 +17,7 @@
 
 #include "trpc/codec/trpc/trpc.pb.h"
 #include "trpc/common/status.h"
+#include "trpc/naming/registry_factory.h"
 #include "trpc/server/service.h"
 #include "trpc/util/log/logging.h"
 #include "trpc/util/time.h"
@@ -28,6 +29,11 @@ int PolarisMeshLimiterServerFilter::Init() {
   if (TrpcConfig::GetInstance()->GetPluginConfig<trpc::naming::RateLimiterConfig>("limiter", "polarismesh", config)) {
     update_call_result_ = config.update_call_result;
   }
+
+  registry_ = static_pointer_cast<PolarisMeshRegistry>(RegistryFactory::GetInstance()->Get(kPolarisPluginName));
+  if (registry_ != nullptr) {
+    overload_guard_ = registry_->GetOverloadGuard();
+  }
   return 0;
 }
 
@@ -83,6 +89,10 @@ void PolarisMeshLimiterServerFilter::operator()(FilterStatus& status, FilterPoin
   TRPC_ASSERT(limiter_ && "limiter is null");
   if (point == FilterPoint::SERVER_PRE_RPC_INVOKE) {
     LimitRetCode ret_code = ShouldLimit(context);
+    // The guard is configured when the registry is initialized
+    if (overload_guard_ != nullptr && overload_guard_->Enabled()) {
+      overload_guard_->RecordRequest(ret_code == LimitRetCode::kLimitReject);
+    }
     if (ret_code == LimitRetCode::kLimitReject) {
       std::string error = "Server limit reject of " + context->GetService()->GetName();
       TRPC_LOG_ERROR(error);
@@ -22,6 +22,7 @@
 #include "trpc/naming/limiter.h"
 #include "trpc/naming/limiter_factory.h"
 #include "trpc/naming/polarismesh/config/polarismesh_naming_conf.h"
+#include "trpc/naming/polarismesh/polarismesh_registry.h"
 #include "trpc/server/server_context.h"
 
 namespace trpc {
@@ -56,6 +57,10 @@ class PolarisMeshLimiterServerFilter : public MessageServerFilter {
 
   // Do you need to report the call
   bool update_call_result_ = false;
+
+  // The registry whose overload guard records the results of the limiter
+  PolarisMeshRegistryPtr registry_;
+  OverloadGuard* overload_guard_{nullptr};
 };
 
 using PolarisMeshLimiterServerFilterPtr = RefPtr<PolarisMeshLimiterServerFilter>;
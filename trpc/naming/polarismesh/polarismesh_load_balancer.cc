@@ -0,0 +1,199 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_load_balancer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <random>
+#include <unordered_set>
+
+namespace trpc {
+
+namespace {
+
+// The first seen time of the instances which exist before the client observes the service
+constexpr uint64_t kWarmedUp = 0;
+
+std::mt19937_64& GetRandomEngine() {
+  thread_local std::mt19937_64 engine(std::random_device{}());
+  return engine;
+}
+
+// Select by weighted random, the candidate at exclude_index is skipped
+int SelectByWeightedRandomExclude(const std::vector<uint32_t>& weights, int exclude_index) {
+  uint64_t total_weight = 0;
+  for (std::size_t i = 0; i < weights.size(); ++i) {
+    if (static_cast<int>(i) != exclude_index) {
+      total_weight += weights[i];
+    }
+  }
+  if (total_weight == 0) {
+    return -1;
+  }
+
+  uint64_t random = std::uniform_int_distribution<uint64_t>(0, total_weight - 1)(GetRandomEngine());
+  for (std::size_t i = 0; i < weights.size(); ++i) {
+    if (static_cast<int>(i) == exclude_index) {
+      continue;
+    }
+    if (random < weights[i]) {
+      return static_cast<int>(i);
+    }
+    random -= weights[i];
+  }
+  return -1;
+}
+
+}  // namespace
+
+int SelectByWeightedRandom(const std::vector<uint32_t>& weights) { return SelectByWeightedRandomExclude(weights, -1); }
+
+int SelectByP2C(const std::vector<uint32_t>& weights, const std::vector<uint64_t>& loads) {
+  int first = SelectByWeightedRandomExclude(weights, -1);
+  if (first < 0) {
+    return -1;
+  }
+  int second = SelectByWeightedRandomExclude(weights, first);
+  if (second < 0) {
+    return first;
+  }
+
+  // Compare load / weight without division
+  uint64_t first_cost = loads[first] * weights[second];
+  uint64_t second_cost = loads[second] * weights[first];
+  return second_cost < first_cost ? second : first;
+}
+
+void SlowStartWeigher::SetConfig(const naming::SlowStartConfig& config) {
+  config_ = config;
+  config_.min_weight_percent = std::clamp<uint32_t>(config_.min_weight_percent, 1, 100);
+}
+
+uint32_t SlowStartWeigher::CalculateWeight(uint32_t weight, uint64_t age_ms) const {
+  if (weight == 0 || !Enabled() || age_ms >= config_.window) {
+    return weight;
+  }
+
+  double floor = config_.min_weight_percent / 100.0;
+  double progress = static_cast<double>(age_ms) / config_.window;
+  double factor = 1.0;
+  if (config_.curve == "exponential") {
+    // Grows from floor to 1 exponentially
+    factor = std::pow(floor, 1.0 - progress);
+  } else {
+    factor = floor + (1.0 - floor) * progress;
+  }
+  return std::max<uint32_t>(1, static_cast<uint32_t>(weight * factor));
+}
+
+void SlowStartWeigher::GetEffectiveWeights(const polaris::ServiceKey& service_key, const std::string& revision,
+                                           const std::vector<polaris::Instance>& instances, uint64_t now_ms,
+                                           std::vector<uint32_t>& weights) {
+  weights.resize(instances.size());
+  if (!Enabled()) {
+    for (std::size_t i = 0; i < instances.size(); ++i) {
+      weights[i] = instances[i].GetWeight();
+    }
+    return;
+  }
+
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = services_.find(service_key);
+    if (it != services_.end() && LookupFirstSeen(it->second, revision, instances, now_ms, weights)) {
+      return;
+    }
+  }
+
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  ServiceState& state = services_[service_key];
+  UpdateFirstSeen(state, revision, instances, now_ms, false);
+  LookupFirstSeen(state, revision, instances, now_ms, weights);
+}
+
+bool SlowStartWeigher::IsObserved(const polaris::ServiceKey& service_key, const std::string& revision) {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  auto it = services_.find(service_key);
+  return it != services_.end() && it->second.observed_revision == revision;
+}
+
+void SlowStartWeigher::ObserveInstances(const polaris::ServiceKey& service_key, const std::string& revision,
+                                        const std::vector<polaris::Instance>& instances, uint64_t now_ms) {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  UpdateFirstSeen(services_[service_key], revision, instances, now_ms, true);
+}
+
+bool SlowStartWeigher::LookupFirstSeen(const ServiceState& state, const std::string& revision,
+                                       const std::vector<polaris::Instance>& instances, uint64_t now_ms,
+                                       std::vector<uint32_t>& weights) const {
+  if (state.revision != revision) {
+    return false;
+  }
+
+  for (std::size_t i = 0; i < instances.size(); ++i) {
+    auto it = state.first_seen_by_local_id.find(instances[i].GetLocalId());
+    if (it == state.first_seen_by_local_id.end()) {
+      return false;
+    }
+    if (it->second == kWarmedUp) {
+      weights[i] = instances[i].GetWeight();
+    } else {
+      uint64_t age_ms = now_ms > it->second ? now_ms - it->second : 0;
+      weights[i] = CalculateWeight(instances[i].GetWeight(), age_ms);
+    }
+  }
+  return true;
+}
+
+void SlowStartWeigher::UpdateFirstSeen(ServiceState& state, const std::string& revision,
+                                       const std::vector<polaris::Instance>& instances, uint64_t now_ms,
+                                       bool all_instances) {
+  if (state.revision != revision) {
+    state.first_seen_by_local_id.clear();
+    state.revision = revision;
+  }
+  if (all_instances && state.observed_revision != revision) {
+    // Forget the warmed up instances which are gone, they slow start again when they come back
+    std::unordered_set<std::string> current_ids;
+    for (const auto& instance : instances) {
+      current_ids.insert(instance.GetId());
+    }
+    for (auto it = state.first_seen_by_id.begin(); it != state.first_seen_by_id.end();) {
+      if (it->second + config_.window <= now_ms && current_ids.find(it->first) == current_ids.end()) {
+        it = state.first_seen_by_id.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    state.observed_revision = revision;
+  }
+
+  for (const auto& instance : instances) {
+    if (state.first_seen_by_local_id.find(instance.GetLocalId()) != state.first_seen_by_local_id.end()) {
+      continue;
+    }
+    uint64_t first_seen_ms = state.initialized ? now_ms : kWarmedUp;
+    auto result = state.first_seen_by_id.emplace(instance.GetId(), first_seen_ms);
+    state.first_seen_by_local_id[instance.GetLocalId()] = result.first->second;
+  }
+  state.initialized = true;
+}
+
+void SlowStartWeigher::Clear() {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  services_.clear();
+}
+
+}  // namespace trpc
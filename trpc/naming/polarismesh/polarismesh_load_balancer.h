@@ -0,0 +1,107 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "polaris/model.h"
+
+#include "trpc/naming/polarismesh/config/polarismesh_naming_conf.h"
+
+namespace trpc {
+
+/// @brief Load balancing type of the plugin side: power of two choices by the in-flight requests
+constexpr char kLoadBalanceTypeP2C[] = "p2c";
+
+/// @brief Select an instance by weighted random
+/// @param weights The effective weights of the candidates
+/// @return The index of the selected candidate, -1 if there is no candidate with positive weight
+int SelectByWeightedRandom(const std::vector<uint32_t>& weights);
+
+/// @brief Select an instance by power of two choices: two candidates are picked by weighted random, and the one with
+///        less load per weight wins
+/// @param weights The effective weights of the candidates
+/// @param loads The loads of the candidates, e.g. in-flight requests
+/// @return The index of the selected candidate, -1 if there is no candidate with positive weight
+int SelectByP2C(const std::vector<uint32_t>& weights, const std::vector<uint64_t>& loads);
+
+/// @brief Ramps up the weight of the newly discovered instances
+/// @note The instances of the first observation of a service are regarded as warmed up, so that a restarting client
+///       does not slow start the whole callee service. The first seen time is recorded from all the instances of the
+///       service, so that the instances which are routed later (e.g. after a zone failover) do not slow start
+class SlowStartWeigher {
+ public:
+  void SetConfig(const naming::SlowStartConfig& config);
+
+  bool Enabled() const { return config_.enable && config_.window > 0; }
+
+  /// @brief Whether all the instances of the service at the revision are recorded by ObserveInstances
+  bool IsObserved(const polaris::ServiceKey& service_key, const std::string& revision);
+
+  /// @brief Record the first seen time of all the instances of the service
+  /// @param service_key The callee service
+  /// @param revision The revision of the instances
+  /// @param instances All the instances of the service, not only the routed ones
+  /// @param now_ms Current time, unit: ms
+  void ObserveInstances(const polaris::ServiceKey& service_key, const std::string& revision,
+                        const std::vector<polaris::Instance>& instances, uint64_t now_ms);
+
+  /// @brief Get the effective weights of the instances
+  /// @param service_key The callee service
+  /// @param revision The revision of the instances, used to avoid rebuilding the index on every call
+  /// @param instances The candidates
+  /// @param now_ms Current time, unit: ms
+  /// @param[out] weights The effective weights, aligned with the instances
+  void GetEffectiveWeights(const polaris::ServiceKey& service_key, const std::string& revision,
+                           const std::vector<polaris::Instance>& instances, uint64_t now_ms,
+                           std::vector<uint32_t>& weights);
+
+  /// @brief Calculate the effective weight of an instance which appears for age_ms
+  uint32_t CalculateWeight(uint32_t weight, uint64_t age_ms) const;
+
+  void Clear();
+
+ private:
+  struct ServiceState {
+    bool initialized{false};
+    std::string revision;
+    // The revision of which all the instances are recorded
+    std::string observed_revision;
+    // First seen time of the instances, key is the polarismesh instance id, which is stable between revisions
+    std::unordered_map<std::string, uint64_t> first_seen_by_id;
+    // Index of the current revision, key is the local id of the instance
+    std::unordered_map<uint64_t, uint64_t> first_seen_by_local_id;
+  };
+
+  // Return false if some instances are not indexed
+  bool LookupFirstSeen(const ServiceState& state, const std::string& revision,
+                       const std::vector<polaris::Instance>& instances, uint64_t now_ms,
+                       std::vector<uint32_t>& weights) const;
+
+  // The warmed up instances which are gone are forgotten only if all the instances of the service are given
+  void UpdateFirstSeen(ServiceState& state, const std::string& revision,
+                       const std::vector<polaris::Instance>& instances, uint64_t now_ms, bool all_instances);
+
+ private:
+  naming::SlowStartConfig config_;
+  std::shared_mutex mutex_;
+  std::map<polaris::ServiceKey, ServiceState> services_;
+};
+
+}  // namespace trpc
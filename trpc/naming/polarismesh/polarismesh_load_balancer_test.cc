@@ -0,0 +1,143 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_load_balancer.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace trpc {
+
+TEST(PolarisMeshLoadBalancerTest, SelectByWeightedRandom) {
+  ASSERT_EQ(-1, SelectByWeightedRandom({}));
+  ASSERT_EQ(-1, SelectByWeightedRandom({0, 0}));
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_EQ(1, SelectByWeightedRandom({0, 5, 0}));
+  }
+}
+
+TEST(PolarisMeshLoadBalancerTest, SelectByP2C) {
+  ASSERT_EQ(-1, SelectByP2C({0, 0}, {0, 0}));
+  ASSERT_EQ(0, SelectByP2C({1}, {100}));
+  // Both candidates are always picked, the one with less load wins
+  for (int i = 0; i < 100; ++i) {
+    ASSERT_EQ(1, SelectByP2C({100, 100}, {10, 0}));
+    ASSERT_EQ(0, SelectByP2C({100, 100}, {0, 10}));
+    // Load is compared per weight: 10/100 < 2/10
+    ASSERT_EQ(0, SelectByP2C({100, 10}, {10, 2}));
+  }
+}
+
+TEST(SlowStartWeigherTest, LinearCurve) {
+  naming::SlowStartConfig config;
+  config.enable = true;
+  config.window = 10000;
+  config.min_weight_percent = 10;
+  config.curve = "linear";
+  SlowStartWeigher weigher;
+  weigher.SetConfig(config);
+
+  ASSERT_EQ(10, weigher.CalculateWeight(100, 0));
+  ASSERT_EQ(55, weigher.CalculateWeight(100, 5000));
+  ASSERT_EQ(100, weigher.CalculateWeight(100, 10000));
+  ASSERT_EQ(0, weigher.CalculateWeight(0, 0));
+  // The effective weight is at least 1
+  ASSERT_EQ(1, weigher.CalculateWeight(1, 0));
+}
+
+TEST(SlowStartWeigherTest, ExponentialCurve) {
+  naming::SlowStartConfig config;
+  config.enable = true;
+  config.window = 10000;
+  config.min_weight_percent = 10;
+  config.curve = "exponential";
+  SlowStartWeigher weigher;
+  weigher.SetConfig(config);
+
+  ASSERT_EQ(10, weigher.CalculateWeight(100, 0));
+  ASSERT_EQ(31, weigher.CalculateWeight(100, 5000));
+  ASSERT_EQ(100, weigher.CalculateWeight(100, 10000));
+}
+
+TEST(SlowStartWeigherTest, Disabled) {
+  SlowStartWeigher weigher;
+  ASSERT_FALSE(weigher.Enabled());
+  ASSERT_EQ(100, weigher.CalculateWeight(100, 0));
+}
+
+TEST(SlowStartWeigherTest, NewInstanceRampsUp) {
+  naming::SlowStartConfig config;
+  config.enable = true;
+  config.window = 10000;
+  config.min_weight_percent = 10;
+  SlowStartWeigher weigher;
+  weigher.SetConfig(config);
+
+  polaris::ServiceKey service_key{"Test", "test.service"};
+  std::vector<uint32_t> weights;
+
+  // Instances of the first observation are regarded as warmed up
+  std::vector<polaris::Instance> instances;
+  instances.emplace_back("instance_1", "127.0.0.1", 10001, 100);
+  weigher.GetEffectiveWeights(service_key, "rev1", instances, 1000, weights);
+  ASSERT_EQ(1, weights.size());
+  ASSERT_EQ(100, weights[0]);
+
+  // A new instance in the next revision starts from the floor
+  std::vector<polaris::Instance> new_instances;
+  new_instances.emplace_back("instance_2", "127.0.0.1", 10002, 100);
+  weigher.GetEffectiveWeights(service_key, "rev2", new_instances, 2000, weights);
+  ASSERT_EQ(10, weights[0]);
+
+  weigher.GetEffectiveWeights(service_key, "rev2", new_instances, 7000, weights);
+  ASSERT_EQ(55, weights[0]);
+
+  weigher.GetEffectiveWeights(service_key, "rev2", new_instances, 12000, weights);
+  ASSERT_EQ(100, weights[0]);
+}
+
+TEST(SlowStartWeigherTest, FailoverInstanceIsNotNew) {
+  naming::SlowStartConfig config;
+  config.enable = true;
+  config.window = 10000;
+  config.min_weight_percent = 10;
+  SlowStartWeigher weigher;
+  weigher.SetConfig(config);
+
+  polaris::ServiceKey service_key{"Test", "test.service"};
+  std::vector<uint32_t> weights;
+
+  // Instance 1 is in the local zone, instance 2 is in another zone
+  std::vector<polaris::Instance> all_instances;
+  all_instances.emplace_back("instance_1", "127.0.0.1", 10001, 100);
+  all_instances.emplace_back("instance_2", "127.0.0.2", 10002, 100);
+  ASSERT_FALSE(weigher.IsObserved(service_key, "rev1"));
+  weigher.ObserveInstances(service_key, "rev1", all_instances, 1000);
+  ASSERT_TRUE(weigher.IsObserved(service_key, "rev1"));
+  weigher.GetEffectiveWeights(service_key, "rev1", {all_instances[0]}, 1000, weights);
+  ASSERT_EQ(100, weights[0]);
+
+  // The local zone fails, the requests fail over to instance 2, which is not new
+  weigher.ObserveInstances(service_key, "rev2", {all_instances[1]}, 2000);
+  weigher.GetEffectiveWeights(service_key, "rev2", {all_instances[1]}, 2000, weights);
+  ASSERT_EQ(100, weights[0]);
+
+  // A new instance of the service still slow starts
+  all_instances.emplace_back("instance_3", "127.0.0.3", 10003, 100);
+  weigher.ObserveInstances(service_key, "rev3", all_instances, 3000);
+  weigher.GetEffectiveWeights(service_key, "rev3", {all_instances[2]}, 3000, weights);
+  ASSERT_EQ(10, weights[0]);
+}
+
+}  // namespace trpc
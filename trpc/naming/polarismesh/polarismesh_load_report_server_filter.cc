@@ -0,0 +1,49 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_load_report_server_filter.h"
+
+#include "trpc/naming/polarismesh/common.h"
+#include "trpc/naming/registry_factory.h"
+
+namespace trpc {
+
+int PolarisMeshLoadReportServerFilter::Init() {
+  registry_ = static_pointer_cast<PolarisMeshRegistry>(RegistryFactory::GetInstance()->Get(kPolarisPluginName));
+  if (registry_ != nullptr) {
+    load_reporter_ = registry_->GetLoadReporter();
+  }
+  return 0;
+}
+
+std::vector<FilterPoint> PolarisMeshLoadReportServerFilter::GetFilterPoint() {
+  std::vector<FilterPoint> points = {FilterPoint::SERVER_PRE_RPC_INVOKE, FilterPoint::SERVER_POST_RPC_INVOKE};
+  return points;
+}
+
+void PolarisMeshLoadReportServerFilter::operator()(FilterStatus& status, FilterPoint point,
+                                                   const ServerContextPtr& context) {
+  status = FilterStatus::CONTINUE;
+  // The reporter is configured when the registry is initialized
+  if (load_reporter_ == nullptr || !load_reporter_->Enabled()) {
+    return;
+  }
+
+  if (point == FilterPoint::SERVER_PRE_RPC_INVOKE) {
+    load_reporter_->OnRequestBegin();
+  } else if (point == FilterPoint::SERVER_POST_RPC_INVOKE) {
+    load_reporter_->OnRequestEnd();
+  }
+}
+
+}  // namespace trpc
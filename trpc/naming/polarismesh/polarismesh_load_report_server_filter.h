@@ -0,0 +1,50 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "trpc/filter/filter.h"
+#include "trpc/naming/polarismesh/polarismesh_registry.h"
+#include "trpc/server/server_context.h"
+
+namespace trpc {
+
+/// @brief Counts the requests of the server for the load reporter of the polarismesh registry
+class PolarisMeshLoadReportServerFilter : public MessageServerFilter {
+ public:
+  PolarisMeshLoadReportServerFilter() = default;
+
+  ~PolarisMeshLoadReportServerFilter() override = default;
+
+  std::string Name() override { return "polarismesh_load_report"; }
+
+  int Init();
+
+  /// @brief Get a buried point
+  std::vector<FilterPoint> GetFilterPoint() override;
+
+  /// @brief Trigger the corresponding treatment at the buried point
+  void operator()(FilterStatus& status, FilterPoint point, const ServerContextPtr& context) override;
+
+ private:
+  // Keeps the load reporter alive
+  PolarisMeshRegistryPtr registry_;
+
+  LoadReporter* load_reporter_{nullptr};
+};
+
+}  // namespace trpc
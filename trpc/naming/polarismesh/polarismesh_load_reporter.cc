@@ -0,0 +1,104 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_load_reporter.h"
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+namespace trpc {
+
+void LoadReporter::SetConfig(const naming::LoadReportConfig& config) {
+  config_ = config;
+  config_.smoothing = std::clamp(config_.smoothing, 0.01f, 1.0f);
+  config_.min_weight = std::min(config_.min_weight, 100u);
+  cores_ = std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+uint64_t LoadReporter::GetProcessCpuTimeUs() {
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) {
+    return 0;
+  }
+  return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000UL + usage.ru_utime.tv_usec +
+         usage.ru_stime.tv_usec;
+}
+
+LoadSample LoadReporter::Sample(uint64_t now_ms) { return Sample(now_ms, GetProcessCpuTimeUs()); }
+
+LoadSample LoadReporter::Sample(uint64_t now_ms, uint64_t cpu_time_us) {
+  LoadSample sample;
+  sample.inflight = inflight_.load(std::memory_order_relaxed);
+  sample.queue_size = GetQueueSize();
+
+  uint64_t requests = requests_.load(std::memory_order_relaxed);
+  // The first sampling only sets the baseline of the cpu time and the requests
+  if (last_sample_ms_ != 0 && now_ms > last_sample_ms_) {
+    uint64_t elapsed_ms = now_ms - last_sample_ms_;
+    uint64_t cpu_us = cpu_time_us > last_cpu_time_us_ ? cpu_time_us - last_cpu_time_us_ : 0;
+    sample.cpu = static_cast<float>(cpu_us) / 10 / (elapsed_ms * cores_);
+    sample.qps = (requests - last_requests_) * 1000 / elapsed_ms;
+  }
+
+  last_sample_ms_ = now_ms;
+  last_cpu_time_us_ = cpu_time_us;
+  last_requests_ = requests;
+  return sample;
+}
+
+float LoadReporter::CalculateUtilization(const naming::LoadReportConfig& config, const LoadSample& sample) {
+  float utilization = 0;
+  if (config.max_cpu > 0) {
+    utilization = std::max(utilization, sample.cpu / config.max_cpu);
+  }
+  if (config.max_inflight > 0) {
+    utilization = std::max(utilization, static_cast<float>(sample.inflight) / config.max_inflight);
+  }
+  if (config.max_queue_size > 0) {
+    utilization = std::max(utilization, static_cast<float>(sample.queue_size) / config.max_queue_size);
+  }
+  if (config.max_qps > 0) {
+    utilization = std::max(utilization, static_cast<float>(sample.qps) / config.max_qps);
+  }
+  return std::min(utilization, 1.0f);
+}
+
+float LoadReporter::Update(const LoadSample& sample) {
+  // The weight is kept full below half of the saturation, then falls linearly to the min weight
+  float utilization = CalculateUtilization(config_, sample);
+  float target = utilization <= 0.5f ? 1.0f : 2 * (1 - utilization);
+  target = std::max(target, config_.min_weight / 100.0f);
+  factor_ += config_.smoothing * (target - factor_);
+  return factor_;
+}
+
+bool LoadReporter::ShouldPublish(uint64_t now_ms) const {
+  if (last_publish_ms_ != 0 && now_ms < last_publish_ms_ + config_.publish_interval) {
+    return false;
+  }
+  return std::fabs(factor_ - published_factor_) * 100 > config_.change_threshold;
+}
+
+void LoadReporter::MarkPublished(uint64_t now_ms) {
+  published_factor_ = factor_;
+  last_publish_ms_ = now_ms;
+}
+
+uint32_t LoadReporter::CalculateWeight(uint32_t base_weight, float factor) {
+  return std::max(static_cast<uint32_t>(std::lround(base_weight * factor)), 1u);
+}
+
+}  // namespace trpc
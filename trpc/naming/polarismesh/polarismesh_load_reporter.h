@@ -0,0 +1,105 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+#include "trpc/naming/polarismesh/config/default_naming_conf.h"
+
+namespace trpc {
+
+/// @brief A sample of the load of the server
+struct LoadSample {
+  /// The cpu usage of the process, in percent of all the cores
+  float cpu{0};
+  uint64_t inflight{0};
+  uint64_t queue_size{0};
+  uint64_t qps{0};
+};
+
+/// @brief Collects the load of the server and turns it into a smoothed weight factor, by which the registered weights
+///        of the instances are scaled, so that the callers send less traffic to a busy server
+/// @note The request counters are thread-safe, the sampling and publishing are expected to run in one timer thread
+class LoadReporter {
+ public:
+  void SetConfig(const naming::LoadReportConfig& config);
+
+  const naming::LoadReportConfig& GetConfig() const { return config_; }
+
+  bool Enabled() const { return config_.enable; }
+
+  void OnRequestBegin() {
+    inflight_.fetch_add(1, std::memory_order_relaxed);
+    requests_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  void OnRequestEnd() { inflight_.fetch_sub(1, std::memory_order_relaxed); }
+
+  /// @brief Set the getter of the size of the request queue, which is not sampled if it is not set
+  void SetQueueSizeGetter(std::function<uint64_t()> getter) { queue_size_getter_ = std::move(getter); }
+
+  /// @brief Get the size of the request queue, 0 if the getter is not set
+  uint64_t GetQueueSize() const { return queue_size_getter_ ? queue_size_getter_() : 0; }
+
+  /// @brief Whether it is time to sample the load
+  bool ShouldSample(uint64_t now_ms) const { return now_ms >= last_sample_ms_ + config_.sample_interval; }
+
+  /// @brief Sample the load since the last sampling
+  LoadSample Sample(uint64_t now_ms);
+
+  /// @brief Sample the load with the given cpu time of the process, unit: us
+  LoadSample Sample(uint64_t now_ms, uint64_t cpu_time_us);
+
+  /// @brief Get the utilization of the most saturated dimension of the sample, in [0, 1]
+  static float CalculateUtilization(const naming::LoadReportConfig& config, const LoadSample& sample);
+
+  /// @brief Update the weight factor by the sample
+  /// @return The smoothed weight factor, in [min_weight / 100, 1]
+  float Update(const LoadSample& sample);
+
+  float GetFactor() const { return factor_; }
+
+  /// @brief Get the factor which is published last, by which the instances updated in between are scaled
+  float GetPublishedFactor() const { return published_factor_; }
+
+  /// @brief Whether the factor changes enough since the last publishing and the publish interval has passed
+  bool ShouldPublish(uint64_t now_ms) const;
+
+  void MarkPublished(uint64_t now_ms);
+
+  /// @brief Scale the registered weight by the factor, which keeps at least 1
+  static uint32_t CalculateWeight(uint32_t base_weight, float factor);
+
+  static uint64_t GetProcessCpuTimeUs();
+
+ private:
+  naming::LoadReportConfig config_;
+  std::atomic<uint64_t> inflight_{0};
+  std::atomic<uint64_t> requests_{0};
+  std::function<uint64_t()> queue_size_getter_;
+
+  uint64_t last_sample_ms_{0};
+  uint64_t last_cpu_time_us_{0};
+  uint64_t last_requests_{0};
+  uint32_t cores_{1};
+
+  float factor_{1};
+  float published_factor_{1};
+  uint64_t last_publish_ms_{0};
+};
+
+}  // namespace trpc
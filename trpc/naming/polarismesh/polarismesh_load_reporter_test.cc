@@ -0,0 +1,105 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_load_reporter.h"
+
+#include "gtest/gtest.h"
+
+namespace trpc {
+
+TEST(LoadReporterTest, Sample) {
+  naming::LoadReportConfig config;
+  config.enable = true;
+  LoadReporter reporter;
+  reporter.SetConfig(config);
+  ASSERT_TRUE(reporter.Enabled());
+  reporter.SetQueueSizeGetter([]() -> uint64_t { return 7; });
+
+  // The first sampling sets the baseline
+  LoadSample sample = reporter.Sample(1000, 1000000);
+  ASSERT_EQ(0, sample.qps);
+  ASSERT_FLOAT_EQ(0, sample.cpu);
+  ASSERT_EQ(7, sample.queue_size);
+
+  for (int i = 0; i < 30; ++i) {
+    reporter.OnRequestBegin();
+  }
+  for (int i = 0; i < 20; ++i) {
+    reporter.OnRequestEnd();
+  }
+  ASSERT_FALSE(reporter.ShouldSample(1500));
+  ASSERT_TRUE(reporter.ShouldSample(2000));
+  sample = reporter.Sample(3000, 1000000);
+  ASSERT_EQ(10, sample.inflight);
+  ASSERT_EQ(15, sample.qps);
+  ASSERT_FLOAT_EQ(0, sample.cpu);
+
+  ASSERT_GT(LoadReporter::GetProcessCpuTimeUs(), 0);
+}
+
+TEST(LoadReporterTest, CalculateUtilization) {
+  naming::LoadReportConfig config;
+  LoadSample sample;
+  sample.cpu = 40;
+  sample.inflight = 90;
+  sample.queue_size = 10;
+  sample.qps = 500;
+  // Only the cpu is sampled by default
+  ASSERT_FLOAT_EQ(0.5, LoadReporter::CalculateUtilization(config, sample));
+
+  config.max_inflight = 100;
+  config.max_queue_size = 100;
+  config.max_qps = 1000;
+  ASSERT_FLOAT_EQ(0.9, LoadReporter::CalculateUtilization(config, sample));
+
+  sample.queue_size = 1000;
+  ASSERT_FLOAT_EQ(1, LoadReporter::CalculateUtilization(config, sample));
+}
+
+TEST(LoadReporterTest, UpdateAndPublish) {
+  naming::LoadReportConfig config;
+  config.enable = true;
+  config.smoothing = 0.5;
+  config.min_weight = 20;
+  config.change_threshold = 10;
+  config.publish_interval = 30000;
+  LoadReporter reporter;
+  reporter.SetConfig(config);
+  ASSERT_FLOAT_EQ(1, reporter.GetFactor());
+
+  // The weight is kept full below half of the saturation
+  LoadSample sample;
+  sample.cpu = 40;
+  ASSERT_FLOAT_EQ(1, reporter.Update(sample));
+  ASSERT_FALSE(reporter.ShouldPublish(1000));
+
+  // Saturated, the factor is smoothed towards the min weight
+  sample.cpu = 80;
+  ASSERT_FLOAT_EQ(0.6, reporter.Update(sample));
+  ASSERT_TRUE(reporter.ShouldPublish(1000));
+  reporter.MarkPublished(1000);
+  ASSERT_FLOAT_EQ(0.4, reporter.Update(sample));
+  // Rate limited
+  ASSERT_FALSE(reporter.ShouldPublish(2000));
+  ASSERT_TRUE(reporter.ShouldPublish(31000));
+
+  for (int i = 0; i < 20; ++i) {
+    reporter.Update(sample);
+  }
+  ASSERT_NEAR(0.2, reporter.GetFactor(), 0.001);
+
+  ASSERT_EQ(20, LoadReporter::CalculateWeight(100, 0.2));
+  ASSERT_EQ(1, LoadReporter::CalculateWeight(1, 0.2));
+}
+
+}  // namespace trpc
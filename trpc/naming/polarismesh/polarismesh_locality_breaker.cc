@@ -0,0 +1,213 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_locality_breaker.h"
+
+#include <map>
+#include <unordered_map>
+#include <utility>
+
+namespace trpc {
+
+namespace {
+
+// The metadata keys of the set division of the polarismesh instances
+constexpr char kSetEnableKey[] = "internal-enable-set";
+constexpr char kSetNameKey[] = "internal-set-name";
+
+}  // namespace
+
+std::string GetInstanceSetName(const polaris::Instance& instance) {
+  const std::map<std::string, std::string>& metadata = instance.GetMetadata();
+  auto enable_it = metadata.find(kSetEnableKey);
+  if (enable_it == metadata.end() || enable_it->second != "Y") {
+    return "";
+  }
+  auto name_it = metadata.find(kSetNameKey);
+  return name_it == metadata.end() ? "" : name_it->second;
+}
+
+std::string MakeZoneLocality(const std::string& region, const std::string& zone) {
+  return "zone:" + region + "/" + zone;
+}
+
+std::string MakeSetLocality(const std::string& set_name) { return "set:" + set_name; }
+
+void LocalityBreaker::SetConfig(const naming::LocalityBreakerConfig& config) {
+  config_ = config;
+  if (config_.window == 0) {
+    config_.window = 1;
+  }
+}
+
+std::shared_ptr<LocalityBreaker::ServiceState> LocalityBreaker::FindService(const std::string& service) const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  auto it = services_.find(service);
+  return it == services_.end() ? nullptr : it->second;
+}
+
+void LocalityBreaker::RecordResult(const std::string& service, const std::string& locality, bool success,
+                                   uint64_t now_ms) {
+  std::shared_ptr<ServiceState> state = FindService(service);
+  if (state == nullptr) {
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    std::shared_ptr<ServiceState>& new_state = services_[service];
+    if (new_state == nullptr) {
+      new_state = std::make_shared<ServiceState>();
+    }
+    state = new_state;
+  }
+
+  std::scoped_lock<std::mutex> lock(state->mutex);
+  LocalityState& locality_state = state->localities[locality];
+  if (now_ms < locality_state.open_until_ms) {
+    // The results of the requests sent before the locality is broken
+    return;
+  }
+  if (locality_state.recovering) {
+    // Half open, a failed probe breaks the locality again, and enough successful probes close it
+    if (!success) {
+      Break(*state, locality_state, now_ms);
+    } else if (++locality_state.probe_successes >= config_.half_open_requests) {
+      locality_state.recovering = false;
+      locality_state.window_start_ms = now_ms;
+      locality_state.requests = 0;
+      locality_state.failures = 0;
+      state->recovering_num.fetch_sub(1, std::memory_order_relaxed);
+    }
+    return;
+  }
+  if (now_ms >= locality_state.window_start_ms + config_.window) {
+    locality_state.window_start_ms = now_ms;
+    locality_state.requests = 0;
+    locality_state.failures = 0;
+  }
+
+  ++locality_state.requests;
+  if (!success) {
+    ++locality_state.failures;
+  }
+  if (locality_state.requests >= config_.min_requests &&
+      locality_state.failures * 100 >= locality_state.requests * config_.error_rate_threshold) {
+    Break(*state, locality_state, now_ms);
+  }
+}
+
+void LocalityBreaker::Break(ServiceState& state, LocalityState& locality_state, uint64_t now_ms) const {
+  locality_state.open_until_ms = now_ms + config_.sleep_window;
+  locality_state.window_start_ms = locality_state.open_until_ms;
+  locality_state.requests = 0;
+  locality_state.failures = 0;
+  locality_state.probes = 0;
+  locality_state.probe_successes = 0;
+  locality_state.probe_start_ms = locality_state.open_until_ms;
+  // Without the probe requests, the locality is closed right after the sleep window
+  if (config_.half_open_requests > 0 && !locality_state.recovering) {
+    locality_state.recovering = true;
+    state.recovering_num.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (locality_state.open_until_ms > state.open_until_ms.load(std::memory_order_relaxed)) {
+    state.open_until_ms.store(locality_state.open_until_ms, std::memory_order_relaxed);
+  }
+}
+
+bool LocalityBreaker::IsOpenLocked(const ServiceState& state, const std::string& locality, uint64_t now_ms) const {
+  auto it = state.localities.find(locality);
+  if (it == state.localities.end()) {
+    return false;
+  }
+  const LocalityState& locality_state = it->second;
+  return now_ms < locality_state.open_until_ms ||
+         (locality_state.recovering && locality_state.probes >= config_.half_open_requests &&
+          now_ms < locality_state.probe_start_ms + config_.window);
+}
+
+bool LocalityBreaker::AdmitLocked(ServiceState& state, const std::string& locality, uint64_t now_ms) const {
+  auto it = state.localities.find(locality);
+  if (it == state.localities.end()) {
+    return true;
+  }
+  LocalityState& locality_state = it->second;
+  if (now_ms < locality_state.open_until_ms) {
+    return false;
+  }
+  if (!locality_state.recovering) {
+    return true;
+  }
+  if (locality_state.probes >= config_.half_open_requests) {
+    // The probes are admitted again if their results are not back within the window, e.g. the probed instances are
+    // not picked by the load balancer
+    if (now_ms < locality_state.probe_start_ms + config_.window) {
+      return false;
+    }
+    locality_state.probes = 0;
+    locality_state.probe_start_ms = now_ms;
+  }
+  ++locality_state.probes;
+  return true;
+}
+
+bool LocalityBreaker::IsOpen(const std::string& service, const std::string& locality, uint64_t now_ms) const {
+  std::shared_ptr<ServiceState> state = FindService(service);
+  if (state == nullptr) {
+    return false;
+  }
+  std::scoped_lock<std::mutex> lock(state->mutex);
+  return IsOpenLocked(*state, locality, now_ms);
+}
+
+bool LocalityBreaker::HasOpen(const std::string& service, uint64_t now_ms) const {
+  std::shared_ptr<ServiceState> state = FindService(service);
+  return state != nullptr && (now_ms < state->open_until_ms.load(std::memory_order_relaxed) ||
+                              state->recovering_num.load(std::memory_order_relaxed) > 0);
+}
+
+std::vector<polaris::Instance> LocalityBreaker::FilterAvailable(const std::string& service,
+                                                                const std::vector<polaris::Instance>& instances,
+                                                                uint64_t now_ms) const {
+  std::shared_ptr<ServiceState> state = FindService(service);
+  if (state == nullptr) {
+    return instances;
+  }
+
+  std::vector<polaris::Instance> available;
+  available.reserve(instances.size());
+  std::scoped_lock<std::mutex> lock(state->mutex);
+  // Each locality is admitted once per call, so that a half-open locality takes one probe request
+  std::unordered_map<std::string, bool> admitted;
+  auto admit = [&](const std::string& locality) {
+    auto it = admitted.find(locality);
+    if (it == admitted.end()) {
+      it = admitted.emplace(locality, AdmitLocked(*state, locality, now_ms)).first;
+    }
+    return it->second;
+  };
+  for (const auto& instance : instances) {
+    if (!admit(MakeZoneLocality(instance.GetRegion(), instance.GetZone()))) {
+      continue;
+    }
+    std::string set_name = GetInstanceSetName(instance);
+    if (!set_name.empty() && !admit(MakeSetLocality(set_name))) {
+      continue;
+    }
+    available.push_back(instance);
+  }
+  return available;
+}
+
+void LocalityBreaker::Clear() {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  services_.clear();
+}
+
+}  // namespace trpc
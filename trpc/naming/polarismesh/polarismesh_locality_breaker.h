@@ -0,0 +1,107 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "polaris/model.h"
+
+#include "trpc/naming/polarismesh/config/polarismesh_naming_conf.h"
+
+namespace trpc {
+
+/// @brief Get the set name of the instance
+/// @return Empty if the set is not enabled on the instance
+std::string GetInstanceSetName(const polaris::Instance& instance);
+
+/// @brief Make the locality key of a zone
+std::string MakeZoneLocality(const std::string& region, const std::string& zone);
+
+/// @brief Make the locality key of a set
+std::string MakeSetLocality(const std::string& set_name);
+
+/// @brief Breaks the localities (zones and sets) of the callee services by the aggregated call results of their
+///        instances, so that a failing locality is skipped as a whole instead of waiting for each instance to trip
+/// @note A broken locality is skipped for the sleep window, then it is half open: only the probe requests are admitted
+///       until as many of them succeed, which closes it, while a failed probe breaks it again
+class LocalityBreaker {
+ public:
+  void SetConfig(const naming::LocalityBreakerConfig& config);
+
+  bool Enabled() const { return config_.enable; }
+
+  /// @brief Record the call result of an instance in the locality
+  void RecordResult(const std::string& service, const std::string& locality, bool success, uint64_t now_ms);
+
+  /// @brief Whether the locality of the service is broken, or half open without probe requests left
+  bool IsOpen(const std::string& service, const std::string& locality, uint64_t now_ms) const;
+
+  /// @brief Whether any locality of the service is broken or half open, which is cheap to check before filtering the
+  ///        instances
+  bool HasOpen(const std::string& service, uint64_t now_ms) const;
+
+  /// @brief Get the instances which are not in the broken zones or sets of the service
+  /// @note A half-open locality is admitted as one probe request of it for each call
+  std::vector<polaris::Instance> FilterAvailable(const std::string& service,
+                                                 const std::vector<polaris::Instance>& instances,
+                                                 uint64_t now_ms) const;
+
+  void Clear();
+
+ private:
+  struct LocalityState {
+    uint64_t window_start_ms{0};
+    uint64_t requests{0};
+    uint64_t failures{0};
+    uint64_t open_until_ms{0};
+    // Whether the locality is broken and not closed yet, it is half open after open_until_ms
+    bool recovering{false};
+    // The probe requests admitted and succeeded in the half-open state
+    uint64_t probes{0};
+    uint64_t probe_successes{0};
+    uint64_t probe_start_ms{0};
+  };
+
+  struct ServiceState {
+    std::mutex mutex;
+    std::unordered_map<std::string, LocalityState> localities;
+    // The latest time until which a locality of the service is broken
+    std::atomic<uint64_t> open_until_ms{0};
+    // The number of the localities of the service which are broken and not closed yet
+    std::atomic<uint32_t> recovering_num{0};
+  };
+
+  std::shared_ptr<ServiceState> FindService(const std::string& service) const;
+
+  void Break(ServiceState& state, LocalityState& locality_state, uint64_t now_ms) const;
+
+  bool IsOpenLocked(const ServiceState& state, const std::string& locality, uint64_t now_ms) const;
+
+  // Whether a request is admitted to the locality, which takes a probe request of a half-open locality
+  bool AdmitLocked(ServiceState& state, const std::string& locality, uint64_t now_ms) const;
+
+ private:
+  naming::LocalityBreakerConfig config_;
+  mutable std::shared_mutex mutex_;
+  std::unordered_map<std::string, std::shared_ptr<ServiceState>> services_;
+};
+
+}  // namespace trpc
@@ -0,0 +1,167 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_locality_breaker.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace trpc {
+
+namespace {
+
+naming::LocalityBreakerConfig MakeConfig() {
+  naming::LocalityBreakerConfig config;
+  config.enable = true;
+  config.error_rate_threshold = 50;
+  config.min_requests = 4;
+  config.window = 1000;
+  config.sleep_window = 5000;
+  return config;
+}
+
+}  // namespace
+
+TEST(LocalityBreakerTest, GetInstanceSetName) {
+  polaris::Instance instance("instance_1", "127.0.0.1", 10001, 100);
+  ASSERT_EQ("", GetInstanceSetName(instance));
+  polaris::InstanceSetter setter(instance);
+  setter.AddMetadataItem("internal-set-name", "app.sz.1");
+  ASSERT_EQ("", GetInstanceSetName(instance));
+  setter.AddMetadataItem("internal-enable-set", "Y");
+  ASSERT_EQ("app.sz.1", GetInstanceSetName(instance));
+}
+
+TEST(LocalityBreakerTest, BreakByErrorRate) {
+  LocalityBreaker breaker;
+  naming::LocalityBreakerConfig config = MakeConfig();
+  config.half_open_requests = 0;
+  breaker.SetConfig(config);
+  ASSERT_TRUE(breaker.Enabled());
+  std::string zone = MakeZoneLocality("south", "sz");
+
+  // Not enough requests
+  for (int i = 0; i < 3; ++i) {
+    breaker.RecordResult("Test/test.service", zone, false, 100);
+  }
+  ASSERT_FALSE(breaker.IsOpen("Test/test.service", zone, 100));
+  ASSERT_FALSE(breaker.HasOpen("Test/test.service", 100));
+
+  breaker.RecordResult("Test/test.service", zone, true, 100);
+  ASSERT_TRUE(breaker.IsOpen("Test/test.service", zone, 100));
+  ASSERT_TRUE(breaker.HasOpen("Test/test.service", 100));
+  ASSERT_FALSE(breaker.IsOpen("Test/test.service", MakeZoneLocality("south", "gz"), 100));
+  ASSERT_FALSE(breaker.HasOpen("Test/other.service", 100));
+
+  // Closed after the sleep window, and the results are counted again
+  ASSERT_FALSE(breaker.IsOpen("Test/test.service", zone, 5100));
+  ASSERT_FALSE(breaker.HasOpen("Test/test.service", 5100));
+  breaker.RecordResult("Test/test.service", zone, false, 5100);
+  ASSERT_FALSE(breaker.IsOpen("Test/test.service", zone, 5100));
+}
+
+TEST(LocalityBreakerTest, HalfOpen) {
+  LocalityBreaker breaker;
+  naming::LocalityBreakerConfig config = MakeConfig();
+  config.half_open_requests = 2;
+  breaker.SetConfig(config);
+  std::string zone = MakeZoneLocality("south", "sz");
+  std::vector<polaris::Instance> instances;
+  polaris::Instance instance("instance_1", "127.0.0.1", 10001, 100);
+  polaris::InstanceSetter setter(instance);
+  setter.SetRegion("south");
+  setter.SetZone("sz");
+  instances.push_back(instance);
+
+  for (int i = 0; i < 4; ++i) {
+    breaker.RecordResult("Test/test.service", zone, false, 100);
+  }
+  ASSERT_TRUE(breaker.FilterAvailable("Test/test.service", instances, 100).empty());
+
+  // After the sleep window, only two probe requests are admitted
+  ASSERT_TRUE(breaker.HasOpen("Test/test.service", 5100));
+  ASSERT_FALSE(breaker.IsOpen("Test/test.service", zone, 5100));
+  ASSERT_EQ(1, breaker.FilterAvailable("Test/test.service", instances, 5100).size());
+  ASSERT_EQ(1, breaker.FilterAvailable("Test/test.service", instances, 5100).size());
+  ASSERT_TRUE(breaker.FilterAvailable("Test/test.service", instances, 5100).empty());
+  ASSERT_TRUE(breaker.IsOpen("Test/test.service", zone, 5100));
+
+  // A failed probe breaks the locality again
+  breaker.RecordResult("Test/test.service", zone, true, 5200);
+  breaker.RecordResult("Test/test.service", zone, false, 5200);
+  ASSERT_TRUE(breaker.IsOpen("Test/test.service", zone, 5200));
+  ASSERT_TRUE(breaker.FilterAvailable("Test/test.service", instances, 10100).empty());
+
+  // The probes are admitted again if their results are not back within the window
+  ASSERT_EQ(1, breaker.FilterAvailable("Test/test.service", instances, 10200).size());
+  ASSERT_EQ(1, breaker.FilterAvailable("Test/test.service", instances, 10200).size());
+  ASSERT_TRUE(breaker.FilterAvailable("Test/test.service", instances, 10200).empty());
+  ASSERT_EQ(1, breaker.FilterAvailable("Test/test.service", instances, 11200).size());
+
+  // As many successful probes close the locality
+  breaker.RecordResult("Test/test.service", zone, true, 11300);
+  breaker.RecordResult("Test/test.service", zone, true, 11300);
+  ASSERT_FALSE(breaker.HasOpen("Test/test.service", 11300));
+  ASSERT_EQ(1, breaker.FilterAvailable("Test/test.service", instances, 11300).size());
+  ASSERT_EQ(1, breaker.FilterAvailable("Test/test.service", instances, 11300).size());
+  ASSERT_EQ(1, breaker.FilterAvailable("Test/test.service", instances, 11300).size());
+}
+
+TEST(LocalityBreakerTest, Window) {
+  LocalityBreaker breaker;
+  breaker.SetConfig(MakeConfig());
+  std::string zone = MakeZoneLocality("south", "sz");
+
+  // The failures of the expired window are not counted
+  for (int i = 0; i < 3; ++i) {
+    breaker.RecordResult("Test/test.service", zone, false, 100);
+  }
+  for (int i = 0; i < 4; ++i) {
+    breaker.RecordResult("Test/test.service", zone, i == 0, 1200);
+  }
+  ASSERT_TRUE(breaker.IsOpen("Test/test.service", zone, 1200));
+
+  breaker.Clear();
+  ASSERT_FALSE(breaker.IsOpen("Test/test.service", zone, 1200));
+}
+
+TEST(LocalityBreakerTest, FilterAvailable) {
+  LocalityBreaker breaker;
+  breaker.SetConfig(MakeConfig());
+
+  std::vector<polaris::Instance> instances;
+  for (int i = 0; i < 4; ++i) {
+    polaris::Instance instance("instance_" + std::to_string(i), "127.0.0.1", 10000 + i, 100);
+    polaris::InstanceSetter setter(instance);
+    setter.SetRegion("south");
+    setter.SetZone(i < 2 ? "sz" : "gz");
+    if (i == 3) {
+      setter.AddMetadataItem("internal-enable-set", "Y");
+      setter.AddMetadataItem("internal-set-name", "app.gz.1");
+    }
+    instances.push_back(instance);
+  }
+  ASSERT_EQ(4, breaker.FilterAvailable("Test/test.service", instances, 100).size());
+
+  for (int i = 0; i < 4; ++i) {
+    breaker.RecordResult("Test/test.service", MakeZoneLocality("south", "sz"), false, 100);
+    breaker.RecordResult("Test/test.service", MakeSetLocality("app.gz.1"), false, 100);
+  }
+  std::vector<polaris::Instance> available = breaker.FilterAvailable("Test/test.service", instances, 100);
+  ASSERT_EQ(1, available.size());
+  ASSERT_EQ("instance_2", available[0].GetId());
+}
+
+}  // namespace trpc
@@ -0,0 +1,76 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_overload_guard.h"
+
+#include <algorithm>
+
+namespace trpc {
+
+void OverloadGuard::SetConfig(const naming::OverloadProtectConfig& config) {
+  config_ = config;
+  config_.window = std::max<uint64_t>(config_.window, 1);
+  config_.recover_percent = std::min(config_.recover_percent, 100u);
+  config_.overload_weight = std::min(config_.overload_weight, 100u);
+}
+
+bool OverloadGuard::Evaluate(uint64_t now_ms, uint64_t queue_size) {
+  if (window_start_ms_ == 0) {
+    window_start_ms_ = now_ms;
+    return false;
+  }
+  if (now_ms < window_start_ms_ + config_.window) {
+    return false;
+  }
+  window_start_ms_ = now_ms;
+
+  uint64_t requests = requests_.exchange(0, std::memory_order_relaxed);
+  uint64_t rejections = rejections_.exchange(0, std::memory_order_relaxed);
+  // The rejection rate of few requests is not reliable
+  uint64_t reject_rate = requests >= config_.min_requests && requests > 0 ? rejections * 100 / requests : 0;
+  bool queue_enabled = config_.max_queue_size > 0;
+
+  if (!overloaded_) {
+    if (reject_rate >= config_.reject_rate || (queue_enabled && queue_size >= config_.max_queue_size)) {
+      overloaded_ = true;
+      recovered_windows_ = 0;
+      return true;
+    }
+    return false;
+  }
+
+  bool recovered = reject_rate * 100 < config_.reject_rate * config_.recover_percent &&
+                   (!queue_enabled || queue_size * 100 < config_.max_queue_size * config_.recover_percent);
+  if (!recovered) {
+    recovered_windows_ = 0;
+    return false;
+  }
+  if (++recovered_windows_ < config_.recover_windows) {
+    return false;
+  }
+  overloaded_ = false;
+  recovered_windows_ = 0;
+  return true;
+}
+
+uint32_t OverloadGuard::GetWeight(uint32_t base_weight) const {
+  if (!overloaded_) {
+    return base_weight;
+  }
+  if (config_.isolate) {
+    return 0;
+  }
+  return std::max(base_weight * config_.overload_weight / 100, 1u);
+}
+
+}  // namespace trpc
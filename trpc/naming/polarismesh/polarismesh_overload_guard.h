@@ -0,0 +1,64 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#include "trpc/naming/polarismesh/config/default_naming_conf.h"
+
+namespace trpc {
+
+/// @brief Detects the overload of the server by the rejection rate of the limiter and the size of the request queue,
+///        so that the weights of the instances are lowered before the errors spread to the callers
+/// @note The overload is entered in one window above the thresholds, and left after several consecutive windows below
+///       the lower recover thresholds, which keeps the weights from flapping. The requests are recorded from any
+///       thread, the evaluation is expected to run in one timer thread
+class OverloadGuard {
+ public:
+  void SetConfig(const naming::OverloadProtectConfig& config);
+
+  const naming::OverloadProtectConfig& GetConfig() const { return config_; }
+
+  bool Enabled() const { return config_.enable; }
+
+  /// @brief Record a request checked by the limiter
+  void RecordRequest(bool rejected) {
+    requests_.fetch_add(1, std::memory_order_relaxed);
+    if (rejected) {
+      rejections_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  /// @brief Evaluate the window which ends, nothing is done if the window does not end
+  /// @param queue_size The current size of the request queue
+  /// @return Whether the overload state changes
+  bool Evaluate(uint64_t now_ms, uint64_t queue_size);
+
+  bool IsOverloaded() const { return overloaded_; }
+
+  /// @brief Get the weight of an instance by the overload state, which is at least 1 unless the instance is isolated
+  uint32_t GetWeight(uint32_t base_weight) const;
+
+ private:
+  naming::OverloadProtectConfig config_;
+  std::atomic<uint64_t> requests_{0};
+  std::atomic<uint64_t> rejections_{0};
+
+  uint64_t window_start_ms_{0};
+  bool overloaded_{false};
+  uint32_t recovered_windows_{0};
+};
+
+}  // namespace trpc
@@ -0,0 +1,89 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_overload_guard.h"
+
+#include "gtest/gtest.h"
+
+namespace trpc {
+
+namespace {
+
+void RecordRequests(OverloadGuard& guard, int requests, int rejections) {
+  for (int i = 0; i < requests; ++i) {
+    guard.RecordRequest(i < rejections);
+  }
+}
+
+}  // namespace
+
+TEST(OverloadGuardTest, RejectRate) {
+  naming::OverloadProtectConfig config;
+  config.enable = true;
+  OverloadGuard guard;
+  guard.SetConfig(config);
+  ASSERT_TRUE(guard.Enabled());
+
+  // The first evaluation starts the window
+  ASSERT_FALSE(guard.Evaluate(1000, 0));
+  RecordRequests(guard, 100, 30);
+  ASSERT_FALSE(guard.Evaluate(1500, 0));
+  ASSERT_FALSE(guard.IsOverloaded());
+  ASSERT_TRUE(guard.Evaluate(2000, 0));
+  ASSERT_TRUE(guard.IsOverloaded());
+  ASSERT_EQ(10, guard.GetWeight(100));
+  ASSERT_EQ(1, guard.GetWeight(5));
+
+  // Below the overload threshold but not the recover threshold
+  RecordRequests(guard, 100, 15);
+  ASSERT_FALSE(guard.Evaluate(3000, 0));
+  ASSERT_TRUE(guard.IsOverloaded());
+
+  // Recovered after the consecutive windows, the window without enough requests counts as recovered
+  RecordRequests(guard, 100, 5);
+  ASSERT_FALSE(guard.Evaluate(4000, 0));
+  RecordRequests(guard, 10, 10);
+  ASSERT_FALSE(guard.Evaluate(5000, 0));
+  RecordRequests(guard, 100, 15);
+  ASSERT_FALSE(guard.Evaluate(6000, 0));
+  for (uint64_t now_ms = 7000; now_ms < 9000; now_ms += 1000) {
+    RecordRequests(guard, 100, 0);
+    ASSERT_FALSE(guard.Evaluate(now_ms, 0));
+  }
+  ASSERT_TRUE(guard.Evaluate(9000, 0));
+  ASSERT_FALSE(guard.IsOverloaded());
+  ASSERT_EQ(100, guard.GetWeight(100));
+
+  // Few requests are not evaluated
+  RecordRequests(guard, 10, 10);
+  ASSERT_FALSE(guard.Evaluate(10000, 0));
+}
+
+TEST(OverloadGuardTest, QueueSize) {
+  naming::OverloadProtectConfig config;
+  config.enable = true;
+  config.max_queue_size = 100;
+  config.recover_windows = 1;
+  config.isolate = true;
+  OverloadGuard guard;
+  guard.SetConfig(config);
+
+  ASSERT_FALSE(guard.Evaluate(1000, 0));
+  ASSERT_TRUE(guard.Evaluate(2000, 100));
+  ASSERT_EQ(0, guard.GetWeight(100));
+  ASSERT_FALSE(guard.Evaluate(3000, 50));
+  ASSERT_TRUE(guard.Evaluate(4000, 49));
+  ASSERT_EQ(100, guard.GetWeight(100));
+}
+
+}  // namespace trpc
@@ -13,7 +13,13 @@
 
 #include "trpc/naming/polarismesh/polarismesh_registry.h"
 
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <mutex>
+#include <thread>
 #include <utility>
+#include <vector>
 
 #include "yaml-cpp/yaml.h"
 
@@ -21,10 +27,123 @@
 #include "trpc/naming/polarismesh/common.h"
 #include "trpc/naming/polarismesh/trpc_share_context.h"
 #include "trpc/naming/registry_factory.h"
+#include "trpc/runtime/common/periphery_task_scheduler.h"
 #include "trpc/util/log/logging.h"
+#include "trpc/util/time.h"
 
 namespace trpc {
 
+namespace {
+
+// The tick of the timer which sends the coalesced heartbeats, unit: ms
+constexpr uint64_t kRegistryTimerTickMs = 100;
+
+// The tick of the timer which retries the registrations, sends the updates and deregisters the drained instances,
+// unit: ms
+constexpr uint64_t kRegistryUpdateTickMs = 100;
+
+// The max number of the threads which register the instances in a batch
+constexpr std::size_t kMaxRegisterConcurrency = 16;
+
+// The TTL of the instances on the server if it is not set when registering, unit: s
+constexpr int kDefaultHeartbeatTtl = 5;
+
+// The max number of the free heartbeat callbacks kept in the pool
+constexpr std::size_t kHeartbeatCallbackPoolSize = 1024;
+
+// The free memory blocks of the heartbeat callbacks. It is never destroyed, since the callbacks may be released by the
+// threads of the SDK at exit
+class HeartbeatCallbackPool {
+ public:
+  static HeartbeatCallbackPool* GetInstance() {
+    static HeartbeatCallbackPool* pool = new HeartbeatCallbackPool();
+    return pool;
+  }
+
+  void* Allocate(std::size_t size) {
+    if (size == sizeof(PolarisMeshHeartbeatCallback)) {
+      std::scoped_lock<std::mutex> lock(mutex_);
+      if (!blocks_.empty()) {
+        void* ptr = blocks_.back();
+        blocks_.pop_back();
+        return ptr;
+      }
+    }
+    return ::operator new(size);
+  }
+
+  void Deallocate(void* ptr, std::size_t size) {
+    if (size == sizeof(PolarisMeshHeartbeatCallback)) {
+      std::scoped_lock<std::mutex> lock(mutex_);
+      if (blocks_.size() < kHeartbeatCallbackPoolSize) {
+        blocks_.push_back(ptr);
+        return;
+      }
+    }
+    ::operator delete(ptr);
+  }
+
+ private:
+  HeartbeatCallbackPool() { blocks_.reserve(kHeartbeatCallbackPoolSize); }
+
+ private:
+  std::mutex mutex_;
+  std::vector<void*> blocks_;
+};
+
+}  // namespace
+
+PolarisMeshHeartbeatCallback::PolarisMeshHeartbeatCallback(std::shared_ptr<const polaris::ServiceKey> service_key,
+                                                           std::optional<Promise<>> promise)
+    : service_key_(std::move(service_key)),
+      promise_(std::move(promise)),
+      begin_time_us_(trpc::time::GetMicroSeconds()) {}
+
+PolarisMeshHeartbeatCallback::PolarisMeshHeartbeatCallback(const HeartbeatTargetPtr& target,
+                                                           std::optional<Promise<>> promise)
+    : service_key_(target, &target->service_key),
+      promise_(std::move(promise)),
+      target_(target),
+      begin_time_us_(trpc::time::GetMicroSeconds()) {}
+
+void PolarisMeshHeartbeatCallback::Response(polaris::ReturnCode code, const std::string& message) {
+  uint64_t cost_us = trpc::time::GetMicroSeconds() - begin_time_us_;
+  if (code != polaris::ReturnCode::kReturnOk) {
+    TRPC_FMT_WARN(
+        "AsyncHeartBeat failed, sdk returnCode:{}, message:{}, service_name:{} "
+        "service_namespace:{}, cost_us:{}",
+        static_cast<int>(code), message, service_key_->name_, service_key_->namespace_, cost_us);
+    // Both the failed heartbeats and the heartbeats limited by the overloaded server back off the next heartbeat
+    if (target_) {
+      target_->failures.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (promise_) {
+      std::string error = "AsyncHeartBeat failed, sdk returnCode:" + std::to_string(static_cast<int>(code)) +
+                          ", message:" + message;
+      promise_->SetException(CommonException(error.c_str()));
+    }
+  } else {
+    TRPC_FMT_DEBUG(
+        "AsyncHeartBeat success, sdk returnCode:{}, message:{}, service_name:{} "
+        "service_namespace:{}, cost_us:{}",
+        static_cast<int>(code), message, service_key_->name_, service_key_->namespace_, cost_us);
+    if (target_ && target_->failures.exchange(0, std::memory_order_relaxed) > 0) {
+      target_->recovered.store(true, std::memory_order_relaxed);
+    }
+    if (promise_) {
+      promise_->SetValue();
+    }
+  }
+}
+
+void* PolarisMeshHeartbeatCallback::operator new(std::size_t size) {
+  return HeartbeatCallbackPool::GetInstance()->Allocate(size);
+}
+
+void PolarisMeshHeartbeatCallback::operator delete(void* ptr, std::size_t size) {
+  HeartbeatCallbackPool::GetInstance()->Deallocate(ptr, size);
+}
+
 int PolarisMeshRegistry::Init() noexcept {
   if (init_) {
     TRPC_FMT_DEBUG("Already init");
@@ -46,9 +165,19 @@ int PolarisMeshRegistry::Init() noexcept {
   // Now heartBeat_timeOut_ is effective, and 1S is added here to be compatible (equivalent to waiting for the extra
   // time to be established)
   heartbeat_timeout_ = plugin_config_.registry_config.heartbeat_timeout + 1000;
+  heartbeat_scheduler_.SetConfig(heartbeat_interval_, plugin_config_.registry_config.heartbeat_jitter,
+                                 plugin_config_.registry_config.heartbeat_backoff_limit);
+  load_reporter_.SetConfig(plugin_config_.registry_config.load_report_config);
+  overload_guard_.SetConfig(plugin_config_.registry_config.overload_protect_config);
+  if (overload_guard_.Enabled() && plugin_config_.registry_config.overload_protect_config.isolate) {
+    TRPC_FMT_WARN("The overloaded instances are isolated with weight 0, the whole service gets no traffic if all "
+                  "of its instances are overloaded together");
+  }
   for (const auto& service_config : plugin_config_.registry_config.services_config) {
     polaris::ServiceKey service_key{service_config.namespace_, service_config.name};
     services_config_.insert(std::make_pair(service_key, service_config));
+    heartbeat_service_keys_.insert(
+        std::make_pair(service_key, std::make_shared<const polaris::ServiceKey>(service_key)));
   }
 
   if (trpc::TrpcShareContext::GetInstance()->Init(plugin_config_) != 0) {
@@ -67,13 +196,79 @@ int PolarisMeshRegistry::Init() noexcept {
   return 0;
 }
 
+void PolarisMeshRegistry::Start() noexcept {
+  if (!init_ || timer_task_id_ != 0) {
+    return;
+  }
+
+  timer_task_id_ = PeripheryTaskScheduler::GetInstance()->SubmitInnerPeriodicalTask(
+      [this]() {
+        if (plugin_config_.registry_config.coalesce_heartbeat) {
+          SendDueHeartbeats(trpc::time::GetMilliSeconds());
+        }
+      },
+      kRegistryTimerTickMs, "PolarisMeshRegistryTimer");
+
+  // Each registration blocks for up to the heartbeat timeout while the registry is unreachable, so the registrations
+  // run on their own timer
+  update_task_id_ = PeripheryTaskScheduler::GetInstance()->SubmitInnerPeriodicalTask(
+      [this]() {
+        uint64_t now_ms = trpc::time::GetMilliSeconds();
+        ProcessDrains(now_ms);
+        ProcessMetadataUpdates(now_ms);
+        if (load_reporter_.Enabled()) {
+          ProcessLoadReport(now_ms);
+        }
+        if (overload_guard_.Enabled()) {
+          ProcessOverload(now_ms);
+        }
+        if (plugin_config_.registry_config.register_retry) {
+          ProcessRegisterRetries(now_ms);
+        }
+        ProcessHeartbeatRecovery();
+      },
+      kRegistryUpdateTickMs, "PolarisMeshRegistryUpdateTimer");
+}
+
+void PolarisMeshRegistry::Stop() noexcept {
+  if (timer_task_id_ != 0) {
+    PeripheryTaskScheduler::GetInstance()->StopInnerTask(timer_task_id_);
+    PeripheryTaskScheduler::GetInstance()->RemoveInnerTask(timer_task_id_);
+    timer_task_id_ = 0;
+  }
+  if (update_task_id_ != 0) {
+    PeripheryTaskScheduler::GetInstance()->StopInnerTask(update_task_id_);
+    PeripheryTaskScheduler::GetInstance()->RemoveInnerTask(update_task_id_);
+    update_task_id_ = 0;
+  }
+  // The draining instances are not left registered, and the pending metadata updates are not lost
+  ProcessDrains(std::numeric_limits<uint64_t>::max());
+  ProcessMetadataUpdates(std::numeric_limits<uint64_t>::max());
+}
+
 void PolarisMeshRegistry::Destroy() noexcept {
   if (!init_) {
     TRPC_FMT_DEBUG("No init yet");
     return;
   }
 
+  ProcessDrains(std::numeric_limits<uint64_t>::max());
+  heartbeat_scheduler_.Clear();
+  {
+    std::scoped_lock<std::mutex> lock(registered_mutex_);
+    for (auto& [key, instance] : registered_instances_) {
+      for (auto& promise : instance.update_promises) {
+        promise.SetException(CommonException("The registry is destroyed"));
+      }
+    }
+    registered_instances_.clear();
+  }
+  {
+    std::scoped_lock<std::mutex> lock(retry_mutex_);
+    retry_instances_.clear();
+  }
   services_config_.clear();
+  heartbeat_service_keys_.clear();
   provider_api_ = nullptr;
   trpc::TrpcShareContext::GetInstance()->Destroy();
   init_ = false;
@@ -103,6 +298,109 @@ PolarisMeshRegistryInfo PolarisMeshRegistry::SetupPolarisMeshRegistryInfo(const
 }
 
 int PolarisMeshRegistry::Register(const RegistryInfo* info) {
+  bool register_retry = init_ && info != nullptr && plugin_config_.registry_config.register_retry;
+  if (RegisterAndKeepInstance(info, heartbeat_timeout_) == 0) {
+    if (register_retry) {
+      RemoveRegisterRetry(*info);
+    }
+    return 0;
+  }
+
+  if (register_retry) {
+    AddRegisterRetry(*info, trpc::time::GetMilliSeconds());
+  }
+  return -1;
+}
+
+int PolarisMeshRegistry::RegisterAndKeepInstance(const RegistryInfo* info, uint64_t timeout) {
+  if (info == nullptr) {
+    TRPC_FMT_ERROR("Input parameter is empty");
+    return -1;
+  }
+
+  std::string key = HeartbeatScheduler::MakeKey(info->name, info->host, info->port);
+  std::map<std::string, std::string> metadata;
+  {
+    std::scoped_lock<std::mutex> lock(registered_mutex_);
+    auto it = registered_instances_.find(key);
+    if (it != registered_instances_.end()) {
+      metadata = it->second.metadata;
+    }
+  }
+
+  // The instance is registered with the scaled weight, and kept with the configured one
+  RegistryInfo scaled_info = *info;
+  ScaleWeight(scaled_info);
+  RegistryRequestTemplatePtr request_template;
+  if (RegisterInstance(&scaled_info, timeout, &metadata, &request_template) != 0) {
+    return -1;
+  }
+  const_cast<RegistryInfo*>(info)->meta["instance_id"] = scaled_info.meta["instance_id"];
+
+  std::scoped_lock<std::mutex> lock(registered_mutex_);
+  RegisteredInstance& instance = registered_instances_[key];
+  instance.info = *info;
+  instance.request_template = std::move(request_template);
+  instance.registered_weight = GetIntFromMetadata(scaled_info.meta, "weight", 100);
+  return 0;
+}
+
+int PolarisMeshRegistry::RegisterBatch(const std::vector<RegistryInfo*>& infos, uint64_t timeout,
+                                       std::vector<std::size_t>* failed_indexes) {
+  if (!init_) {
+    TRPC_FMT_ERROR("No init yet");
+    return -1;
+  }
+
+  uint64_t deadline_ms = trpc::time::GetMilliSeconds() + (timeout == 0 ? heartbeat_timeout_ : timeout);
+  std::vector<int> results(infos.size(), -1);
+  std::atomic<std::size_t> next_index{0};
+  auto register_instances = [&]() {
+    for (std::size_t i = next_index.fetch_add(1); i < infos.size(); i = next_index.fetch_add(1)) {
+      uint64_t now_ms = trpc::time::GetMilliSeconds();
+      if (now_ms >= deadline_ms) {
+        TRPC_FMT_ERROR("Register timeout in batch, index:{}", i);
+        continue;
+      }
+      // The timeout of each request is bounded by the deadline of the batch
+      results[i] = RegisterAndKeepInstance(infos[i], std::min(heartbeat_timeout_, deadline_ms - now_ms));
+    }
+  };
+
+  // The SDK register calls are blocking, they run on dedicated threads instead of the framework workers. The instances
+  // left when the deadline passes fail without being sent
+  std::size_t thread_num = std::min(infos.size(), kMaxRegisterConcurrency);
+  std::vector<std::thread> threads;
+  threads.reserve(thread_num);
+  for (std::size_t i = 0; i < thread_num; ++i) {
+    threads.emplace_back(register_instances);
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  int ret = 0;
+  uint64_t now_ms = trpc::time::GetMilliSeconds();
+  bool register_retry = plugin_config_.registry_config.register_retry;
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    if (results[i] != 0) {
+      ret = -1;
+      if (failed_indexes != nullptr) {
+        failed_indexes->push_back(i);
+      }
+      if (register_retry && infos[i] != nullptr) {
+        AddRegisterRetry(*infos[i], now_ms);
+      }
+    } else if (register_retry) {
+      RemoveRegisterRetry(*infos[i]);
+    }
+  }
+  return ret;
+}
+
+int PolarisMeshRegistry::RegisterInstance(const RegistryInfo* info, uint64_t timeout,
+                                          const std::map<std::string, std::string>* metadata,
+                                          RegistryRequestTemplatePtr* request_template, bool add_heartbeat) {
   if (!init_) {
     TRPC_FMT_ERROR("No init yet");
     return -1;
@@ -114,6 +412,16 @@ int PolarisMeshRegistry::Register(const RegistryInfo* info) {
   }
 
   PolarisMeshRegistryInfo polarismesh_registry_info = SetupPolarisMeshRegistryInfo(*info);
+  polarismesh_registry_info.timeout = timeout;
+  if (metadata != nullptr) {
+    for (const auto& [key, value] : *metadata) {
+      if (value.empty()) {
+        polarismesh_registry_info.metadata.erase(key);
+      } else {
+        polarismesh_registry_info.metadata[key] = value;
+      }
+    }
+  }
 
   // When the business does not indicate the health check, whether the health check will be turned on based on the
   // global configuration as the subject
@@ -138,6 +446,17 @@ int PolarisMeshRegistry::Register(const RegistryInfo* info) {
   polaris::ReturnCode ret = provider_api_->Register(register_req, polarismesh_registry_info.instance_id);
   if (ret == polaris::ReturnCode::kReturnOk || ret == polaris::ReturnCode::kReturnExistedResource) {
     const_cast<RegistryInfo*>(info)->meta["instance_id"] = polarismesh_registry_info.instance_id;
+    bool coalesce_heartbeat = plugin_config_.registry_config.coalesce_heartbeat && add_heartbeat;
+    if (coalesce_heartbeat || request_template != nullptr) {
+      RegistryRequestTemplatePtr registered_template = MakeRequestTemplate(polarismesh_registry_info);
+      if (coalesce_heartbeat) {
+        heartbeat_scheduler_.Add(HeartbeatScheduler::MakeKey(info->name, info->host, info->port),
+                                 registered_template->heartbeat_target, trpc::time::GetMilliSeconds());
+      }
+      if (request_template != nullptr) {
+        *request_template = std::move(registered_template);
+      }
+    }
     return 0;
   }
 
@@ -157,6 +476,27 @@ int PolarisMeshRegistry::Unregister(const RegistryInfo* info) {
     return -1;
   }
 
+  // The instance stops being kept before its heartbeat is removed, so that the heartbeat is not added back by a
+  // concurrent update of the kept instance
+  RegistryRequestTemplatePtr request_template;
+  RemoveKeptInstance(*info, &request_template);
+  if (plugin_config_.registry_config.coalesce_heartbeat) {
+    heartbeat_scheduler_.Remove(HeartbeatScheduler::MakeKey(info->name, info->host, info->port));
+  }
+  RemoveRegisterRetry(*info);
+
+  // The instance registered by Register is deregistered by the request resolved at the registration
+  if (request_template != nullptr) {
+    polaris::ReturnCode ret = provider_api_->Deregister(*request_template->deregister_request);
+    if (ret == polaris::ReturnCode::kReturnOk) {
+      return 0;
+    }
+    const polaris::ServiceKey& service_key = request_template->heartbeat_target->service_key;
+    TRPC_FMT_ERROR("Deregister failed, sdk returnCode:{}, service_name:{}, service_namespace:{}",
+                   static_cast<int32_t>(ret), service_key.name_, service_key.namespace_);
+    return -1;
+  }
+
   PolarisMeshRegistryInfo polarismesh_registry_info = SetupPolarisMeshRegistryInfo(*info);
 
   std::shared_ptr<polaris::InstanceDeregisterRequest> deregister_ptr = nullptr;
@@ -182,6 +522,428 @@ int PolarisMeshRegistry::Unregister(const RegistryInfo* info) {
   return -1;
 }
 
+std::map<std::string, std::string> PolarisMeshRegistry::RemoveKeptInstance(
+    const RegistryInfo& info, RegistryRequestTemplatePtr* request_template) {
+  std::map<std::string, std::string> metadata;
+  std::vector<Promise<>> promises;
+  {
+    std::scoped_lock<std::mutex> lock(registered_mutex_);
+    auto it = registered_instances_.find(HeartbeatScheduler::MakeKey(info.name, info.host, info.port));
+    if (it == registered_instances_.end()) {
+      return metadata;
+    }
+    metadata = std::move(it->second.metadata);
+    promises = std::move(it->second.update_promises);
+    if (request_template != nullptr) {
+      *request_template = std::move(it->second.request_template);
+    }
+    registered_instances_.erase(it);
+  }
+
+  for (auto& promise : promises) {
+    promise.SetException(CommonException("The instance is deregistered"));
+  }
+  return metadata;
+}
+
+bool PolarisMeshRegistry::HasRegistryToken(const RegistryInfo& info) const {
+  if (!GetStringFromMetadata(info.meta, "token", "").empty()) {
+    return true;
+  }
+
+  std::string service_namespace = trpc::TrpcConfig::GetInstance()->GetGlobalConfig().env_namespace;
+  if (service_namespace.empty()) {
+    service_namespace = GetStringFromMetadata(info.meta, "namespace", "");
+  }
+  return services_config_.find(polaris::ServiceKey{service_namespace, info.name}) != services_config_.end();
+}
+
+void PolarisMeshRegistry::AddRegisterRetry(const RegistryInfo& info, uint64_t now_ms) {
+  // The registration which fails for the configuration never succeeds
+  if (!HasRegistryToken(info)) {
+    return;
+  }
+
+  std::scoped_lock<std::mutex> lock(retry_mutex_);
+  auto [it, inserted] = retry_instances_.try_emplace(HeartbeatScheduler::MakeKey(info.name, info.host, info.port));
+  it->second.info = info;
+  if (inserted) {
+    it->second.failures = 1;
+    it->second.due_ms = now_ms + GetRegisterRetryInterval(it->second.failures);
+    TRPC_FMT_WARN("Register failed, retry in the background, service_name:{}, host:{}, port:{}", info.name,
+                  info.host, info.port);
+  }
+}
+
+void PolarisMeshRegistry::RemoveRegisterRetry(const RegistryInfo& info) {
+  std::scoped_lock<std::mutex> lock(retry_mutex_);
+  retry_instances_.erase(HeartbeatScheduler::MakeKey(info.name, info.host, info.port));
+}
+
+std::size_t PolarisMeshRegistry::GetRegisterRetrySize() {
+  std::scoped_lock<std::mutex> lock(retry_mutex_);
+  return retry_instances_.size();
+}
+
+uint64_t PolarisMeshRegistry::GetRegisterRetryInterval(uint32_t failures) const {
+  const auto& registry_config = plugin_config_.registry_config;
+  uint32_t shift = std::min<uint32_t>(failures > 0 ? failures - 1 : 0, 20);
+  return std::min(registry_config.register_retry_min_interval << shift, registry_config.register_retry_max_interval);
+}
+
+void PolarisMeshRegistry::ProcessRegisterRetries(uint64_t now_ms) {
+  std::vector<RetryInstance> due_instances;
+  {
+    std::scoped_lock<std::mutex> lock(retry_mutex_);
+    for (const auto& [key, instance] : retry_instances_) {
+      if (now_ms >= instance.due_ms) {
+        due_instances.push_back(instance);
+      }
+    }
+  }
+
+  std::set<std::string> registered_keys;
+  for (auto& instance : due_instances) {
+    std::string key = HeartbeatScheduler::MakeKey(instance.info.name, instance.info.host, instance.info.port);
+    int ret = RegisterAndKeepInstance(&instance.info, heartbeat_timeout_);
+    bool deregistered = false;
+    {
+      std::scoped_lock<std::mutex> lock(retry_mutex_);
+      auto it = retry_instances_.find(key);
+      deregistered = it == retry_instances_.end();
+      if (ret == 0 && !deregistered) {
+        retry_instances_.erase(it);
+      } else if (ret != 0 && !deregistered) {
+        it->second.failures = instance.failures + 1;
+        it->second.due_ms = now_ms + GetRegisterRetryInterval(it->second.failures);
+      }
+    }
+
+    if (ret == 0) {
+      registered_keys.insert(key);
+      // The instance is deregistered by the business during the retry
+      if (deregistered) {
+        Unregister(&instance.info);
+      }
+    }
+  }
+
+  // The kept instances may be expired on the registry during the outage, so that they are registered again to
+  // reconcile the registry with the desired state
+  if (!registered_keys.empty()) {
+    TRPC_FMT_INFO("Register retry succeeds, register the kept instances again, retried:{}", registered_keys.size());
+    UpdateKeptInstances(registered_keys);
+  }
+}
+
+void PolarisMeshRegistry::ProcessHeartbeatRecovery() {
+  bool recovered = false;
+  {
+    std::scoped_lock<std::mutex> lock(registered_mutex_);
+    for (const auto& [key, instance] : registered_instances_) {
+      if (instance.request_template != nullptr &&
+          instance.request_template->heartbeat_target->recovered.exchange(false, std::memory_order_relaxed)) {
+        recovered = true;
+      }
+    }
+  }
+
+  if (recovered) {
+    TRPC_FMT_INFO("The heartbeats recover, register the kept instances again");
+    UpdateKeptInstances();
+  }
+}
+
+Future<> PolarisMeshRegistry::UpdateMetadata(const RegistryInfo* info,
+                                             const std::map<std::string, std::string>& metadata) {
+  if (!init_) {
+    std::string error_str("No init yet");
+    TRPC_LOG_ERROR(error_str);
+    return MakeExceptionFuture<>(CommonException(error_str.c_str()));
+  }
+
+  if (info == nullptr) {
+    std::string error_str("Input parameter is empty");
+    TRPC_LOG_ERROR(error_str);
+    return MakeExceptionFuture<>(CommonException(error_str.c_str()));
+  }
+
+  std::scoped_lock<std::mutex> lock(registered_mutex_);
+  auto it = registered_instances_.find(HeartbeatScheduler::MakeKey(info->name, info->host, info->port));
+  if (it == registered_instances_.end()) {
+    std::string error = "Update the metadata of an unregistered instance, service_name:" + info->name;
+    TRPC_LOG_ERROR(error);
+    return MakeExceptionFuture<>(CommonException(error.c_str()));
+  }
+
+  RegisteredInstance& instance = it->second;
+  bool changed = false;
+  for (const auto& [key, value] : metadata) {
+    auto [metadata_it, inserted] = instance.metadata.try_emplace(key, value);
+    if (inserted || metadata_it->second != value) {
+      metadata_it->second = value;
+      changed = true;
+    }
+  }
+  if (!changed && instance.first_change_ms == 0) {
+    return MakeReadyFuture<>();
+  }
+
+  // Each change delays the update, which is bounded by the max delay since the first change
+  uint64_t now_ms = trpc::time::GetMilliSeconds();
+  if (instance.first_change_ms == 0) {
+    instance.first_change_ms = now_ms;
+  }
+  if (changed) {
+    const auto& registry_config = plugin_config_.registry_config;
+    instance.update_due_ms = std::min(now_ms + registry_config.metadata_update_delay,
+                                      instance.first_change_ms + registry_config.metadata_update_max_delay);
+  }
+  instance.update_promises.emplace_back();
+  return instance.update_promises.back().GetFuture();
+}
+
+RegistryRequestTemplatePtr PolarisMeshRegistry::MakeRequestTemplate(
+    const PolarisMeshRegistryInfo& polarismesh_registry_info) const {
+  auto request_template = std::make_shared<RegistryRequestTemplate>();
+  request_template->heartbeat_target =
+      MakeHeartbeatTarget(polarismesh_registry_info.service_namespace, polarismesh_registry_info.service_name,
+                          polarismesh_registry_info.service_token, polarismesh_registry_info.instance_id,
+                          polarismesh_registry_info.host, polarismesh_registry_info.port,
+                          polarismesh_registry_info.ttl);
+  if (polarismesh_registry_info.instance_id.empty()) {
+    request_template->deregister_request = std::make_unique<polaris::InstanceDeregisterRequest>(
+        polarismesh_registry_info.service_namespace, polarismesh_registry_info.service_name,
+        polarismesh_registry_info.service_token, polarismesh_registry_info.host, polarismesh_registry_info.port);
+  } else {
+    request_template->deregister_request = std::make_unique<polaris::InstanceDeregisterRequest>(
+        polarismesh_registry_info.service_token, polarismesh_registry_info.instance_id);
+  }
+  request_template->deregister_request->SetTimeout(heartbeat_timeout_);
+  return request_template;
+}
+
+RegistryRequestTemplatePtr PolarisMeshRegistry::FindRequestTemplate(const RegistryInfo& info) {
+  std::scoped_lock<std::mutex> lock(registered_mutex_);
+  auto it = registered_instances_.find(HeartbeatScheduler::MakeKey(info.name, info.host, info.port));
+  return it == registered_instances_.end() ? nullptr : it->second.request_template;
+}
+
+void PolarisMeshRegistry::UpdateKeptInstances(const std::set<std::string>& excluded_keys) {
+  std::vector<std::pair<RegistryInfo, std::map<std::string, std::string>>> instances;
+  {
+    std::scoped_lock<std::mutex> lock(registered_mutex_);
+    instances.reserve(registered_instances_.size());
+    for (const auto& [key, instance] : registered_instances_) {
+      if (excluded_keys.count(key) == 0) {
+        instances.emplace_back(instance.info, instance.metadata);
+      }
+    }
+  }
+
+  for (auto& [info, metadata] : instances) {
+    UpdateKeptInstance(std::move(info), metadata);
+  }
+}
+
+void PolarisMeshRegistry::ProcessMetadataUpdates(uint64_t now_ms) {
+  struct MetadataUpdate {
+    RegistryInfo info;
+    std::map<std::string, std::string> metadata;
+    std::vector<Promise<>> promises;
+  };
+  std::vector<MetadataUpdate> updates;
+  {
+    std::scoped_lock<std::mutex> lock(registered_mutex_);
+    for (auto& [key, instance] : registered_instances_) {
+      if (instance.first_change_ms == 0 || now_ms < instance.update_due_ms) {
+        continue;
+      }
+      updates.push_back(MetadataUpdate{instance.info, instance.metadata, std::move(instance.update_promises)});
+      instance.update_promises.clear();
+      instance.first_change_ms = 0;
+      instance.update_due_ms = 0;
+    }
+  }
+
+  for (auto& update : updates) {
+    int ret = UpdateKeptInstance(update.info, update.metadata);
+    for (auto& promise : update.promises) {
+      if (ret == 0) {
+        promise.SetValue();
+      } else {
+        promise.SetException(CommonException("Update the metadata of the instance failed"));
+      }
+    }
+  }
+}
+
+void PolarisMeshRegistry::ScaleWeight(RegistryInfo& info) {
+  if (!load_reporter_.Enabled() && !overload_guard_.Enabled()) {
+    return;
+  }
+
+  uint32_t base_weight = static_cast<uint32_t>(GetIntFromMetadata(info.meta, "weight", 100));
+  uint32_t weight = base_weight;
+  if (load_reporter_.Enabled()) {
+    weight = LoadReporter::CalculateWeight(base_weight, load_reporter_.GetPublishedFactor());
+  }
+  if (overload_guard_.Enabled()) {
+    weight = std::min(weight, overload_guard_.GetWeight(base_weight));
+  }
+  info.meta["weight"] = std::to_string(weight);
+}
+
+int PolarisMeshRegistry::UpdateKeptInstance(RegistryInfo info, const std::map<std::string, std::string>& metadata) {
+  ScaleWeight(info);
+  // The heartbeat is added only if the instance is still kept after the registration
+  RegistryRequestTemplatePtr request_template;
+  if (RegisterInstance(&info, heartbeat_timeout_, &metadata, &request_template, false) != 0) {
+    TRPC_FMT_ERROR("Update the registered instance failed, service_name:{}, host:{}, port:{}", info.name, info.host,
+                   info.port);
+    return -1;
+  }
+
+  std::string key = HeartbeatScheduler::MakeKey(info.name, info.host, info.port);
+  {
+    std::scoped_lock<std::mutex> lock(registered_mutex_);
+    auto it = registered_instances_.find(key);
+    if (it != registered_instances_.end()) {
+      it->second.registered_weight = GetIntFromMetadata(info.meta, "weight", 100);
+      // The heartbeats go on with the requests of the latest registration, whose recovery is watched
+      it->second.request_template = request_template;
+      if (plugin_config_.registry_config.coalesce_heartbeat) {
+        heartbeat_scheduler_.Add(key, request_template->heartbeat_target, trpc::time::GetMilliSeconds());
+      }
+      return 0;
+    }
+  }
+
+  // The instance is unregistered or drained during the registration, which may have been overridden by it. A draining
+  // instance is set back to weight 0, and an unregistered one is deregistered again
+  bool draining = false;
+  {
+    std::scoped_lock<std::mutex> lock(drain_mutex_);
+    draining = draining_keys_.count(key) > 0;
+  }
+  TRPC_FMT_WARN("The instance is removed during the update, undo the update, service_name:{}, host:{}, port:{}, "
+                "draining:{}", info.name, info.host, info.port, draining);
+  if (draining) {
+    info.meta["weight"] = "0";
+    RegisterInstance(&info, heartbeat_timeout_, &metadata, nullptr, false);
+  } else {
+    provider_api_->Deregister(*request_template->deregister_request);
+  }
+  return -1;
+}
+
+int PolarisMeshRegistry::GetRegisteredWeight(const RegistryInfo& info) {
+  std::scoped_lock<std::mutex> lock(registered_mutex_);
+  auto it = registered_instances_.find(HeartbeatScheduler::MakeKey(info.name, info.host, info.port));
+  if (it == registered_instances_.end()) {
+    return -1;
+  }
+  return it->second.registered_weight;
+}
+
+Future<> PolarisMeshRegistry::DrainAndUnregister(const RegistryInfo* info,
+                                                 std::function<uint64_t()> inflight_getter) {
+  if (!init_) {
+    std::string error_str("No init yet");
+    TRPC_LOG_ERROR(error_str);
+    return MakeExceptionFuture<>(CommonException(error_str.c_str()));
+  }
+
+  if (info == nullptr) {
+    std::string error_str("Input parameter is empty");
+    TRPC_LOG_ERROR(error_str);
+    return MakeExceptionFuture<>(CommonException(error_str.c_str()));
+  }
+
+  // The weight of the draining instance is not restored by the load report or the metadata update. The instance is
+  // marked as draining before it stops being kept, so that a concurrent update sets its weight back to 0
+  std::string key = HeartbeatScheduler::MakeKey(info->name, info->host, info->port);
+  {
+    std::scoped_lock<std::mutex> lock(drain_mutex_);
+    draining_keys_.insert(key);
+  }
+  std::map<std::string, std::string> metadata = RemoveKeptInstance(*info);
+  RemoveRegisterRetry(*info);
+
+  // The registered instance is updated with weight 0, so that the callers stop picking it after they refresh it. It is
+  // still deregistered later if the update fails
+  DrainingInstance draining_instance;
+  draining_instance.info = *info;
+  draining_instance.info.meta["weight"] = "0";
+  if (RegisterInstance(&draining_instance.info, heartbeat_timeout_, &metadata) != 0) {
+    TRPC_FMT_ERROR("Set the weight of the draining instance to 0 failed, service_name:{}, host:{}, port:{}", info->name,
+                   info->host, info->port);
+  }
+
+  uint64_t now_ms = trpc::time::GetMilliSeconds();
+  draining_instance.inflight_getter = std::move(inflight_getter);
+  draining_instance.propagated_ms = now_ms + plugin_config_.registry_config.drain_delay;
+  draining_instance.deadline_ms = draining_instance.propagated_ms + plugin_config_.registry_config.drain_timeout;
+  Future<> future = draining_instance.promise.GetFuture();
+
+  std::scoped_lock<std::mutex> lock(drain_mutex_);
+  draining_instances_.push_back(std::move(draining_instance));
+  return future;
+}
+
+void PolarisMeshRegistry::ProcessDrains(uint64_t now_ms) {
+  std::list<DrainingInstance> drained_instances;
+  {
+    std::scoped_lock<std::mutex> lock(drain_mutex_);
+    for (auto it = draining_instances_.begin(); it != draining_instances_.end();) {
+      bool drained = now_ms >= it->deadline_ms ||
+                     (now_ms >= it->propagated_ms && (!it->inflight_getter || it->inflight_getter() == 0));
+      if (drained) {
+        draining_keys_.erase(draining_keys_.find(HeartbeatScheduler::MakeKey(it->info.name, it->info.host,
+                                                                             it->info.port)));
+        auto drained_it = it++;
+        drained_instances.splice(drained_instances.end(), draining_instances_, drained_it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  for (auto& drained_instance : drained_instances) {
+    if (Unregister(&drained_instance.info) == 0) {
+      drained_instance.promise.SetValue();
+    } else {
+      std::string error = "Unregister the drained instance failed, service_name:" + drained_instance.info.name;
+      drained_instance.promise.SetException(CommonException(error.c_str()));
+    }
+  }
+}
+
+void PolarisMeshRegistry::ProcessLoadReport(uint64_t now_ms) {
+  if (!load_reporter_.ShouldSample(now_ms)) {
+    return;
+  }
+  load_reporter_.Update(load_reporter_.Sample(now_ms));
+  if (!load_reporter_.ShouldPublish(now_ms)) {
+    return;
+  }
+
+  // The weights are published by updating the registered instances, whose registered weights are the base. A failed
+  // instance keeps its weight until the next publishing
+  load_reporter_.MarkPublished(now_ms);
+  UpdateKeptInstances();
+}
+
+void PolarisMeshRegistry::ProcessOverload(uint64_t now_ms) {
+  if (!overload_guard_.Evaluate(now_ms, load_reporter_.GetQueueSize())) {
+    return;
+  }
+
+  TRPC_FMT_INFO("The server {}, update the weights of the registered instances",
+                overload_guard_.IsOverloaded() ? "is overloaded" : "recovers from the overload");
+  UpdateKeptInstances();
+}
+
 int PolarisMeshRegistry::HeartBeat(const RegistryInfo* info) {
   TRPC_FMT_DEBUG("HeartBeat Start...");
   if (!init_) {
@@ -194,6 +956,29 @@ int PolarisMeshRegistry::HeartBeat(const RegistryInfo* info) {
     return -1;
   }
 
+  // The heartbeats of the added instances are sent by the timer of the plugin
+  std::string heartbeat_key;
+  if (plugin_config_.registry_config.coalesce_heartbeat) {
+    heartbeat_key = HeartbeatScheduler::MakeKey(info->name, info->host, info->port);
+    if (heartbeat_scheduler_.Contains(heartbeat_key)) {
+      return 0;
+    }
+  }
+
+  // The instance registered by Register reuses the request resolved at the registration
+  if (heartbeat_key.empty()) {
+    if (RegistryRequestTemplatePtr request_template = FindRequestTemplate(*info)) {
+      const HeartbeatTargetPtr& target = request_template->heartbeat_target;
+      polaris::ReturnCode ret = provider_api_->Heartbeat(*target->request);
+      if (ret == polaris::ReturnCode::kReturnOk) {
+        return 0;
+      }
+      TRPC_FMT_ERROR("Heartbeat failed, sdk returnCode:{}, service_name:{}, service_namespace:{}",
+                     static_cast<int32_t>(ret), target->service_key.name_, target->service_key.namespace_);
+      return -1;
+    }
+  }
+
   std::string service_namespace = trpc::TrpcConfig::GetInstance()->GetGlobalConfig().env_namespace;
   if (service_namespace.empty()) {
     service_namespace = GetStringFromMetadata(info->meta, "namespace", "");
@@ -207,6 +992,15 @@ int PolarisMeshRegistry::HeartBeat(const RegistryInfo* info) {
     return -1;
   }
 
+  if (!heartbeat_key.empty()) {
+    heartbeat_scheduler_.Add(heartbeat_key,
+                             MakeHeartbeatTarget(service_namespace, service_name, it->second.token,
+                                                 it->second.instance_id, info->host, info->port,
+                                                 GetIntFromMetadata(info->meta, "ttl", 0)),
+                             trpc::time::GetMilliSeconds());
+    return 0;
+  }
+
   polaris::ReturnCode ret = polaris::ReturnCode::kReturnOk;
   if (it->second.instance_id.empty()) {
     polaris::InstanceHeartbeatRequest heartbeat_req(service_namespace, service_name, it->second.token, info->host,
@@ -242,6 +1036,34 @@ Future<> PolarisMeshRegistry::AsyncHeartBeat(const RegistryInfo* info) {
     return MakeExceptionFuture<>(CommonException(error_str.c_str()));
   }
 
+  // The heartbeats of the added instances are sent by the timer of the plugin
+  std::string heartbeat_key;
+  if (plugin_config_.registry_config.coalesce_heartbeat) {
+    heartbeat_key = HeartbeatScheduler::MakeKey(info->name, info->host, info->port);
+    if (heartbeat_scheduler_.Contains(heartbeat_key)) {
+      return trpc::MakeReadyFuture<>();
+    }
+  }
+
+  // The instance registered by Register reuses the request resolved at the registration
+  if (heartbeat_key.empty()) {
+    if (RegistryRequestTemplatePtr request_template = FindRequestTemplate(*info)) {
+      const HeartbeatTargetPtr& target = request_template->heartbeat_target;
+      Promise<> promise;
+      Future<> future = promise.GetFuture();
+      PolarisMeshHeartbeatCallback* callback = new PolarisMeshHeartbeatCallback(target, std::move(promise));
+      polaris::ReturnCode ret = provider_api_->AsyncHeartbeat(*target->request, callback);
+      if (ret != polaris::ReturnCode::kReturnOk) {
+        std::stringstream error;
+        error << "AsyncHeartBeat failed, sdk returnCode:" << ret << ", service_name:" << target->service_key.name_
+              << ", service_namespace:" << target->service_key.namespace_;
+        TRPC_LOG_ERROR(error.str());
+        return MakeExceptionFuture<>(CommonException(error.str().c_str()));
+      }
+      return future;
+    }
+  }
+
   std::string service_namespace = trpc::TrpcConfig::GetInstance()->GetGlobalConfig().env_namespace;
   if (service_namespace.empty()) {
     service_namespace = GetStringFromMetadata(info->meta, "namespace", "");
@@ -257,20 +1079,31 @@ Future<> PolarisMeshRegistry::AsyncHeartBeat(const RegistryInfo* info) {
     return MakeExceptionFuture<>(CommonException(error.str().c_str()));
   }
 
+  if (!heartbeat_key.empty()) {
+    heartbeat_scheduler_.Add(heartbeat_key,
+                             MakeHeartbeatTarget(service_namespace, service_name, it->second.token,
+                                                 it->second.instance_id, info->host, info->port,
+                                                 GetIntFromMetadata(info->meta, "ttl", 0)),
+                             trpc::time::GetMilliSeconds());
+    return trpc::MakeReadyFuture<>();
+  }
+
   polaris::ReturnCode ret = polaris::ReturnCode::kReturnOk;
-  PolarisMeshHeartbeatCallback* callback = new PolarisMeshHeartbeatCallback(service_key);
+  // The future is completed by the callback with the result of the heartbeat
+  Promise<> promise;
+  Future<> future = promise.GetFuture();
+  PolarisMeshHeartbeatCallback* callback =
+      new PolarisMeshHeartbeatCallback(heartbeat_service_keys_.at(service_key), std::move(promise));
   if (it->second.instance_id.empty()) {
     polaris::InstanceHeartbeatRequest heartbeat_req(service_namespace, service_name, it->second.token, info->host,
                                                     info->port);
     heartbeat_req.SetTimeout(heartbeat_timeout_);
-    // The call is returned immediately, and the follow -up process is executed in the callback (currently only the need
-    // for printing logs)
+    // The call is returned immediately, and the follow -up process is executed in the callback
     ret = provider_api_->AsyncHeartbeat(heartbeat_req, callback);
   } else {
     polaris::InstanceHeartbeatRequest heartbeat_req(it->second.token, it->second.instance_id);
     heartbeat_req.SetTimeout(heartbeat_timeout_);
-    // The call is returned immediately, and the follow -up process is executed in the callback (currently only the need
-    // for printing logs)
+    // The call is returned immediately, and the follow -up process is executed in the callback
     ret = provider_api_->AsyncHeartbeat(heartbeat_req, callback);
   }
 
@@ -282,7 +1115,41 @@ Future<> PolarisMeshRegistry::AsyncHeartBeat(const RegistryInfo* info) {
     return MakeExceptionFuture<>(CommonException(error.str().c_str()));
   }
 
-  return trpc::MakeReadyFuture<>();
+  return future;
+}
+
+HeartbeatTargetPtr PolarisMeshRegistry::MakeHeartbeatTarget(const std::string& service_namespace,
+                                                            const std::string& service_name, const std::string& token,
+                                                            const std::string& instance_id, const std::string& host,
+                                                            int port, int ttl) const {
+  auto target = std::make_shared<HeartbeatTarget>();
+  target->service_key = polaris::ServiceKey{service_namespace, service_name};
+  if (instance_id.empty()) {
+    target->request =
+        std::make_unique<polaris::InstanceHeartbeatRequest>(service_namespace, service_name, token, host, port);
+  } else {
+    target->request = std::make_unique<polaris::InstanceHeartbeatRequest>(token, instance_id);
+  }
+  target->request->SetTimeout(heartbeat_timeout_);
+  target->ttl = static_cast<uint64_t>(ttl > 0 ? ttl : kDefaultHeartbeatTtl) * 1000;
+  return target;
+}
+
+void PolarisMeshRegistry::SendDueHeartbeats(uint64_t now_ms) {
+  if (!init_) {
+    return;
+  }
+
+  for (const auto& target : heartbeat_scheduler_.TakeDue(now_ms)) {
+    // The callback is released by the SDK after the response, and shares the service key of the target
+    PolarisMeshHeartbeatCallback* callback = new PolarisMeshHeartbeatCallback(target);
+    polaris::ReturnCode ret = provider_api_->AsyncHeartbeat(*target->request, callback);
+    if (ret != polaris::ReturnCode::kReturnOk) {
+      target->failures.fetch_add(1, std::memory_order_relaxed);
+      TRPC_FMT_ERROR("AsyncHeartBeat failed, sdk returnCode:{}, service_name:{}, service_namespace:{}",
+                     static_cast<int32_t>(ret), target->service_key.name_, target->service_key.namespace_);
+    }
+  }
 }
 
 int PolarisMeshRegistry::GetTokenFromRegistryConfig(PolarisMeshRegistryInfo& polarismesh_registry_info) {
@@ -13,10 +13,17 @@
 
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <list>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <set>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 #include "polaris/context.h"
 #include "polaris/provider.h"
@@ -24,31 +31,52 @@
 #include "trpc/naming/common/common_defs.h"
 #include "trpc/naming/polarismesh/common.h"
 #include "trpc/naming/polarismesh/config/polarismesh_naming_conf.h"
+#include "trpc/naming/polarismesh/polarismesh_heartbeat_scheduler.h"
+#include "trpc/naming/polarismesh/polarismesh_load_reporter.h"
+#include "trpc/naming/polarismesh/polarismesh_overload_guard.h"
 #include "trpc/naming/registry.h"
 
 namespace trpc {
 
+/// @brief The requests of a registered instance which are resolved at the registration, and reused by its heartbeats
+///        and deregistration instead of resolving the registry info on each call
+struct RegistryRequestTemplate {
+  /// The heartbeat request, which also counts the failed heartbeats of the instance
+  HeartbeatTargetPtr heartbeat_target;
+  std::unique_ptr<polaris::InstanceDeregisterRequest> deregister_request;
+};
+
+using RegistryRequestTemplatePtr = std::shared_ptr<const RegistryRequestTemplate>;
+
 /// @brief h SDK Heartbeat Reporting Asynchronous Return
+/// @note The callback is released by the SDK after the response, its memory is taken from a pool so that no heap
+///       allocation is needed for each heartbeat
 class PolarisMeshHeartbeatCallback : public polaris::ProviderCallback {
  public:
-  explicit PolarisMeshHeartbeatCallback(polaris::ServiceKey& service_key) : service_key_(service_key) {}
-
-  void Response(polaris::ReturnCode code, const std::string& message) override {
-    if (code != polaris::ReturnCode::kReturnOk) {
-      TRPC_FMT_WARN(
-          "AsyncHeartBeat failed, sdk returnCode:{}, message:{}, service_name:{} "
-          "service_namespace:{}",
-          static_cast<int>(code), message, service_key_.name_, service_key_.namespace_);
-    } else {
-      TRPC_FMT_DEBUG(
-          "AsyncHeartBeat success, sdk returnCode:{}, message:{}, service_name:{} "
-          "service_namespace:{}",
-          static_cast<int>(code), message, service_key_.name_, service_key_.namespace_);
-    }
-  }
+  explicit PolarisMeshHeartbeatCallback(polaris::ServiceKey& service_key)
+      : PolarisMeshHeartbeatCallback(std::make_shared<const polaris::ServiceKey>(service_key)) {}
+
+  /// @param service_key The service key shared by the heartbeats of the service
+  /// @param promise Completed with the result of the heartbeat, if it is set
+  explicit PolarisMeshHeartbeatCallback(std::shared_ptr<const polaris::ServiceKey> service_key,
+                                        std::optional<Promise<>> promise = std::nullopt);
+
+  /// @brief The callback of a heartbeat of a registered instance, which counts the failed heartbeats of the instance
+  /// @param promise Completed with the result of the heartbeat, if it is set
+  explicit PolarisMeshHeartbeatCallback(const HeartbeatTargetPtr& target,
+                                        std::optional<Promise<>> promise = std::nullopt);
+
+  void Response(polaris::ReturnCode code, const std::string& message) override;
+
+  static void* operator new(std::size_t size);
+
+  static void operator delete(void* ptr, std::size_t size);
 
  private:
-  polaris::ServiceKey service_key_;
+  std::shared_ptr<const polaris::ServiceKey> service_key_;
+  std::optional<Promise<>> promise_;
+  HeartbeatTargetPtr target_;
+  uint64_t begin_time_us_{0};
 };
 
 /// @brief polarismesh Service Registration Plug -in
@@ -65,27 +93,97 @@ class PolarisMeshRegistry : public Registry {
 
   /// @brief In the internal implementation of the plug -in, it needs to be used when the thread needs to be created.
   /// You can use this interface uniformly
-  void Start() noexcept override {}
+  void Start() noexcept override;
 
   /// @brief When there is a thread in the internal implementation of the plug -in, the interface of the stop thread
   /// needs to be implemented
-  void Stop() noexcept override {}
+  void Stop() noexcept override;
 
   /// @brief Various resources to destroy specific plug -in
   void Destroy() noexcept override;
 
   /// @brief Service registration interface
+  /// @note The metadata updated by UpdateMetadata is kept when the instance is registered again. When the register
+  /// retry is enabled, the failed instance is still registered in the background until it is deregistered
   int Register(const RegistryInfo* info) override;
 
+  /// @brief Register the instances concurrently within one overall timeout, which is useful for the servers with many
+  /// services at startup
+  /// @param infos The instances, the instance id is filled into the meta of each registered instance as Register
+  /// @param timeout The overall timeout of the batch, unit: ms. The heartbeat timeout is used if it is 0
+  /// @param failed_indexes Output the indexes of the instances which are not registered, if it is not null
+  /// @return 0 if all the instances are registered, -1 otherwise
+  /// @note It blocks on the SDK calls with up to 16 dedicated threads and joins them, so it must be called from a
+  /// non-fiber thread, e.g. the main thread before the server starts, not from a fiber worker or a request handler
+  int RegisterBatch(const std::vector<RegistryInfo*>& infos, uint64_t timeout,
+                    std::vector<std::size_t>* failed_indexes = nullptr);
+
   /// @brief Service anti -registration interface
   int Unregister(const RegistryInfo* info) override;
 
+  /// @brief Retry the failed registrations which are due, and register the kept instances again once a retry succeeds
+  /// since the registry recovers, it is called by the update timer of the plugin when the register retry is enabled
+  void ProcessRegisterRetries(uint64_t now_ms);
+
+  /// @brief Register the kept instances again once the heartbeat of one of them succeeds after failures, since they
+  /// may have expired on the registry during the outage, it is called by the update timer of the plugin
+  void ProcessHeartbeatRecovery();
+
+  /// @brief Get the number of the instances waiting for the register retry
+  std::size_t GetRegisterRetrySize();
+
+  /// @brief Update some metadata of a registered instance without registering it again by the business. The changes in
+  /// a short time are merged into one update of the instance, which is sent after no more change comes in the metadata
+  /// update delay (at most the max delay after the first change)
+  /// @param info The registered instance
+  /// @param metadata The changed metadata, the key with an empty value is removed
+  /// @return The future which is completed with the result of the update, which is ready at once if nothing changes
+  Future<> UpdateMetadata(const RegistryInfo* info, const std::map<std::string, std::string>& metadata);
+
+  /// @brief Send the metadata updates which are due, it is called by the update timer of the plugin
+  void ProcessMetadataUpdates(uint64_t now_ms);
+
+  /// @brief Drain the instance before it is deregistered: its weight is set to 0 at once, then it is deregistered after
+  /// the callers have refreshed it (the drain delay) and its in-flight requests have finished (at most the drain
+  /// timeout)
+  /// @param info The instance
+  /// @param inflight_getter Get the number of the in-flight requests of the instance, which are not waited for if it is
+  /// empty
+  /// @return The future which is completed with the result of the deregistration
+  /// @note The drains are driven by the timer of the plugin, and the pending ones are deregistered at once when the
+  /// plugin is stopped
+  Future<> DrainAndUnregister(const RegistryInfo* info, std::function<uint64_t()> inflight_getter = nullptr);
+
+  /// @brief Deregister the drained instances, it is called by the update timer of the plugin
+  void ProcessDrains(uint64_t now_ms);
+
   /// @brief Service heartbeat on the reporting interface
   int HeartBeat(const RegistryInfo* info) override;
 
   /// @brief Service Heartbeat on the interface
   Future<> AsyncHeartBeat(const RegistryInfo* info) override;
 
+  /// @brief Send the heartbeats which are due, it is called by the timer of the plugin when the heartbeats are
+  /// coalesced
+  void SendDueHeartbeats(uint64_t now_ms);
+
+  /// @brief Sample the load of the server and publish the weights of the registered instances scaled by it, it is
+  /// called by the update timer of the plugin when the load report is enabled
+  void ProcessLoadReport(uint64_t now_ms);
+
+  /// @brief Get the load reporter, which counts the requests of the server
+  LoadReporter* GetLoadReporter() { return &load_reporter_; }
+
+  /// @brief Evaluate the overload of the server and update the weights of the registered instances when it is entered
+  /// or left, it is called by the update timer of the plugin when the overload protect is enabled
+  void ProcessOverload(uint64_t now_ms);
+
+  /// @brief Get the overload guard, which records the requests checked by the limiter of the server
+  OverloadGuard* GetOverloadGuard() { return &overload_guard_; }
+
+  /// @brief Get the weight which the kept instance is registered with, -1 if the instance is not kept
+  int GetRegisteredWeight(const RegistryInfo& info);
+
   /// @brief Setter function for plugin_config_
   void SetPluginConfig(const naming::PolarisMeshNamingConfig& config) {
     plugin_config_ = config;
@@ -100,13 +198,117 @@ class PolarisMeshRegistry : public Registry {
 
   PolarisMeshRegistryInfo SetupPolarisMeshRegistryInfo(const RegistryInfo& info);
 
+  /// @brief Register an instance with the timeout of the request, unit: ms
+  /// @param metadata Overrides the metadata of the instance if it is not null, the key with an empty value is removed
+  /// @param request_template Output the requests of the registered instance, if it is not null
+  /// @param add_heartbeat Whether to add the registered instance to the coalesced heartbeats
+  int RegisterInstance(const RegistryInfo* info, uint64_t timeout,
+                       const std::map<std::string, std::string>* metadata = nullptr,
+                       RegistryRequestTemplatePtr* request_template = nullptr, bool add_heartbeat = true);
+
+  /// @brief Build the requests of a registered instance
+  RegistryRequestTemplatePtr MakeRequestTemplate(const PolarisMeshRegistryInfo& polarismesh_registry_info) const;
+
+  /// @brief Get the requests of the registered instance, nullptr if it is not registered by Register
+  RegistryRequestTemplatePtr FindRequestTemplate(const RegistryInfo& info);
+
+  /// @brief Scale the weight in the metadata of the instance by the load and lower it by the overload, nothing is
+  /// changed if neither of them is enabled
+  void ScaleWeight(RegistryInfo& info);
+
+  /// @brief Register an instance of the business with its updated metadata and the scaled weight, and keep it with its
+  /// configured weight for the later updates
+  int RegisterAndKeepInstance(const RegistryInfo* info, uint64_t timeout);
+
+  /// @brief Register the kept instance again with its updated metadata and the scaled weight. If the instance is
+  /// unregistered or drained during the registration, the registration is undone and -1 is returned
+  int UpdateKeptInstance(RegistryInfo info, const std::map<std::string, std::string>& metadata);
+
+  /// @brief Register all the kept instances again, when the factors of their weights change or the registry recovers
+  void UpdateKeptInstances(const std::set<std::string>& excluded_keys = {});
+
+  /// @brief Whether the token of the instance can be found, otherwise its registration is not retried
+  bool HasRegistryToken(const RegistryInfo& info) const;
+
+  /// @brief Retry the registration of the instance after the retry interval
+  void AddRegisterRetry(const RegistryInfo& info, uint64_t now_ms);
+
+  void RemoveRegisterRetry(const RegistryInfo& info);
+
+  /// @brief Get the interval of the register retry after the failures, which is backed off exponentially and capped
+  uint64_t GetRegisterRetryInterval(uint32_t failures) const;
+
+  /// @brief Stop keeping the instance, its pending metadata update fails
+  /// @param request_template Output the requests of the instance, if it is not null
+  /// @return The updated metadata of the instance
+  std::map<std::string, std::string> RemoveKeptInstance(const RegistryInfo& info,
+                                                        RegistryRequestTemplatePtr* request_template = nullptr);
+
+  /// @brief Build the heartbeat request of an instance, the instance is identified by the instance id if it is not
+  /// empty, otherwise by the host and port. The TTL is in seconds, the default TTL of the server is used if it is 0
+  HeartbeatTargetPtr MakeHeartbeatTarget(const std::string& service_namespace, const std::string& service_name,
+                                         const std::string& token, const std::string& instance_id,
+                                         const std::string& host, int port, int ttl) const;
+
  private:
   bool init_{false};
   uint64_t heartbeat_interval_;
   uint64_t heartbeat_timeout_;
   naming::PolarisMeshNamingConfig plugin_config_;
-  std::map<polaris::ServiceKey, trpc::naming::ServiceConfig> services_config_;
+  std::unordered_map<polaris::ServiceKey, trpc::naming::ServiceConfig, ServiceKeyHash> services_config_;
+  // The service keys shared by the heartbeat callbacks of the configured services
+  std::unordered_map<polaris::ServiceKey, std::shared_ptr<const polaris::ServiceKey>, ServiceKeyHash>
+      heartbeat_service_keys_;
   std::unique_ptr<polaris::ProviderApi> provider_api_{nullptr};
+  HeartbeatScheduler heartbeat_scheduler_;
+  // The timer which only sends the coalesced heartbeats, so that they are not delayed by the blocking calls
+  uint64_t timer_task_id_{0};
+  // The timer which registers and deregisters the instances by the blocking calls of the SDK
+  uint64_t update_task_id_{0};
+
+  // The instances which are draining
+  struct DrainingInstance {
+    RegistryInfo info;
+    std::function<uint64_t()> inflight_getter;
+    // The time after which the callers have refreshed the instance
+    uint64_t propagated_ms{0};
+    // The time after which the in-flight requests are not waited for
+    uint64_t deadline_ms{0};
+    Promise<> promise;
+  };
+  std::mutex drain_mutex_;
+  std::list<DrainingInstance> draining_instances_;
+  // The keys of the draining instances, which are added before the instances stop being kept
+  std::multiset<std::string> draining_keys_;
+
+  LoadReporter load_reporter_;
+  OverloadGuard overload_guard_;
+
+  // The instances registered by the business, which are registered again when their metadata is updated or their
+  // weights are scaled by the load or the overload
+  struct RegisteredInstance {
+    RegistryInfo info;
+    RegistryRequestTemplatePtr request_template;
+    // The weight scaled from the one in the info, which is registered last time
+    int registered_weight{0};
+    // The metadata updated by UpdateMetadata
+    std::map<std::string, std::string> metadata;
+    // The time of the first change of the pending update, 0 if there is no pending update
+    uint64_t first_change_ms{0};
+    uint64_t update_due_ms{0};
+    std::vector<Promise<>> update_promises;
+  };
+  std::mutex registered_mutex_;
+  std::unordered_map<std::string, RegisteredInstance> registered_instances_;
+
+  // The instances whose registrations fail, which are retried by the timer of the plugin
+  struct RetryInstance {
+    RegistryInfo info;
+    uint32_t failures{0};
+    uint64_t due_ms{0};
+  };
+  std::mutex retry_mutex_;
+  std::unordered_map<std::string, RetryInstance> retry_instances_;
 };
 
 using PolarisMeshRegistryPtr = RefPtr<PolarisMeshRegistry>;
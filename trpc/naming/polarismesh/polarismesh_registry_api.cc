@@ -15,12 +15,14 @@
 
 #include "trpc/common/trpc_plugin.h"
 
+#include "trpc/naming/polarismesh/polarismesh_load_report_server_filter.h"
 #include "trpc/naming/polarismesh/polarismesh_registry.h"
 
 namespace trpc::polarismesh::registry {
 
 bool Init() {
   TrpcPlugin::GetInstance()->RegisterRegistry(MakeRefCounted<PolarisMeshRegistry>());
+  TrpcPlugin::GetInstance()->RegisterServerFilter(std::make_shared<PolarisMeshLoadReportServerFilter>());
 
   return true;
 }
@@ -16,17 +16,41 @@
 #include <pthread.h>
 #include <stdint.h>
 
+#include <chrono>
+#include <thread>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "yaml-cpp/yaml.h"
 
 #include "trpc/common/trpc_plugin.h"
 #include "trpc/naming/polarismesh/mock_polarismesh_api_test.h"
+#include "trpc/naming/polarismesh/polarismesh_load_report_server_filter.h"
 #include "trpc/naming/registry.h"
 #include "trpc/naming/registry_factory.h"
+#include "trpc/util/time.h"
 
 namespace trpc {
 
+namespace {
+
+// Respond to the asynchronous heartbeat as the SDK does, the callback is released after the response
+polaris::ReturnCode RespondHeartbeatOk(const polaris::InstanceHeartbeatRequest&, uint64_t,
+                                       polaris::ProviderCallback* callback) {
+  callback->Response(polaris::ReturnCode::kReturnOk, "");
+  delete callback;
+  return polaris::ReturnCode::kReturnOk;
+}
+
+polaris::ReturnCode RespondHeartbeatError(const polaris::InstanceHeartbeatRequest&, uint64_t,
+                                          polaris::ProviderCallback* callback) {
+  callback->Response(polaris::ReturnCode::kReturnUnknownError, "unknown error");
+  delete callback;
+  return polaris::ReturnCode::kReturnOk;
+}
+
+}  // namespace
+
 // There is no Instanceid in the configuration file
 class PolarisMeshRegistryWithoutInstanceIdTest : public polaris::MockServerConnectorTest {
  protected:
@@ -120,6 +144,69 @@ TEST_F(PolarisMeshRegistryWithoutInstanceIdTest, Register) {
   ASSERT_EQ("return_instance", register_info.meta["instance_id"]);
 }
 
+TEST_F(PolarisMeshRegistryWithoutInstanceIdTest, RegisterBatch) {
+  std::vector<trpc::RegistryInfo> register_infos(3);
+  for (std::size_t i = 0; i < register_infos.size(); ++i) {
+    register_infos[i].name = "test.service";
+    register_infos[i].host = "127.0.0.1";
+    register_infos[i].port = 10001 + i;
+    register_infos[i].meta["namespace"] = kPolarisNamespaceTest;
+  }
+  // No information about the name in register config
+  register_infos[1].name = "test.service.no";
+
+  std::string return_instance = "return_instance";
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              RegisterInstance(::testing::_, ::testing::_, ::testing::_))
+      .Times(2)
+      .WillRepeatedly(::testing::DoAll(::testing::SetArgReferee<2>(return_instance),
+                                       ::testing::Return(polaris::ReturnCode::kReturnOk)));
+
+  std::vector<trpc::RegistryInfo*> infos{&register_infos[0], &register_infos[1], &register_infos[2], nullptr};
+  std::vector<std::size_t> failed_indexes;
+  ASSERT_EQ(-1, registry_->RegisterBatch(infos, 1000, &failed_indexes));
+  ASSERT_EQ((std::vector<std::size_t>{1, 3}), failed_indexes);
+  ASSERT_EQ("return_instance", register_infos[0].meta["instance_id"]);
+  ASSERT_EQ("return_instance", register_infos[2].meta["instance_id"]);
+
+  // All the instances are registered
+  ASSERT_EQ(0, registry_->RegisterBatch({}, 1000));
+}
+
+TEST_F(PolarisMeshRegistryWithoutInstanceIdTest, RegisterBatchTimeout) {
+  // More instances than the concurrency of the batch
+  std::vector<trpc::RegistryInfo> register_infos(20);
+  std::vector<trpc::RegistryInfo*> infos;
+  for (std::size_t i = 0; i < register_infos.size(); ++i) {
+    register_infos[i].name = "test.service";
+    register_infos[i].host = "127.0.0.1";
+    register_infos[i].port = 10001 + i;
+    register_infos[i].meta["namespace"] = kPolarisNamespaceTest;
+    infos.push_back(&register_infos[i]);
+  }
+
+  // The registry is slower than the timeout of the batch, the first round of the instances are registered late
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              RegisterInstance(::testing::_, ::testing::_, ::testing::_))
+      .Times(16)
+      .WillRepeatedly(
+          ::testing::Invoke([](const polaris::InstanceRegisterRequest&, uint64_t, std::string& instance_id) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(300));
+            instance_id = "return_instance";
+            return polaris::ReturnCode::kReturnOk;
+          }));
+
+  std::vector<std::size_t> failed_indexes;
+  uint64_t begin_ms = trpc::time::GetMilliSeconds();
+  ASSERT_EQ(-1, registry_->RegisterBatch(infos, 100, &failed_indexes));
+  // The instances left after the deadline are not sent to the registry
+  ASSERT_LT(trpc::time::GetMilliSeconds() - begin_ms, 600);
+  ASSERT_EQ((std::vector<std::size_t>{16, 17, 18, 19}), failed_indexes);
+  for (std::size_t i = 0; i < 16; ++i) {
+    ASSERT_EQ("return_instance", register_infos[i].meta["instance_id"]);
+  }
+}
+
 TEST_F(PolarisMeshRegistryWithoutInstanceIdTest, Unregister) {
   std::string callee_service = "test.service";
   trpc::RegistryInfo register_info;
@@ -146,6 +233,143 @@ TEST_F(PolarisMeshRegistryWithoutInstanceIdTest, Unregister) {
   ASSERT_EQ(0, ret);
 }
 
+TEST_F(PolarisMeshRegistryWithoutInstanceIdTest, RegisteredInstanceRequests) {
+  trpc::RegistryInfo register_info;
+  register_info.name = "test.service";
+  register_info.host = "127.0.0.1";
+  register_info.port = 10001;
+  register_info.meta["namespace"] = kPolarisNamespaceTest;
+
+  std::string return_instance = "return_instance";
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              RegisterInstance(::testing::_, ::testing::_, ::testing::_))
+      .Times(1)
+      .WillOnce(::testing::DoAll(::testing::SetArgReferee<2>(return_instance),
+                                 ::testing::Return(polaris::ReturnCode::kReturnOk)));
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_, InstanceHeartbeat(::testing::_, ::testing::_))
+      .Times(3)
+      .WillRepeatedly(::testing::Return(polaris::ReturnCode::kReturnOk));
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              AsyncInstanceHeartbeat(::testing::_, ::testing::_, ::testing::_))
+      .Times(1)
+      .WillOnce(::testing::Invoke(RespondHeartbeatOk));
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_, DeregisterInstance(::testing::_, ::testing::_))
+      .Times(1)
+      .WillRepeatedly(::testing::Return(polaris::ReturnCode::kReturnOk));
+
+  // The heartbeats and the deregistration reuse the requests resolved at the registration
+  ASSERT_EQ(0, registry_->Register(&register_info));
+  ASSERT_EQ(0, registry_->HeartBeat(&register_info));
+  ASSERT_EQ(0, registry_->HeartBeat(&register_info));
+  registry_->AsyncHeartBeat(&register_info)
+      .Then([](trpc::Future<>&& registry_fut) {
+        EXPECT_TRUE(registry_fut.IsReady());
+        return trpc::MakeReadyFuture<>();
+      })
+      .Wait();
+  ASSERT_EQ(0, registry_->Unregister(&register_info));
+
+  // The heartbeat of the instance which is not registered by Register is resolved on each call
+  ASSERT_EQ(0, registry_->HeartBeat(&register_info));
+}
+
+TEST_F(PolarisMeshRegistryWithoutInstanceIdTest, UpdateMetadata) {
+  trpc::RegistryInfo register_info;
+  register_info.name = "test.service";
+  register_info.host = "127.0.0.1";
+  register_info.port = 10001;
+  register_info.meta["namespace"] = kPolarisNamespaceTest;
+
+  // Registered once, and then updated once for the merged changes
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              RegisterInstance(::testing::_, ::testing::_, ::testing::_))
+      .Times(2)
+      .WillRepeatedly(::testing::Return(polaris::ReturnCode::kReturnOk));
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_, DeregisterInstance(::testing::_, ::testing::_))
+      .Times(1)
+      .WillRepeatedly(::testing::Return(polaris::ReturnCode::kReturnOk));
+
+  // In the empty parameters or the unregistered instance, it fails directly
+  ASSERT_TRUE(registry_->UpdateMetadata(nullptr, {{"shard_version", "1"}}).IsFailed());
+  ASSERT_TRUE(registry_->UpdateMetadata(&register_info, {{"shard_version", "1"}}).IsFailed());
+
+  ASSERT_EQ(0, registry_->Register(&register_info));
+  uint64_t now_ms = trpc::time::GetMilliSeconds();
+  trpc::Future<> shard_fut = registry_->UpdateMetadata(&register_info, {{"shard_version", "1"}});
+  trpc::Future<> warmup_fut = registry_->UpdateMetadata(&register_info, {{"warmup", "done"}});
+  registry_->ProcessMetadataUpdates(now_ms);
+  ASSERT_FALSE(shard_fut.IsReady());
+  ASSERT_FALSE(warmup_fut.IsReady());
+
+  // The changes are sent in one update after the delay
+  registry_->ProcessMetadataUpdates(now_ms + 6000);
+  ASSERT_TRUE(shard_fut.IsReady());
+  ASSERT_TRUE(warmup_fut.IsReady());
+  registry_->ProcessMetadataUpdates(now_ms + 12000);
+
+  // Nothing changes
+  ASSERT_TRUE(registry_->UpdateMetadata(&register_info, {{"shard_version", "1"}}).IsReady());
+
+  // The pending update fails when the instance is deregistered
+  trpc::Future<> pending_fut = registry_->UpdateMetadata(&register_info, {{"shard_version", "2"}});
+  ASSERT_EQ(0, registry_->Unregister(&register_info));
+  ASSERT_TRUE(pending_fut.IsFailed());
+  registry_->ProcessMetadataUpdates(now_ms + 18000);
+}
+
+TEST_F(PolarisMeshRegistryWithoutInstanceIdTest, DrainAndUnregister) {
+  trpc::RegistryInfo register_info;
+  register_info.name = "test.service";
+  register_info.host = "127.0.0.1";
+  register_info.port = 10001;
+  register_info.meta["namespace"] = kPolarisNamespaceTest;
+
+  // The weight is set to 0 by registering the instance again
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              RegisterInstance(::testing::_, ::testing::_, ::testing::_))
+      .Times(2)
+      .WillRepeatedly(::testing::Return(polaris::ReturnCode::kReturnExistedResource));
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_, DeregisterInstance(::testing::_, ::testing::_))
+      .Times(2)
+      .WillRepeatedly(::testing::Return(polaris::ReturnCode::kReturnOk));
+
+  // In the empty parameters, it fails directly
+  registry_->DrainAndUnregister(nullptr)
+      .Then([](trpc::Future<>&& registry_fut) {
+        EXPECT_TRUE(registry_fut.IsFailed());
+        return trpc::MakeReadyFuture<>();
+      })
+      .Wait();
+
+  uint64_t inflight = 1;
+  bool drained = false;
+  auto on_drained = [&drained](trpc::Future<>&& registry_fut) {
+    drained = registry_fut.IsReady();
+    return trpc::MakeReadyFuture<>();
+  };
+
+  // Wait for the callers to refresh the instance, and then for the in-flight requests
+  uint64_t now_ms = trpc::time::GetMilliSeconds();
+  registry_->DrainAndUnregister(&register_info, [&inflight]() { return inflight; }).Then(on_drained);
+  registry_->ProcessDrains(now_ms);
+  ASSERT_FALSE(drained);
+  registry_->ProcessDrains(now_ms + 11000);
+  ASSERT_FALSE(drained);
+  inflight = 0;
+  registry_->ProcessDrains(now_ms + 11000);
+  ASSERT_TRUE(drained);
+
+  // The in-flight requests are not waited for after the drain timeout
+  inflight = 1;
+  drained = false;
+  now_ms = trpc::time::GetMilliSeconds();
+  registry_->DrainAndUnregister(&register_info, [&inflight]() { return inflight; }).Then(on_drained);
+  registry_->ProcessDrains(now_ms + 11000);
+  ASSERT_FALSE(drained);
+  registry_->ProcessDrains(now_ms + 41000);
+  ASSERT_TRUE(drained);
+}
+
 TEST_F(PolarisMeshRegistryWithoutInstanceIdTest, HeartBeat) {
   std::string callee_service = "test.service";
   trpc::RegistryInfo register_info;
@@ -184,7 +408,7 @@ TEST_F(PolarisMeshRegistryWithoutInstanceIdTest, AsyncHeartBeat) {
   EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
               AsyncInstanceHeartbeat(::testing::_, ::testing::_, ::testing::_))
       .Times(1)
-      .WillRepeatedly(::testing::Return(polaris::ReturnCode::kReturnOk));
+      .WillRepeatedly(::testing::Invoke(RespondHeartbeatOk));
 
   // In the empty parameters, it fails directly
   trpc::RegistryInfo* register_info_no_exist = nullptr;
@@ -304,7 +528,7 @@ TEST_F(PolarisMeshRegistryWithInstanceIdTest, AsyncHeartBeat) {
   EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
               AsyncInstanceHeartbeat(::testing::_, ::testing::_, ::testing::_))
       .Times(1)
-      .WillRepeatedly(::testing::Return(polaris::ReturnCode::kReturnOk));
+      .WillRepeatedly(::testing::Invoke(RespondHeartbeatOk));
 
   register_info.name = callee_service;
   registry_->AsyncHeartBeat(&register_info)
@@ -315,6 +539,493 @@ TEST_F(PolarisMeshRegistryWithInstanceIdTest, AsyncHeartBeat) {
       .Wait();
 }
 
+TEST_F(PolarisMeshRegistryWithInstanceIdTest, AsyncHeartBeatFailed) {
+  trpc::RegistryInfo register_info;
+  register_info.name = "test.service";
+  register_info.meta["namespace"] = kPolarisNamespaceTest;
+
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              AsyncInstanceHeartbeat(::testing::_, ::testing::_, ::testing::_))
+      .Times(1)
+      .WillRepeatedly(::testing::Invoke(RespondHeartbeatError));
+
+  // The future is completed with the result of the heartbeat returned by the server
+  registry_->AsyncHeartBeat(&register_info)
+      .Then([](trpc::Future<>&& registry_fut) {
+        EXPECT_TRUE(registry_fut.IsFailed());
+        return trpc::MakeReadyFuture<>();
+      })
+      .Wait();
+}
+
+// The heartbeats are sent by the timer of the plugin
+class PolarisMeshRegistryCoalescedHeartbeatTest : public polaris::MockServerConnectorTest {
+ protected:
+  virtual void SetUp() {
+    polaris::MockServerConnectorTest::SetUp();
+    InitPolarisMeshRegistryWithCoalescedHeartbeat();
+  }
+
+  virtual void TearDown() {
+    trpc::RegistryFactory::GetInstance()->Get("polarismesh")->Destroy();
+    MockServerConnectorTest::TearDown();
+    registry_ = nullptr;
+  }
+
+  void InitPolarisMeshRegistryWithCoalescedHeartbeat() {
+    PolarisNamingTestConfigSwitch default_Switch;
+    YAML::Node root = YAML::Load(trpc::buildPolarisMeshNamingConfig(default_Switch));
+    YAML::Node registry_node = root["registry"];
+    trpc::naming::RegistryConfig registry_config = registry_node["polarismesh"].as<trpc::naming::RegistryConfig>();
+    registry_config.coalesce_heartbeat = true;
+    registry_config.heartbeat_jitter = 0;
+    heartbeat_interval_ = registry_config.heartbeat_interval;
+
+    YAML::Node selector_node = root["selector"];
+    selector_node["polarismesh"]["global"]["serverConnector"]["protocol"] = server_connector_plugin_name_;
+    std::stringstream strstream;
+    strstream << selector_node["polarismesh"];
+    std::string orig_selector_config = strstream.str();
+
+    trpc::naming::PolarisMeshNamingConfig naming_config;
+    naming_config.name = "polarismesh";
+    naming_config.registry_config = registry_config;
+    naming_config.orig_selector_config = orig_selector_config;
+
+    trpc::RefPtr<trpc::PolarisMeshRegistry> p = MakeRefCounted<trpc::PolarisMeshRegistry>();
+    trpc::RegistryFactory::GetInstance()->Register(p);
+    registry_ = static_pointer_cast<PolarisMeshRegistry>(trpc::RegistryFactory::GetInstance()->Get("polarismesh"));
+
+    registry_->SetPluginConfig(naming_config);
+    ASSERT_EQ(0, registry_->Init());
+  }
+
+ protected:
+  trpc::PolarisMeshRegistryPtr registry_;
+  uint64_t heartbeat_interval_{0};
+};
+
+TEST_F(PolarisMeshRegistryCoalescedHeartbeatTest, HeartBeat) {
+  trpc::RegistryInfo register_info;
+  register_info.name = "test.service";
+  register_info.host = "127.0.0.1";
+  register_info.port = 10001;
+  register_info.meta["namespace"] = kPolarisNamespaceTest;
+
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_, InstanceHeartbeat(::testing::_, ::testing::_))
+      .Times(0);
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              AsyncInstanceHeartbeat(::testing::_, ::testing::_, ::testing::_))
+      .Times(1)
+      .WillRepeatedly(::testing::Invoke(RespondHeartbeatOk));
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_, DeregisterInstance(::testing::_, ::testing::_))
+      .Times(1)
+      .WillRepeatedly(::testing::Return(polaris::ReturnCode::kReturnOk));
+
+  // No information about the name in register config
+  trpc::RegistryInfo register_info_no_exist = register_info;
+  register_info_no_exist.name = "test.service.no";
+  ASSERT_EQ(-1, registry_->HeartBeat(&register_info_no_exist));
+
+  // The instance is added to the timer, and the heartbeat calls do not send heartbeats by themselves
+  ASSERT_EQ(0, registry_->HeartBeat(&register_info));
+  ASSERT_EQ(0, registry_->HeartBeat(&register_info));
+  registry_->AsyncHeartBeat(&register_info)
+      .Then([](trpc::Future<>&& registry_fut) {
+        EXPECT_TRUE(registry_fut.IsReady());
+        return trpc::MakeReadyFuture<>();
+      })
+      .Wait();
+
+  // The first heartbeat is sent within the interval
+  uint64_t now_ms = trpc::time::GetMilliSeconds() + heartbeat_interval_;
+  registry_->SendDueHeartbeats(now_ms);
+  registry_->SendDueHeartbeats(now_ms);
+
+  // The unregistered instance is removed from the timer
+  ASSERT_EQ(0, registry_->Unregister(&register_info));
+  registry_->SendDueHeartbeats(now_ms + 10 * heartbeat_interval_);
+}
+
+TEST_F(PolarisMeshRegistryCoalescedHeartbeatTest, HeartBeatBackoff) {
+  trpc::RegistryInfo register_info;
+  register_info.name = "test.service";
+  register_info.host = "127.0.0.1";
+  register_info.port = 10001;
+  register_info.meta["namespace"] = kPolarisNamespaceTest;
+  register_info.meta["ttl"] = "10";
+
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              AsyncInstanceHeartbeat(::testing::_, ::testing::_, ::testing::_))
+      .Times(3)
+      .WillOnce(::testing::Invoke(RespondHeartbeatError))
+      .WillRepeatedly(::testing::Invoke(RespondHeartbeatOk));
+
+  ASSERT_EQ(0, registry_->HeartBeat(&register_info));
+  uint64_t now_ms = trpc::time::GetMilliSeconds() + heartbeat_interval_;
+  registry_->SendDueHeartbeats(now_ms);
+
+  // The heartbeat after the failed one is backed off to twice the interval
+  registry_->SendDueHeartbeats(now_ms + heartbeat_interval_);
+  registry_->SendDueHeartbeats(now_ms + 2 * heartbeat_interval_);
+
+  // Recovered
+  registry_->SendDueHeartbeats(now_ms + 3 * heartbeat_interval_);
+}
+
+TEST_F(PolarisMeshRegistryCoalescedHeartbeatTest, HeartBeatRecovery) {
+  trpc::RegistryInfo register_info;
+  register_info.name = "test.service";
+  register_info.host = "127.0.0.1";
+  register_info.port = 10001;
+  register_info.meta["namespace"] = kPolarisNamespaceTest;
+  register_info.meta["ttl"] = "10";
+
+  // Registered once, and then again when the heartbeat recovers
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              RegisterInstance(::testing::_, ::testing::_, ::testing::_))
+      .Times(2)
+      .WillRepeatedly(::testing::Return(polaris::ReturnCode::kReturnOk));
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              AsyncInstanceHeartbeat(::testing::_, ::testing::_, ::testing::_))
+      .Times(2)
+      .WillOnce(::testing::Invoke(RespondHeartbeatError))
+      .WillOnce(::testing::Invoke(RespondHeartbeatOk));
+
+  ASSERT_EQ(0, registry_->Register(&register_info));
+  uint64_t now_ms = trpc::time::GetMilliSeconds() + heartbeat_interval_;
+  registry_->SendDueHeartbeats(now_ms);
+  registry_->ProcessHeartbeatRecovery();
+
+  // The heartbeat succeeds after the backoff, the kept instance is registered again only once
+  registry_->SendDueHeartbeats(now_ms + 2 * heartbeat_interval_);
+  registry_->ProcessHeartbeatRecovery();
+  registry_->ProcessHeartbeatRecovery();
+}
+
+TEST_F(PolarisMeshRegistryCoalescedHeartbeatTest, UpdateRacingUnregister) {
+  trpc::RegistryInfo register_info;
+  register_info.name = "test.service";
+  register_info.host = "127.0.0.1";
+  register_info.port = 10001;
+  register_info.meta["namespace"] = kPolarisNamespaceTest;
+
+  // The instance is unregistered while its metadata update is being registered
+  PolarisMeshRegistry* registry = registry_.get();
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              RegisterInstance(::testing::_, ::testing::_, ::testing::_))
+      .Times(2)
+      .WillOnce(::testing::Return(polaris::ReturnCode::kReturnOk))
+      .WillOnce(::testing::Invoke([registry, &register_info](const polaris::InstanceRegisterRequest&, uint64_t,
+                                                             std::string&) {
+        EXPECT_EQ(0, registry->Unregister(&register_info));
+        return polaris::ReturnCode::kReturnOk;
+      }));
+  // Deregistered by the business, and then again to undo the update
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_, DeregisterInstance(::testing::_, ::testing::_))
+      .Times(2)
+      .WillRepeatedly(::testing::Return(polaris::ReturnCode::kReturnOk));
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              AsyncInstanceHeartbeat(::testing::_, ::testing::_, ::testing::_))
+      .Times(0);
+
+  ASSERT_EQ(0, registry_->Register(&register_info));
+  uint64_t now_ms = trpc::time::GetMilliSeconds();
+  trpc::Future<> fut = registry_->UpdateMetadata(&register_info, {{"shard_version", "1"}});
+  registry_->ProcessMetadataUpdates(now_ms + 6000);
+  ASSERT_TRUE(fut.IsFailed());
+
+  // The heartbeat of the unregistered instance is not added back by the update
+  registry_->SendDueHeartbeats(now_ms + 10 * heartbeat_interval_);
+}
+
+class PolarisMeshRegistryDynamicWeightTest : public polaris::MockServerConnectorTest {
+ protected:
+  virtual void SetUp() {
+    polaris::MockServerConnectorTest::SetUp();
+    InitPolarisMeshRegistryWithDynamicWeight();
+  }
+
+  virtual void TearDown() {
+    trpc::RegistryFactory::GetInstance()->Get("polarismesh")->Destroy();
+    MockServerConnectorTest::TearDown();
+    registry_ = nullptr;
+  }
+
+  void InitPolarisMeshRegistryWithDynamicWeight() {
+    PolarisNamingTestConfigSwitch default_Switch;
+    YAML::Node root = YAML::Load(trpc::buildPolarisMeshNamingConfig(default_Switch));
+    YAML::Node registry_node = root["registry"];
+    trpc::naming::RegistryConfig registry_config = registry_node["polarismesh"].as<trpc::naming::RegistryConfig>();
+    registry_config.load_report_config.enable = true;
+    registry_config.load_report_config.smoothing = 1;
+    registry_config.load_report_config.min_weight = 20;
+    registry_config.load_report_config.max_cpu = 0;
+    registry_config.load_report_config.max_inflight = 10;
+    registry_config.overload_protect_config.enable = true;
+    registry_config.overload_protect_config.recover_windows = 1;
+
+    YAML::Node selector_node = root["selector"];
+    selector_node["polarismesh"]["global"]["serverConnector"]["protocol"] = server_connector_plugin_name_;
+    std::stringstream strstream;
+    strstream << selector_node["polarismesh"];
+    std::string orig_selector_config = strstream.str();
+
+    trpc::naming::PolarisMeshNamingConfig naming_config;
+    naming_config.name = "polarismesh";
+    naming_config.registry_config = registry_config;
+    naming_config.orig_selector_config = orig_selector_config;
+
+    trpc::RefPtr<trpc::PolarisMeshRegistry> p = MakeRefCounted<trpc::PolarisMeshRegistry>();
+    trpc::RegistryFactory::GetInstance()->Register(p);
+    registry_ = static_pointer_cast<PolarisMeshRegistry>(trpc::RegistryFactory::GetInstance()->Get("polarismesh"));
+
+    registry_->SetPluginConfig(naming_config);
+    ASSERT_EQ(0, registry_->Init());
+  }
+
+ protected:
+  trpc::PolarisMeshRegistryPtr registry_;
+};
+
+TEST_F(PolarisMeshRegistryDynamicWeightTest, PublishWeight) {
+  trpc::RegistryInfo register_info;
+  register_info.name = "test.service";
+  register_info.host = "127.0.0.1";
+  register_info.port = 10001;
+  register_info.meta["namespace"] = kPolarisNamespaceTest;
+
+  // Registered once, and then updated twice with the weights by the load
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              RegisterInstance(::testing::_, ::testing::_, ::testing::_))
+      .Times(3)
+      .WillRepeatedly(::testing::Return(polaris::ReturnCode::kReturnOk));
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_, DeregisterInstance(::testing::_, ::testing::_))
+      .Times(1)
+      .WillRepeatedly(::testing::Return(polaris::ReturnCode::kReturnOk));
+  ASSERT_EQ(0, registry_->Register(&register_info));
+
+  PolarisMeshLoadReportServerFilter filter;
+  ASSERT_EQ(0, filter.Init());
+  FilterStatus status = FilterStatus::REJECT;
+  ServerContextPtr context;
+
+  // The first sampling sets the baseline
+  uint64_t now_ms = trpc::time::GetMilliSeconds();
+  registry_->ProcessLoadReport(now_ms);
+
+  // Saturated by the in-flight requests, the weight is lowered
+  for (int i = 0; i < 10; ++i) {
+    filter(status, FilterPoint::SERVER_PRE_RPC_INVOKE, context);
+  }
+  ASSERT_EQ(FilterStatus::CONTINUE, status);
+  registry_->ProcessLoadReport(now_ms + 1000);
+  ASSERT_FLOAT_EQ(0.2, registry_->GetLoadReporter()->GetFactor());
+  // Not changed
+  registry_->ProcessLoadReport(now_ms + 2000);
+
+  // Recovered, the weight is restored after the publish interval
+  for (int i = 0; i < 10; ++i) {
+    filter(status, FilterPoint::SERVER_POST_RPC_INVOKE, context);
+  }
+  registry_->ProcessLoadReport(now_ms + 3000);
+  ASSERT_FLOAT_EQ(1, registry_->GetLoadReporter()->GetFactor());
+  registry_->ProcessLoadReport(now_ms + 32000);
+
+  // The unregistered instance is not updated
+  ASSERT_EQ(0, registry_->Unregister(&register_info));
+  for (int i = 0; i < 10; ++i) {
+    filter(status, FilterPoint::SERVER_PRE_RPC_INVOKE, context);
+  }
+  registry_->ProcessLoadReport(now_ms + 70000);
+}
+
+TEST_F(PolarisMeshRegistryDynamicWeightTest, RegisterScaledWeight) {
+  std::vector<trpc::RegistryInfo> register_infos(2);
+  for (std::size_t i = 0; i < register_infos.size(); ++i) {
+    register_infos[i].name = "test.service";
+    register_infos[i].host = "127.0.0.1";
+    register_infos[i].port = 10001 + i;
+    register_infos[i].meta["namespace"] = kPolarisNamespaceTest;
+  }
+
+  // The first instance is registered and updated by the load, and then the second one is registered
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              RegisterInstance(::testing::_, ::testing::_, ::testing::_))
+      .Times(3)
+      .WillRepeatedly(::testing::Return(polaris::ReturnCode::kReturnOk));
+  ASSERT_EQ(0, registry_->Register(&register_infos[0]));
+  ASSERT_EQ(100, registry_->GetRegisteredWeight(register_infos[0]));
+  ASSERT_EQ(-1, registry_->GetRegisteredWeight(register_infos[1]));
+
+  PolarisMeshLoadReportServerFilter filter;
+  ASSERT_EQ(0, filter.Init());
+  FilterStatus status = FilterStatus::REJECT;
+  ServerContextPtr context;
+
+  uint64_t now_ms = trpc::time::GetMilliSeconds();
+  registry_->ProcessLoadReport(now_ms);
+  for (int i = 0; i < 10; ++i) {
+    filter(status, FilterPoint::SERVER_PRE_RPC_INVOKE, context);
+  }
+  registry_->ProcessLoadReport(now_ms + 1000);
+  ASSERT_FLOAT_EQ(0.2, registry_->GetLoadReporter()->GetFactor());
+  ASSERT_EQ(20, registry_->GetRegisteredWeight(register_infos[0]));
+
+  // The instance registered under the load is registered with the scaled weight, and its info is not changed
+  ASSERT_EQ(0, registry_->Register(&register_infos[1]));
+  ASSERT_EQ(20, registry_->GetRegisteredWeight(register_infos[1]));
+  ASSERT_EQ(0, register_infos[1].meta.count("weight"));
+
+  for (int i = 0; i < 10; ++i) {
+    filter(status, FilterPoint::SERVER_POST_RPC_INVOKE, context);
+  }
+}
+
+TEST_F(PolarisMeshRegistryDynamicWeightTest, Overload) {
+  trpc::RegistryInfo register_info;
+  register_info.name = "test.service";
+  register_info.host = "127.0.0.1";
+  register_info.port = 10001;
+  register_info.meta["namespace"] = kPolarisNamespaceTest;
+
+  trpc::RegistryInfo overloaded_register_info = register_info;
+  overloaded_register_info.port = 10002;
+
+  // Registered once and updated when the overload is entered, the second instance is registered in the overload, and
+  // then both are updated when the overload is left
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              RegisterInstance(::testing::_, ::testing::_, ::testing::_))
+      .Times(5)
+      .WillRepeatedly(::testing::Return(polaris::ReturnCode::kReturnOk));
+  ASSERT_EQ(0, registry_->Register(&register_info));
+
+  OverloadGuard* guard = registry_->GetOverloadGuard();
+  uint64_t now_ms = trpc::time::GetMilliSeconds();
+  registry_->ProcessOverload(now_ms);
+  for (int i = 0; i < 100; ++i) {
+    guard->RecordRequest(i % 2 == 0);
+  }
+  registry_->ProcessOverload(now_ms + 1000);
+  ASSERT_TRUE(guard->IsOverloaded());
+  ASSERT_EQ(10, guard->GetWeight(100));
+  ASSERT_EQ(10, registry_->GetRegisteredWeight(register_info));
+
+  // The instance registered in the overload is registered with the lowered weight
+  ASSERT_EQ(0, registry_->Register(&overloaded_register_info));
+  ASSERT_EQ(10, registry_->GetRegisteredWeight(overloaded_register_info));
+
+  // Not changed in the window
+  registry_->ProcessOverload(now_ms + 1500);
+
+  // Recovered
+  registry_->ProcessOverload(now_ms + 2000);
+  ASSERT_FALSE(guard->IsOverloaded());
+  ASSERT_EQ(100, registry_->GetRegisteredWeight(register_info));
+  ASSERT_EQ(100, registry_->GetRegisteredWeight(overloaded_register_info));
+}
+
+class PolarisMeshRegistryRetryTest : public polaris::MockServerConnectorTest {
+ protected:
+  virtual void SetUp() {
+    polaris::MockServerConnectorTest::SetUp();
+    InitPolarisMeshRegistryWithRetry();
+  }
+
+  virtual void TearDown() {
+    trpc::RegistryFactory::GetInstance()->Get("polarismesh")->Destroy();
+    MockServerConnectorTest::TearDown();
+    registry_ = nullptr;
+  }
+
+  void InitPolarisMeshRegistryWithRetry() {
+    PolarisNamingTestConfigSwitch default_Switch;
+    YAML::Node root = YAML::Load(trpc::buildPolarisMeshNamingConfig(default_Switch));
+    YAML::Node registry_node = root["registry"];
+    trpc::naming::RegistryConfig registry_config = registry_node["polarismesh"].as<trpc::naming::RegistryConfig>();
+    registry_config.register_retry = true;
+    registry_config.register_retry_min_interval = 1000;
+    registry_config.register_retry_max_interval = 3000;
+
+    YAML::Node selector_node = root["selector"];
+    selector_node["polarismesh"]["global"]["serverConnector"]["protocol"] = server_connector_plugin_name_;
+    std::stringstream strstream;
+    strstream << selector_node["polarismesh"];
+    std::string orig_selector_config = strstream.str();
+
+    trpc::naming::PolarisMeshNamingConfig naming_config;
+    naming_config.name = "polarismesh";
+    naming_config.registry_config = registry_config;
+    naming_config.orig_selector_config = orig_selector_config;
+
+    trpc::RefPtr<trpc::PolarisMeshRegistry> p = MakeRefCounted<trpc::PolarisMeshRegistry>();
+    trpc::RegistryFactory::GetInstance()->Register(p);
+    registry_ = static_pointer_cast<PolarisMeshRegistry>(trpc::RegistryFactory::GetInstance()->Get("polarismesh"));
+
+    registry_->SetPluginConfig(naming_config);
+    ASSERT_EQ(0, registry_->Init());
+  }
+
+ protected:
+  trpc::PolarisMeshRegistryPtr registry_;
+};
+
+TEST_F(PolarisMeshRegistryRetryTest, RegisterRetry) {
+  std::vector<trpc::RegistryInfo> register_infos(3);
+  for (std::size_t i = 0; i < register_infos.size(); ++i) {
+    register_infos[i].name = "test.service";
+    register_infos[i].host = "127.0.0.1";
+    register_infos[i].port = 10001 + i;
+    register_infos[i].meta["namespace"] = kPolarisNamespaceTest;
+  }
+
+  std::string return_instance = "return_instance";
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              RegisterInstance(::testing::_, ::testing::_, ::testing::_))
+      .Times(6)
+      // The first instance is registered before the outage
+      .WillOnce(::testing::DoAll(::testing::SetArgReferee<2>(return_instance),
+                                 ::testing::Return(polaris::ReturnCode::kReturnOk)))
+      // The second instance fails twice
+      .WillOnce(::testing::Return(polaris::ReturnCode::kReturnUnknownError))
+      .WillOnce(::testing::Return(polaris::ReturnCode::kReturnUnknownError))
+      // Recovered, the first instance is registered again
+      .WillOnce(::testing::DoAll(::testing::SetArgReferee<2>(return_instance),
+                                 ::testing::Return(polaris::ReturnCode::kReturnOk)))
+      .WillOnce(::testing::Return(polaris::ReturnCode::kReturnExistedResource))
+      // The third instance is deregistered before its retry
+      .WillOnce(::testing::Return(polaris::ReturnCode::kReturnUnknownError));
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_, DeregisterInstance(::testing::_, ::testing::_))
+      .Times(1)
+      .WillRepeatedly(::testing::Return(polaris::ReturnCode::kReturnOk));
+
+  uint64_t now_ms = trpc::time::GetMilliSeconds();
+  ASSERT_EQ(0, registry_->Register(&register_infos[0]));
+  ASSERT_EQ(-1, registry_->Register(&register_infos[1]));
+  ASSERT_EQ(1, registry_->GetRegisterRetrySize());
+
+  // The retry interval is doubled after each failure
+  registry_->ProcessRegisterRetries(now_ms + 500);
+  registry_->ProcessRegisterRetries(now_ms + 1500);
+  ASSERT_EQ(1, registry_->GetRegisterRetrySize());
+  registry_->ProcessRegisterRetries(now_ms + 3000);
+  registry_->ProcessRegisterRetries(now_ms + 3500);
+  ASSERT_EQ(0, registry_->GetRegisterRetrySize());
+  registry_->ProcessRegisterRetries(now_ms + 10000);
+
+  // No information about the name in register config, it is not retried
+  trpc::RegistryInfo no_config_info = register_infos[2];
+  no_config_info.name = "test.service.no";
+  ASSERT_EQ(-1, registry_->Register(&no_config_info));
+  ASSERT_EQ(0, registry_->GetRegisterRetrySize());
+
+  ASSERT_EQ(-1, registry_->Register(&register_infos[2]));
+  ASSERT_EQ(1, registry_->GetRegisterRetrySize());
+  ASSERT_EQ(0, registry_->Unregister(&register_infos[2]));
+  ASSERT_EQ(0, registry_->GetRegisterRetrySize());
+  registry_->ProcessRegisterRetries(now_ms + 20000);
+}
+
 }  // namespace trpc
 
 class PolarisTestEnvironment : public testing::Environment {
@@ -0,0 +1,118 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_retry_budget.h"
+
+#include <algorithm>
+
+namespace trpc {
+
+namespace {
+
+constexpr uint64_t kHundredthsPerToken = 100;
+
+}  // namespace
+
+RetryBudgetState RetryBudget::ServiceBudget::GetState() const {
+  RetryBudgetState state;
+  state.tokens = static_cast<double>(hundredths) / kHundredthsPerToken;
+  state.retries = retries;
+  state.rejected = rejected;
+  return state;
+}
+
+void RetryBudget::SetConfig(const naming::RetryBudgetConfig& config) { config_ = config; }
+
+std::shared_ptr<RetryBudget::ServiceBudget> RetryBudget::GetOrCreate(const std::string& service) {
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = budgets_.find(service);
+    if (it != budgets_.end()) {
+      return it->second;
+    }
+  }
+
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  std::shared_ptr<ServiceBudget>& budget = budgets_[service];
+  if (budget == nullptr) {
+    budget = std::make_shared<ServiceBudget>();
+    budget->hundredths = config_.max_tokens * kHundredthsPerToken;
+  }
+  return budget;
+}
+
+void RetryBudget::Deposit(const std::string& service) {
+  std::shared_ptr<ServiceBudget> budget = GetOrCreate(service);
+  std::scoped_lock<std::mutex> lock(budget->mutex);
+  budget->hundredths = std::min(budget->hundredths + config_.ratio, config_.max_tokens * kHundredthsPerToken);
+}
+
+bool RetryBudget::TryWithdraw(const std::string& service) {
+  std::shared_ptr<ServiceBudget> budget = GetOrCreate(service);
+  std::scoped_lock<std::mutex> lock(budget->mutex);
+  if (budget->hundredths < kHundredthsPerToken) {
+    ++budget->rejected;
+    return false;
+  }
+  budget->hundredths -= kHundredthsPerToken;
+  ++budget->retries;
+  return true;
+}
+
+bool RetryBudget::HasToken(const std::string& service) {
+  std::shared_ptr<ServiceBudget> budget = GetOrCreate(service);
+  std::scoped_lock<std::mutex> lock(budget->mutex);
+  return budget->hundredths >= kHundredthsPerToken;
+}
+
+void RetryBudget::Withdraw(const std::string& service) {
+  std::shared_ptr<ServiceBudget> budget = GetOrCreate(service);
+  std::scoped_lock<std::mutex> lock(budget->mutex);
+  budget->hundredths -= std::min(budget->hundredths, kHundredthsPerToken);
+  ++budget->retries;
+}
+
+RetryBudgetState RetryBudget::GetState(const std::string& service) const {
+  std::shared_ptr<ServiceBudget> budget;
+  {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = budgets_.find(service);
+    if (it == budgets_.end()) {
+      RetryBudgetState state;
+      state.tokens = config_.max_tokens;
+      return state;
+    }
+    budget = it->second;
+  }
+  std::scoped_lock<std::mutex> lock(budget->mutex);
+  return budget->GetState();
+}
+
+std::map<std::string, RetryBudgetState> RetryBudget::TakeStates() {
+  std::map<std::string, RetryBudgetState> states;
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  for (const auto& [service, budget] : budgets_) {
+    std::scoped_lock<std::mutex> budget_lock(budget->mutex);
+    states[service] = budget->GetState();
+    budget->retries = 0;
+    budget->rejected = 0;
+  }
+  return states;
+}
+
+void RetryBudget::Clear() {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  budgets_.clear();
+}
+
+}  // namespace trpc
@@ -0,0 +1,90 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+
+#include "trpc/naming/polarismesh/config/polarismesh_naming_conf.h"
+
+namespace trpc {
+
+/// @brief The state of the retry budget of a service
+struct RetryBudgetState {
+  /// The tokens left in the budget
+  double tokens{0};
+  /// The retries admitted by the budget
+  uint64_t retries{0};
+  /// The retries rejected since the budget is spent
+  uint64_t rejected{0};
+};
+
+/// @brief Token bucket retry budget of the callee services: each successful call deposits a ratio of a token, and each
+///        retry withdraws one token, so that the retries are bounded by the ratio of the successful calls and stop
+///        when the service keeps failing
+class RetryBudget {
+ public:
+  void SetConfig(const naming::RetryBudgetConfig& config);
+
+  bool Enabled() const { return config_.enable; }
+
+  const naming::RetryBudgetConfig& GetConfig() const { return config_; }
+
+  /// @brief Deposit the tokens of a successful call
+  void Deposit(const std::string& service);
+
+  /// @brief Withdraw a token for a retry
+  /// @return false if the budget is spent, the retry should be rejected
+  bool TryWithdraw(const std::string& service);
+
+  /// @brief Whether a token can be withdrawn, without withdrawing it
+  bool HasToken(const std::string& service);
+
+  /// @brief Withdraw a token for a request which is sent already, e.g. a backup request admitted by HasToken, the
+  ///        tokens do not go below zero
+  void Withdraw(const std::string& service);
+
+  /// @brief Get the state of the service, a service which has never been called has a full budget
+  RetryBudgetState GetState(const std::string& service) const;
+
+  /// @brief Get the states of all the services, and reset their counters of the retries
+  std::map<std::string, RetryBudgetState> TakeStates();
+
+  void Clear();
+
+ private:
+  struct ServiceBudget {
+    std::mutex mutex;
+    // The tokens are counted in hundredths, so that the deposits of the ratio add up exactly
+    uint64_t hundredths{0};
+    uint64_t retries{0};
+    uint64_t rejected{0};
+
+    RetryBudgetState GetState() const;
+  };
+
+  std::shared_ptr<ServiceBudget> GetOrCreate(const std::string& service);
+
+ private:
+  naming::RetryBudgetConfig config_;
+  mutable std::shared_mutex mutex_;
+  std::unordered_map<std::string, std::shared_ptr<ServiceBudget>> budgets_;
+};
+
+}  // namespace trpc
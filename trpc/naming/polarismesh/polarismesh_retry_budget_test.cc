@@ -0,0 +1,105 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_retry_budget.h"
+
+#include "gtest/gtest.h"
+
+namespace trpc {
+
+TEST(RetryBudgetTest, Withdraw) {
+  naming::RetryBudgetConfig config;
+  config.enable = true;
+  config.ratio = 10;
+  config.max_tokens = 2;
+  RetryBudget budget;
+  budget.SetConfig(config);
+  ASSERT_TRUE(budget.Enabled());
+  ASSERT_EQ(2, budget.GetState("test.service").tokens);
+
+  // The initial budget is full
+  ASSERT_TRUE(budget.TryWithdraw("test.service"));
+  ASSERT_TRUE(budget.TryWithdraw("test.service"));
+  ASSERT_FALSE(budget.TryWithdraw("test.service"));
+  // The budgets of the services are separated
+  ASSERT_TRUE(budget.TryWithdraw("other.service"));
+
+  // 10 successful calls earn a retry
+  for (int i = 0; i < 9; ++i) {
+    budget.Deposit("test.service");
+  }
+  ASSERT_FALSE(budget.TryWithdraw("test.service"));
+  budget.Deposit("test.service");
+  ASSERT_TRUE(budget.TryWithdraw("test.service"));
+
+  // Bounded by the max tokens
+  for (int i = 0; i < 100; ++i) {
+    budget.Deposit("test.service");
+  }
+  ASSERT_DOUBLE_EQ(2, budget.GetState("test.service").tokens);
+
+  RetryBudgetState state = budget.GetState("test.service");
+  ASSERT_EQ(3, state.retries);
+  ASSERT_EQ(2, state.rejected);
+
+  budget.Clear();
+  ASSERT_EQ(0, budget.GetState("test.service").retries);
+}
+
+TEST(RetryBudgetTest, WithdrawSentRequest) {
+  naming::RetryBudgetConfig config;
+  config.enable = true;
+  config.ratio = 50;
+  config.max_tokens = 1;
+  RetryBudget budget;
+  budget.SetConfig(config);
+
+  // Checking the token does not withdraw it
+  ASSERT_TRUE(budget.HasToken("test.service"));
+  ASSERT_TRUE(budget.HasToken("test.service"));
+  ASSERT_DOUBLE_EQ(1, budget.GetState("test.service").tokens);
+
+  // The request is sent already, the tokens do not go below zero
+  budget.Withdraw("test.service");
+  ASSERT_FALSE(budget.HasToken("test.service"));
+  budget.Deposit("test.service");
+  budget.Withdraw("test.service");
+  ASSERT_DOUBLE_EQ(0, budget.GetState("test.service").tokens);
+
+  RetryBudgetState state = budget.GetState("test.service");
+  ASSERT_EQ(2, state.retries);
+  ASSERT_EQ(0, state.rejected);
+}
+
+TEST(RetryBudgetTest, TakeStates) {
+  naming::RetryBudgetConfig config;
+  config.enable = true;
+  config.max_tokens = 1;
+  RetryBudget budget;
+  budget.SetConfig(config);
+  ASSERT_TRUE(budget.TryWithdraw("test.service"));
+  ASSERT_FALSE(budget.TryWithdraw("test.service"));
+
+  auto states = budget.TakeStates();
+  ASSERT_EQ(1, states.size());
+  ASSERT_EQ(1, states["test.service"].retries);
+  ASSERT_EQ(1, states["test.service"].rejected);
+
+  // The counters are reset, the tokens are kept
+  states = budget.TakeStates();
+  ASSERT_EQ(0, states["test.service"].retries);
+  ASSERT_EQ(0, states["test.service"].rejected);
+  ASSERT_DOUBLE_EQ(0, states["test.service"].tokens);
+}
+
+}  // namespace trpc
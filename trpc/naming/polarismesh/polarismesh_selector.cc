@@ -13,8 +13,13 @@
 
 #include "trpc/naming/polarismesh/polarismesh_selector.h"
 
+#include <unistd.h>
+
+#include <algorithm>
+#include <functional>
 #include <map>
 #include <memory>
+#include <set>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -25,13 +30,18 @@
 #include "polaris/plugin/service_router/set_division_router.h"
 
 #include "trpc/codec/trpc/trpc.pb.h"
+#include "trpc/filter/filter_id_counter.h"
+#include "trpc/metrics/metrics_factory.h"
 #include "trpc/naming/polarismesh/common.h"
 #include "trpc/naming/polarismesh/config/polarismesh_naming_conf.h"
+#include "trpc/naming/polarismesh/polarismesh_load_balancer.h"
 #include "trpc/naming/polarismesh/trpc_share_context.h"
 #include "trpc/naming/selector_factory.h"
+#include "trpc/runtime/common/periphery_task_scheduler.h"
 #include "trpc/util/log/logging.h"
 #include "trpc/util/string_helper.h"
 #include "trpc/util/string_util.h"
+#include "trpc/util/time.h"
 
 namespace trpc {
 
@@ -43,6 +53,100 @@ uint32_t GetPolarisMeshSelectorPluginID() { return g_polarismesh_selector_plugin
 
 }  // namespace naming::polarismesh
 
+namespace {
+
+// The key of the instances excluded from the selection by the user in the selector extend info, which are the comma
+// separated local ids of the instances
+constexpr char kExcludedInstancesKey[] = "excluded_instances";
+
+// The instance stats which are not selected or reported for this time will be evicted, unit: ms
+constexpr uint64_t kInstanceStatsIdleMs = 10 * 60 * 1000;
+
+// The interval to check the idle instance stats, unit: ms
+constexpr uint64_t kInstanceStatsEvictIntervalMs = 60 * 1000;
+
+// The interval to check the revisions of the subscribed services, unit: ms
+constexpr uint64_t kInstanceWatchIntervalMs = 1000;
+
+// The interval to report the retry budgets to the metrics plugin, unit: ms
+constexpr uint64_t kRetryBudgetReportIntervalMs = 10 * 1000;
+
+// The number of extra backup candidates asked from the SDK when the backup prefers another zone
+constexpr uint32_t kExtraBackupCandidateNum = 2;
+
+// The routed candidates are fetched again after it even if the revision is not changed, so that the changes of the
+// circuit breaker of the SDK are followed, unit: ms
+constexpr uint64_t kRoutedCandidatesTtlMs = 1000;
+
+// The max number of the cached routed candidates, which are keyed by the service and the routing labels
+constexpr std::size_t kMaxRoutedCandidatesNum = 4096;
+
+// The selection of a request kept in the filter data of its context, which is private to the plugin, so that the
+// selected instance is carried as is instead of being formatted into the selector extend info
+struct SelectionData {
+  // The stats of the selected instance, which is reset when the result is reported
+  InstanceStatsPtr selected;
+  // The stats of the instances selected by SelectBatch for the backup request, in the order of the endpoints, they are
+  // all counted as in flight until the request is reported
+  std::vector<InstanceStatsPtr> backups;
+  // The instances of the backup request which lose to the reported one, kept to report their cancellation to the SDK
+  std::vector<InstanceStatsPtr> losers;
+  // The instances failed in the previous tries of the request, which are excluded from the retries
+  ExcludedInstances failed;
+};
+
+// The id of the selection data in the filter data of the context
+uint16_t GetSelectionDataId() {
+  static const uint16_t id = GetNextFilterID();
+  return id;
+}
+
+SelectionData* GetSelectionData(const ClientContextPtr& context) {
+  return context->GetFilterData<SelectionData>(GetSelectionDataId());
+}
+
+SelectionData* GetOrCreateSelectionData(const ClientContextPtr& context) {
+  SelectionData* data = GetSelectionData(context);
+  if (data == nullptr) {
+    context->SetFilterData(GetSelectionDataId(), SelectionData{});
+    data = GetSelectionData(context);
+  }
+  return data;
+}
+
+// Move the backup instances which are not in the zone of the first instance ahead, and keep at most select_num
+// instances
+void PreferBackupsInOtherZones(std::vector<polaris::Instance>& instances, uint32_t select_num) {
+  if (instances.size() > 2) {
+    const std::string zone = instances[0].GetZone();
+    std::stable_partition(instances.begin() + 1, instances.end(),
+                          [&zone](polaris::Instance& instance) { return instance.GetZone() != zone; });
+  }
+  if (instances.size() > select_num) {
+    instances.erase(instances.begin() + select_num, instances.end());
+  }
+}
+
+// The revision of SelectBatch result: the revision of the SDK data, and the fingerprint of the selected instances
+// which reflects the routing result
+std::string CalculateSelectRevision(SelectorPolicy policy, const std::string& sdk_revision,
+                                    const std::vector<polaris::Instance>& instances) {
+  uint64_t fingerprint = std::hash<int>{}(static_cast<int>(policy));
+  auto combine = [&fingerprint](uint64_t value) {
+    fingerprint ^= value + 0x9e3779b97f4a7c15ULL + (fingerprint << 6) + (fingerprint >> 2);
+  };
+  combine(instances.size());
+  for (const auto& instance : instances) {
+    combine(instance.GetLocalId());
+    combine(instance.GetWeight());
+    combine(instance.isHealthy() ? 1 : 0);
+    combine(instance.isIsolate() ? 1 : 0);
+  }
+  return sdk_revision + ":" + std::to_string(fingerprint);
+}
+
+}  // namespace
+
 // Set the transparent information of the Selector-META-prefix to the polaris Routing rule
 void SetTransSelectorMeta(const ClientContextPtr& context, std::map<std::string, std::string>* metadata) {
   static constexpr char meta_prefix[] = "selector-meta-";
@@ -74,6 +178,28 @@ int PolarisMeshSelector::Init() noexcept {
       plugin_config_.selector_config.consumer_config.circuit_breaker_config.set_circuitbreaker_config.enable;
   timeout_ = plugin_config_.selector_config.global_config.server_connector_config.timeout;
   enable_polarismesh_trans_meta_ = plugin_config_.selector_config.consumer_config.enable_trans_meta;
+  slow_start_weigher_.SetConfig(plugin_config_.selector_config.slow_start_config);
+  flap_damper_.SetConfig(plugin_config_.selector_config.flap_damping_config);
+  locality_breaker_.SetConfig(plugin_config_.selector_config.locality_breaker_config);
+  latency_router_.SetConfig(plugin_config_.selector_config.latency_router_config);
+  retry_budget_.SetConfig(plugin_config_.selector_config.retry_budget_config);
+  timeout_advisor_.SetConfig(plugin_config_.selector_config.adaptive_timeout_config);
+  InitSubsetter();
+  // The strict nearby routing keeps the requests in the local zone, which the spillover would break
+  naming::SpilloverConfig& spillover_config = plugin_config_.selector_config.spillover_config;
+  if (spillover_config.enable && plugin_config_.selector_config.consumer_config.service_router_config
+                                     .router_plugin_config.nearby_based_router_config.strict_nearby) {
+    TRPC_FMT_WARN("The spillover is disabled by the strict nearby routing");
+    spillover_config.enable = false;
+  }
+  if ((latency_router_.Enabled() || plugin_config_.selector_config.spillover_config.enable ||
+       plugin_config_.selector_config.concurrency_limit_config.enable) &&
+      plugin_config_.selector_config.consumer_config.load_balancer_config.type !=
+          polaris::kLoadBalanceTypeWeightedRandom) {
+    TRPC_FMT_WARN("The latency routing, the spillover and the concurrency limit work with the weighted random or p2c "
+                  "only, they are ignored by the configured load balancer {}",
+                  plugin_config_.selector_config.consumer_config.load_balancer_config.type);
+  }
 
   if (trpc::TrpcShareContext::GetInstance()->Init(plugin_config_) != 0) {
     return -1;
@@ -87,6 +213,20 @@ int PolarisMeshSelector::Init() noexcept {
     TRPC_FMT_ERROR("Create ConsumerApi failed");
     return -1;
   }
+  // The failover, the latency routing and the spillover choose the localities by themselves among the instances routed
+  // without the nearby router
+  if (locality_breaker_.Enabled() || latency_router_.Enabled() ||
+      plugin_config_.selector_config.spillover_config.enable) {
+    auto nearby_free_context = trpc::TrpcShareContext::GetInstance()->GetNearbyFreeContext();
+    if (nearby_free_context) {
+      nearby_free_consumer_api_ =
+          std::unique_ptr<polaris::ConsumerApi>(polaris::ConsumerApi::Create(nearby_free_context.get()));
+    }
+    if (!nearby_free_consumer_api_) {
+      TRPC_FMT_ERROR("Create ConsumerApi without the nearby router failed");
+      return -1;
+    }
+  }
 
   // Add the default framework and return code white list
   circuitbreak_whitelist_.Writer().clear();
@@ -98,6 +238,50 @@ int PolarisMeshSelector::Init() noexcept {
   return 0;
 }
 
+void PolarisMeshSelector::InitSubsetter() {
+  const naming::SubsetConfig& subset_config = plugin_config_.selector_config.subset_config;
+  std::string identity = subset_config.client_id;
+  if (identity.empty()) {
+    const auto& server_config = TrpcConfig::GetInstance()->GetServerConfig();
+    identity = plugin_config_.selector_config.global_config.api_config.bind_ip + "|" + server_config.app + "." +
+               server_config.server + "|" + std::to_string(getpid());
+  }
+  subsetter_.SetConfig(subset_config, MakeSubsetClientId(identity));
+  if (subsetter_.Enabled()) {
+    TRPC_FMT_INFO("Subsetting is enabled, subset_size:{}, client_id:{}", subset_config.subset_size,
+                  subsetter_.GetClientId());
+  }
+}
+
+void PolarisMeshSelector::Start() noexcept {
+  if (!init_ || watch_task_id_ != 0) {
+    return;
+  }
+
+  // The SDK updates its local cache by the service data events, the revision of the cache is checked here, so that
+  // the subscribers only receive the changes
+  watch_task_id_ = PeripheryTaskScheduler::GetInstance()->SubmitInnerPeriodicalTask(
+      [this]() { CheckSubscriptions(); }, kInstanceWatchIntervalMs, "PolarisMeshSelectorWatcher");
+
+  if (retry_budget_.Enabled() && !retry_budget_.GetConfig().metrics_name.empty()) {
+    retry_budget_task_id_ = PeripheryTaskScheduler::GetInstance()->SubmitInnerPeriodicalTask(
+        [this]() { ReportRetryBudget(); }, kRetryBudgetReportIntervalMs, "PolarisMeshRetryBudgetReporter");
+  }
+}
+
+void PolarisMeshSelector::Stop() noexcept {
+  if (watch_task_id_ != 0) {
+    PeripheryTaskScheduler::GetInstance()->StopInnerTask(watch_task_id_);
+    PeripheryTaskScheduler::GetInstance()->RemoveInnerTask(watch_task_id_);
+    watch_task_id_ = 0;
+  }
+  if (retry_budget_task_id_ != 0) {
+    PeripheryTaskScheduler::GetInstance()->StopInnerTask(retry_budget_task_id_);
+    PeripheryTaskScheduler::GetInstance()->RemoveInnerTask(retry_budget_task_id_);
+    retry_budget_task_id_ = 0;
+  }
+}
+
 void PolarisMeshSelector::Destroy() noexcept {
   if (!init_) {
     TRPC_FMT_DEBUG("No init yet");
@@ -105,14 +289,29 @@ void PolarisMeshSelector::Destroy() noexcept {
   }
 
   consumer_api_ = nullptr;
+  nearby_free_consumer_api_ = nullptr;
   polarismesh_context_ = nullptr;
+  {
+    std::scoped_lock<std::mutex> lock(routed_candidates_mutex_);
+    routed_candidates_.clear();
+  }
+  instance_stats_.Clear();
+  instance_watcher_.Clear();
+  slow_start_weigher_.Clear();
+  flap_damper_.Clear();
+  subsetter_.Clear();
+  locality_breaker_.Clear();
+  latency_router_.Clear();
+  retry_budget_.Clear();
+  timeout_advisor_.Clear();
   trpc::TrpcShareContext::GetInstance()->Destroy();
   init_ = false;
 }
 
 // Obtain the specific implementation of the service node
 // from the SDK API interface to select a single node or backup node
-int PolarisMeshSelector::SelectImpl(const SelectorInfo* info, polaris::InstancesResponse*& polarismesh_response_info) {
+int PolarisMeshSelector::SelectImpl(const SelectorInfo* info, polaris::InstancesResponse*& polarismesh_response_info,
+                                    uint32_t replica_num) {
   // The main system of service key
   polaris::ServiceInfo source_service_info;
   GetSourceServiceKey(info->context, info->extend_select_info, source_service_info.service_key_);
@@ -131,9 +330,12 @@ int PolarisMeshSelector::SelectImpl(const SelectorInfo* info, polaris::Instances
   auto& hash_key = info->context->GetHashKey();
   if (!hash_key.empty()) {
     request.SetHashString(hash_key);
-    // Set up a copy indexy
-    uint64_t replicate_index = trpc::util::Convert<uint64_t, std::string>(
-        GetValueFromContextOrExtend(info->context, info->extend_select_info, "replicate_index"));
+    // Set up a copy indexy, the replicas start from the first one
+    uint64_t replicate_index = 0;
+    if (replica_num == 0) {
+      replicate_index = trpc::util::Convert<uint64_t, std::string>(
+          GetValueFromContextOrExtend(info->context, info->extend_select_info, "replicate_index"));
+    }
     request.SetReplicateIndex(replicate_index);
     // polarismesh bug, use SethashKey in the early stages
     uint64_t u64_hash_key = trpc::util::Convert<uint64_t, std::string>(hash_key);
@@ -160,10 +362,18 @@ int PolarisMeshSelector::SelectImpl(const SelectorInfo* info, polaris::Instances
     request.SetMetadata(*(meta.get()));
   }
 
-  // If it is a backup strategy, you need to set the number of Backup nodes
-  if (info->policy == SelectorPolicy::MULTIPLE && info->select_num > 1) {
+  if (replica_num > 1) {
+    // The backup nodes of the consistent hash are the successors of the first node on the hash ring
+    request.SetBackupInstanceNum(replica_num - 1);
+  } else if (replica_num == 0 && info->policy == SelectorPolicy::MULTIPLE && info->select_num > 1) {
+    // If it is a backup strategy, you need to set the number of Backup nodes
     // SDK SETBACKUPINSTANCENUM method logic, the number does not include the first node
-    request.SetBackupInstanceNum(info->select_num - 1);
+    uint32_t backup_num = info->select_num - 1;
+    if (GetValueFromContextOrExtend(info->context, info->extend_select_info, "backup_prefer_other_zone") == "true") {
+      // Ask for more candidates, so that a backup in another zone can be picked from them
+      backup_num += kExtraBackupCandidateNum;
+    }
+    request.SetBackupInstanceNum(backup_num);
   }
 
   // When selecting a routing, do not consider whether to include a health or melting node
@@ -183,21 +393,39 @@ int PolarisMeshSelector::Select(const SelectorInfo* info, TrpcEndpointInfo* endp
     return -1;
   }
 
-  polaris::InstancesResponse* polarismesh_response_info;
-  int ret = SelectImpl(info, polarismesh_response_info);
-  if (ret != 0) {
+  // The context which is tried before is a retry, which is admitted by the retry budget of the service
+  // The excluded instances are looked up once for the selection
+  bool retry = false;
+  ExcludedInstances excluded = GetExcludedInstances(info, retry);
+  if (retry_budget_.Enabled() && retry && !AcquireRetryBudget(info->context, info->name)) {
+    std::string error = "Retry budget of " + info->name + " is spent, the retry is rejected";
+    TRPC_FMT_DEBUG(error);
+    info->context->SetStatus(Status(TrpcRetCode::TRPC_CLIENT_LIMITED_ERR, 0, std::move(error)));
     return -1;
   }
 
-  std::vector<polaris::Instance>& instances = polarismesh_response_info->GetInstances();
-
-  TRPC_ASSERT(instances.size() == 1 && "select result should return only one instance");
-  if (info->is_from_workflow) {
-    // From the workflow of the framework, the entire MetAdata of Instance
-    ConvertPolarisInstance(instances[0], *endpoint, false);
-    // SetInstanceId(polarismesh_response_info.GetId());
+  if (UsePluginLoadBalance(info, excluded)) {
+    if (SelectByPlugin(info, excluded, endpoint) != 0) {
+      return -1;
+    }
   } else {
-    ConvertPolarisInstance(instances[0], *endpoint, true);
+    polaris::InstancesResponse* polarismesh_response_info;
+    int ret = SelectImpl(info, polarismesh_response_info);
+    if (ret != 0) {
+      return -1;
+    }
+
+    std::vector<polaris::Instance>& instances = polarismesh_response_info->GetInstances();
+
+    TRPC_ASSERT(instances.size() == 1 && "select result should return only one instance");
+    if (info->is_from_workflow) {
+      // From the workflow of the framework, the entire MetAdata of Instance
+      ConvertPolarisInstance(instances[0], *endpoint, false);
+      // SetInstanceId(polarismesh_response_info.GetId());
+    } else {
+      ConvertPolarisInstance(instances[0], *endpoint, true);
+    }
+    RecordSelectedInstance(info->context, instances[0]);
   }
   TRPC_FMT_DEBUG("Select result {}:{}, id:{}, service_name:{}, service_namespace:{}", endpoint->host, endpoint->port,
                  endpoint->id, info->name,
@@ -206,6 +434,138 @@ int PolarisMeshSelector::Select(const SelectorInfo* info, TrpcEndpointInfo* endp
   return 0;
 }
 
+bool PolarisMeshSelector::UsePluginLoadBalance(const SelectorInfo* info, const ExcludedInstances& excluded) {
+  if (info->load_balance_name == kLoadBalanceTypeP2C) {
+    return true;
+  }
+  if (!info->context->GetHashKey().empty() || info->policy == SelectorPolicy::MULTIPLE) {
+    return false;
+  }
+  // A retry skips the excluded instances in the routing result of the SDK, without discovering again. The SDK can not
+  // exclude instances, so the retry is load balanced by the weighted random of the plugin
+  if (!excluded.Empty()) {
+    return true;
+  }
+  if (locality_breaker_.Enabled()) {
+    // The instances in the broken localities are skipped before load balancing
+    polaris::ServiceKey source_service_key;
+    GetSourceServiceKey(info->context, info->extend_select_info, source_service_key);
+    if (locality_breaker_.HasOpen(source_service_key.namespace_ + "/" + info->name, trpc::time::GetMilliSeconds())) {
+      return true;
+    }
+  }
+  if (!slow_start_weigher_.Enabled() && !subsetter_.Enabled() && !latency_router_.Enabled() &&
+      !plugin_config_.selector_config.spillover_config.enable &&
+      !plugin_config_.selector_config.concurrency_limit_config.enable) {
+    return false;
+  }
+
+  // Slow start, subsetting, the locality chosen by the measured latency or the load of the zones, and skipping the
+  // instances at their concurrency limit work with the weighted random, other load balancing algorithms are still
+  // executed by the SDK
+  const std::string& load_balance_name =
+      (info->load_balance_name.empty() || info->load_balance_name == polaris::kLoadBalanceTypeDefaultConfig)
+          ? plugin_config_.selector_config.consumer_config.load_balancer_config.type
+          : info->load_balance_name;
+  return load_balance_name == polaris::kLoadBalanceTypeWeightedRandom;
+}
+
+// Select an instance from the routing result of the SDK by the load balancing of the plugin
+int PolarisMeshSelector::SelectByPlugin(const SelectorInfo* info, const ExcludedInstances& excluded,
+                                        TrpcEndpointInfo* endpoint) {
+  polaris::InstancesResponse* discovery_rsp = nullptr;
+  if (SelectBatchImpl(info, discovery_rsp) != 0) {
+    return -1;
+  }
+  if (subsetter_.Enabled()) {
+    ApplySubset(polaris::ServiceKey{discovery_rsp->GetServiceNamespace(), info->name}, discovery_rsp->GetRevision(),
+                discovery_rsp->GetInstances());
+  }
+  if (locality_breaker_.Enabled()) {
+    ApplyLocalityBreaker(info, discovery_rsp);
+  }
+  if (latency_router_.Enabled()) {
+    ApplyLatencyRouting(info, discovery_rsp);
+  }
+  if (plugin_config_.selector_config.spillover_config.enable) {
+    ApplySpillover(info, discovery_rsp);
+  }
+
+  polaris::ServiceKey source_service_key;
+  GetSourceServiceKey(info->context, info->extend_select_info, source_service_key);
+  polaris::ServiceKey service_key{source_service_key.namespace_, info->name};
+
+  std::vector<polaris::Instance>& instances = discovery_rsp->GetInstances();
+  uint64_t now_ms = trpc::time::GetMilliSeconds();
+  if (slow_start_weigher_.Enabled() && !slow_start_weigher_.IsObserved(service_key, discovery_rsp->GetRevision())) {
+    ObserveSlowStart(service_key, discovery_rsp->GetRevision(), now_ms);
+  }
+  std::vector<uint32_t> weights;
+  slow_start_weigher_.GetEffectiveWeights(service_key, discovery_rsp->GetRevision(), instances, now_ms, weights);
+
+  if (!excluded.Empty()) {
+    std::vector<uint32_t> retry_weights = weights;
+    bool has_candidate = false;
+    for (std::size_t i = 0; i < instances.size(); ++i) {
+      if (excluded.Contains(instances[i].GetLocalId())) {
+        retry_weights[i] = 0;
+      } else if (retry_weights[i] > 0) {
+        has_candidate = true;
+      }
+    }
+    // If all the routed instances are excluded, the retry is still sent to one of them
+    if (has_candidate) {
+      weights.swap(retry_weights);
+    }
+  }
+
+  const naming::ConcurrencyLimitConfig& concurrency_limit_config =
+      plugin_config_.selector_config.concurrency_limit_config;
+  if (concurrency_limit_config.enable) {
+    std::vector<uint32_t> limited_weights = weights;
+    bool has_candidate = false;
+    for (std::size_t i = 0; i < instances.size(); ++i) {
+      InstanceStatsPtr instance_stats = instance_stats_.Find(instances[i].GetLocalId());
+      if (instance_stats &&
+          instance_stats->GetInflight() >= instance_stats->concurrency_limit.GetLimit(concurrency_limit_config)) {
+        limited_weights[i] = 0;
+      } else if (limited_weights[i] > 0) {
+        has_candidate = true;
+      }
+    }
+    // If all the routed instances are at their limit, the request is still sent to one of them rather than failed
+    if (has_candidate) {
+      weights.swap(limited_weights);
+    }
+  }
+
+  int index = -1;
+  if (info->load_balance_name == kLoadBalanceTypeP2C) {
+    std::vector<uint64_t> loads(instances.size(), 0);
+    for (std::size_t i = 0; i < instances.size(); ++i) {
+      InstanceStatsPtr instance_stats = instance_stats_.Find(instances[i].GetLocalId());
+      if (instance_stats) {
+        loads[i] = instance_stats->GetInflight();
+      }
+    }
+    index = SelectByP2C(weights, loads);
+  } else {
+    index = SelectByWeightedRandom(weights);
+  }
+
+  if (index < 0) {
+    TRPC_FMT_ERROR("No available instance, service_name:{}, service_namespace:{}", service_key.name_,
+                   service_key.namespace_);
+    delete discovery_rsp;
+    return -1;
+  }
+
+  ConvertPolarisInstance(instances[index], *endpoint, !info->is_from_workflow);
+  RecordSelectedInstance(info->context, instances[index]);
+  delete discovery_rsp;
+  return 0;
+}
+
 // Asynchronous acquisition of a adjustable node interface
 Future<TrpcEndpointInfo> PolarisMeshSelector::AsyncSelect(const SelectorInfo* info) {
   TrpcEndpointInfo endpoint;
@@ -226,8 +586,6 @@ int PolarisMeshSelector::SelectBatch(const SelectorInfo* info, std::vector<TrpcE
     return -1;
   }
 
-  polaris::InstancesResponse* discovery_rsp = nullptr;
-
   if (info->policy == SelectorPolicy::MULTIPLE) {
     polaris::InstancesResponse* polarismesh_response_info;
     // Backup strategy (compatible with old version logic)
@@ -236,12 +594,156 @@ int PolarisMeshSelector::SelectBatch(const SelectorInfo* info, std::vector<TrpcE
       return -1;
     }
 
-    std::vector<polaris::Instance> instances = polarismesh_response_info->GetInstances();
+    std::vector<polaris::Instance>& instances = polarismesh_response_info->GetInstances();
+    if (GetValueFromContextOrExtend(info->context, info->extend_select_info, "backup_prefer_other_zone") == "true") {
+      PreferBackupsInOtherZones(instances, info->select_num);
+    }
     ConvertPolarisInstances(instances, *endpoints);
+    RecordSelectedBackups(info->context, instances);
+
+    delete polarismesh_response_info;
+    return 0;
+  }
+
+  polaris::InstancesResponse* discovery_rsp = nullptr;
+  if (SelectBatchImpl(info, discovery_rsp) != 0) {
+    return -1;
+  }
+  if (subsetter_.Enabled()) {
+    ApplySubset(polaris::ServiceKey{discovery_rsp->GetServiceNamespace(), info->name}, discovery_rsp->GetRevision(),
+                discovery_rsp->GetInstances());
+  }
+  if (locality_breaker_.Enabled()) {
+    ApplyLocalityBreaker(info, discovery_rsp);
+  }
+
+  std::vector<polaris::Instance>& instances = discovery_rsp->GetInstances();
+  if (info->policy == SelectorPolicy::ALL) {
+    // (Compatible with the old logic of the framework) When checking all nodes, exclude nodes with weight 0 or
+    // isolation
+    ConvertInstancesNoIsolated(instances, *endpoints);
+  } else {
+    ConvertPolarisInstances(instances, *endpoints);
+  }
+
+  if (flap_damper_.Enabled()) {
+    ApplyFlapDamping(info, discovery_rsp, *endpoints);
+  }
+
+  delete discovery_rsp;
+  return 0;
+}
+
+int PolarisMeshSelector::SelectBatchIfModified(const SelectorInfo* info, const std::string& last_revision,
+                                               std::string* revision, EndpointsSnapshot* endpoints) {
+  if (!init_) {
+    TRPC_FMT_ERROR("No init yet");
+    return -1;
+  }
 
+  if (info->policy == SelectorPolicy::MULTIPLE) {
+    // The backup nodes are chosen by load balancing on every call, there is no stable revision
+    auto snapshot = std::make_shared<std::vector<TrpcEndpointInfo>>();
+    if (SelectBatch(info, snapshot.get()) != 0) {
+      return -1;
+    }
+    revision->clear();
+    *endpoints = std::move(snapshot);
     return 0;
   }
 
+  polaris::InstancesResponse* discovery_rsp = nullptr;
+  if (SelectBatchImpl(info, discovery_rsp) != 0) {
+    return -1;
+  }
+  if (subsetter_.Enabled()) {
+    ApplySubset(polaris::ServiceKey{discovery_rsp->GetServiceNamespace(), info->name}, discovery_rsp->GetRevision(),
+                discovery_rsp->GetInstances());
+  }
+  if (locality_breaker_.Enabled()) {
+    ApplyLocalityBreaker(info, discovery_rsp);
+  }
+
+  std::vector<polaris::Instance>& instances = discovery_rsp->GetInstances();
+  std::string current_revision;
+  // The damped endpoints change over time even if the SDK data does not, so they are computed on every call
+  if (!flap_damper_.Enabled()) {
+    current_revision = CalculateSelectRevision(info->policy, discovery_rsp->GetRevision(), instances);
+    if (!last_revision.empty() && current_revision == last_revision) {
+      delete discovery_rsp;
+      return kSelectNotModified;
+    }
+  }
+
+  auto snapshot = std::make_shared<std::vector<TrpcEndpointInfo>>();
+  if (info->policy == SelectorPolicy::ALL) {
+    ConvertInstancesNoIsolated(instances, *snapshot);
+  } else {
+    ConvertPolarisInstances(instances, *snapshot);
+  }
+
+  if (flap_damper_.Enabled()) {
+    current_revision = "damped:" + std::to_string(ApplyFlapDamping(info, discovery_rsp, *snapshot));
+    if (!last_revision.empty() && current_revision == last_revision) {
+      delete discovery_rsp;
+      return kSelectNotModified;
+    }
+  }
+  delete discovery_rsp;
+
+  *revision = std::move(current_revision);
+  *endpoints = std::move(snapshot);
+  return 0;
+}
+
+void PolarisMeshSelector::FillRoutingRequest(const SelectorInfo* info, const polaris::ServiceKey& source_service_key,
+                                             polaris::GetInstancesRequest& discovery_req, std::string* routing_key) {
+  // Setting whether to include unhealthy or fuse nodes
+  bool include_unhealthy =
+      GetValueFromContextOrExtend(info->context, info->extend_select_info, "include_unhealthy") == "true";
+  if (include_unhealthy) {
+    discovery_req.SetIncludeUnhealthyInstances(true);
+    discovery_req.SetIncludeCircuitBreakInstances(true);
+  }
+
+  // Set the main service information
+  polaris::ServiceInfo source_service_info;
+  source_service_info.service_key_ = source_service_key;
+  FillMetadataOfSourceServiceInfo(info, source_service_info);
+  // Set Canary Information
+  auto cannary = GetValueFromContextOrExtend(info->context, info->extend_select_info, "canary_label");
+  if (!cannary.empty()) {
+    discovery_req.SetCanary(cannary);
+  }
+
+  // Fill in metadata
+  auto meta =
+      naming::polarismesh::GetFilterMetadataOfNaming(info->context, PolarisMetadataType::kPolarisDstMetaRouteLable);
+  if (meta) {
+    discovery_req.SetMetadata(*(meta.get()));
+  }
+
+  // All the inputs of the routing, which identify the routing result of the same revision
+  if (routing_key != nullptr) {
+    routing_key->append(source_service_key.namespace_).append("/").append(source_service_key.name_).append("|");
+    routing_key->append(include_unhealthy ? "1|" : "0|").append(cannary).append("|");
+    for (const auto& [key, value] : source_service_info.metadata_) {
+      routing_key->append(key).append("=").append(value).append(",");
+    }
+    routing_key->append("|");
+    if (meta) {
+      for (const auto& [key, value] : *meta) {
+        routing_key->append(key).append("=").append(value).append(",");
+      }
+    }
+  }
+  discovery_req.SetSourceService(source_service_info);
+}
+
+// Obtain the instances of SelectBatch from the SDK, except the MULTIPLE policy
+int PolarisMeshSelector::SelectBatchImpl(const SelectorInfo* info, polaris::InstancesResponse*& discovery_rsp) {
+  discovery_rsp = nullptr;
+
   // The main system of service key
   polaris::ServiceKey source_service_key;
   GetSourceServiceKey(info->context, info->extend_select_info, source_service_key);
@@ -267,29 +769,7 @@ int PolarisMeshSelector::SelectBatch(const SelectorInfo* info, std::vector<TrpcE
     }
   } else {
     // Routing selection
-    // Setting whether to include unhealthy or fuse nodes
-    if (GetValueFromContextOrExtend(info->context, info->extend_select_info, "include_unhealthy") == "true") {
-      discovery_req.SetIncludeUnhealthyInstances(true);
-      discovery_req.SetIncludeCircuitBreakInstances(true);
-    }
-
-    // Set the main service information
-    polaris::ServiceInfo source_service_info;
-    source_service_info.service_key_ = source_service_key;
-    FillMetadataOfSourceServiceInfo(info, source_service_info);
-    // Set Canary Information
-    auto cannary = GetValueFromContextOrExtend(info->context, info->extend_select_info, "canary_label");
-    if (!cannary.empty()) {
-      discovery_req.SetCanary(cannary);
-    }
-    discovery_req.SetSourceService(source_service_info);
-
-    // Fill in metadata
-    auto meta =
-        naming::polarismesh::GetFilterMetadataOfNaming(info->context, PolarisMetadataType::kPolarisDstMetaRouteLable);
-    if (meta) {
-      discovery_req.SetMetadata(*(meta.get()));
-    }
+    FillRoutingRequest(info, source_service_key, discovery_req);
 
     polaris::ReturnCode ret = consumer_api_->GetInstances(discovery_req, discovery_rsp);
     if (ret != polaris::ReturnCode::kReturnOk) {
@@ -304,16 +784,6 @@ int PolarisMeshSelector::SelectBatch(const SelectorInfo* info, std::vector<TrpcE
 
   TRPC_ASSERT(discovery_rsp != nullptr && "GetInstances or GetAllInstances success, but InstancesResponse is nullptr");
 
-  std::vector<polaris::Instance>& instances = discovery_rsp->GetInstances();
-  if (info->policy == SelectorPolicy::ALL) {
-    // (Compatible with the old logic of the framework) When checking all nodes, exclude nodes with weight 0 or
-    // isolation
-    ConvertInstancesNoIsolated(instances, *endpoints);
-  } else {
-    ConvertPolarisInstances(instances, *endpoints);
-  }
-
-  delete discovery_rsp;
   return 0;
 }
 
@@ -328,6 +798,46 @@ Future<std::vector<TrpcEndpointInfo>> PolarisMeshSelector::AsyncSelectBatch(cons
   return MakeReadyFuture<std::vector<TrpcEndpointInfo>>(std::move(endpoints));
 }
 
+int PolarisMeshSelector::SelectReplicas(const SelectorInfo* info, uint32_t replica_num,
+                                        std::vector<TrpcEndpointInfo>* endpoints) {
+  if (!init_) {
+    TRPC_FMT_ERROR("No init yet");
+    return -1;
+  }
+  if (replica_num == 0 || endpoints == nullptr || info->context->GetHashKey().empty()) {
+    TRPC_FMT_ERROR("Invalid parameter: replica_num:{}, the hash key and the endpoints are required, service_name:{}",
+                   replica_num, info->name);
+    return -1;
+  }
+
+  // The routing and the hash ring lookup are done once for all the replicas
+  polaris::InstancesResponse* polarismesh_response_info = nullptr;
+  if (SelectImpl(info, polarismesh_response_info, replica_num) != 0) {
+    return -1;
+  }
+
+  std::vector<polaris::Instance>& instances = polarismesh_response_info->GetInstances();
+  endpoints->clear();
+  endpoints->reserve(std::min<std::size_t>(instances.size(), replica_num));
+  for (const auto& instance : instances) {
+    if (endpoints->size() == replica_num) {
+      break;
+    }
+    bool duplicated = std::any_of(endpoints->begin(), endpoints->end(), [&instance](const TrpcEndpointInfo& endpoint) {
+      return endpoint.id == instance.GetLocalId();
+    });
+    if (duplicated) {
+      continue;
+    }
+    TrpcEndpointInfo endpoint;
+    ConvertPolarisInstance(instance, endpoint, !info->is_from_workflow);
+    endpoints->push_back(std::move(endpoint));
+  }
+
+  delete polarismesh_response_info;
+  return 0;
+}
+
 // Report interface on the result
 int PolarisMeshSelector::ReportInvokeResult(const InvokeResult* result) {
   if (!init_ || result == nullptr) {
@@ -342,7 +852,71 @@ int PolarisMeshSelector::ReportInvokeResult(const InvokeResult* result) {
   result_req.SetSource(source_service_key);
   result_req.SetServiceName(result->name);
   result_req.SetServiceNamespace(source_service_key.namespace_);
-  result_req.SetInstanceHostAndPort(result->context->GetIp(), result->context->GetPort());
+  // Report by instance id if the called instance is selected by this plugin, so that the SDK does not need to search
+  // the instance by host and port
+  bool inflight = false;
+  InstanceStatsPtr instance_stats = TakeCalledInstance(result->context, inflight);
+  // The request is canceled by the caller (e.g. the loser of a hedged request), which says nothing about the health
+  // of the instance, so it is neither counted by the plugin nor reported to the SDK, only its in-flight request is
+  // released
+  if (result->framework_result == TrpcRetCode::TRPC_CLIENT_CANCELED_ERR) {
+    if (instance_stats && inflight) {
+      instance_stats->ReleaseInflight();
+    }
+    return 0;
+  }
+
+  bool success = result->framework_result == TrpcRetCode::TRPC_INVOKE_SUCCESS;
+  // The key of the callee service in the stats of the plugin
+  const std::string service = source_service_key.namespace_ + "/" + result->name;
+  uint64_t now_ms = trpc::time::GetMilliSeconds();
+  if (retry_budget_.Enabled() && success) {
+    retry_budget_.Deposit(service);
+  }
+  if (timeout_advisor_.Enabled()) {
+    // The latency of a timed out call is only known to be at least the timeout, other failures are not observed. A
+    // full-link timeout is cut by the remaining time of the caller, which says nothing about the latency of the method
+    if (success) {
+      timeout_advisor_.RecordLatency(service + "/" + result->context->GetFuncName(), result->cost_time, now_ms);
+    } else if (result->framework_result == TrpcRetCode::TRPC_CLIENT_INVOKE_TIMEOUT_ERR) {
+      timeout_advisor_.RecordTimeout(service + "/" + result->context->GetFuncName(),
+                                     std::max<uint64_t>(result->cost_time, result->context->GetTimeout()), now_ms);
+    }
+  }
+  if (instance_stats) {
+    result_req.SetInstanceId(instance_stats->instance_id);
+  } else {
+    result_req.SetInstanceHostAndPort(result->context->GetIp(), result->context->GetPort());
+  }
+  // Only the requests counted as in flight update the stats of the plugin, the losers of a backup request are
+  // released by the report of the winner
+  if (instance_stats && inflight) {
+    if (!success) {
+      // The retry of the request goes to another instance
+      ExcludeInstance(result->context, instance_stats->local_id);
+    }
+    if (plugin_config_.selector_config.concurrency_limit_config.enable) {
+      // The in-flight requests include the reported one
+      instance_stats->concurrency_limit.Update(plugin_config_.selector_config.concurrency_limit_config,
+                                               result->cost_time, instance_stats->GetInflight(), success);
+    }
+    instance_stats->RecordCall(success, result->cost_time, now_ms);
+    if (latency_router_.Enabled() && success) {
+      latency_router_.RecordLatency(
+          service, MakeCampusLocality(instance_stats->region, instance_stats->zone, instance_stats->campus),
+          result->cost_time, now_ms);
+    }
+    if (locality_breaker_.Enabled()) {
+      // The white listed errors (e.g. overload) do not break the locality, the same as the circuit breaker of the SDK
+      bool available = FrameworkRetToPolarisRet(circuitbreak_whitelist_, result->framework_result) ==
+                       polaris::CallRetStatus::kCallRetOk;
+      locality_breaker_.RecordResult(service, MakeZoneLocality(instance_stats->region, instance_stats->zone),
+                                     available, now_ms);
+      if (!instance_stats->set_name.empty()) {
+        locality_breaker_.RecordResult(service, MakeSetLocality(instance_stats->set_name), available, now_ms);
+      }
+    }
+  }
 
   // Set RetStatus (frame error code)
   result_req.SetRetStatus(FrameworkRetToPolarisRet(circuitbreak_whitelist_, result->framework_result));
@@ -362,7 +936,7 @@ int PolarisMeshSelector::ReportInvokeResult(const InvokeResult* result) {
     result_req.SetLabels(*(circuit_breaker_lables.get()));
   }
 
-  int ret = consumer_api_->UpdateServiceCallResult(result_req);
+  int ret = UpdateServiceCallResult(result_req);
   if (ret != polaris::ReturnCode::kReturnOk) {
     TRPC_FMT_ERROR("UpdateServiceCallResult failed, sdk returnCode:{}, service_name:{}, service_namespace:{}",
                    static_cast<int32_t>(ret), result->name, source_service_key.namespace_);
@@ -372,6 +946,569 @@ int PolarisMeshSelector::ReportInvokeResult(const InvokeResult* result) {
   return 0;
 }
 
+void PolarisMeshSelector::RecordSelectedInstance(const ClientContextPtr& context, const polaris::Instance& instance) {
+  uint64_t now_ms = trpc::time::GetMilliSeconds();
+  InstanceStatsPtr instance_stats = instance_stats_.GetOrCreate(instance, now_ms);
+  instance_stats->inflight.fetch_add(1, std::memory_order_relaxed);
+
+  // The context may be reused by retries, so the selection must be overwritten, and the in-flight request of the
+  // previous selection which is never reported is released
+  SelectionData* data = GetOrCreateSelectionData(context);
+  if (data->selected) {
+    data->selected->ReleaseInflight();
+  }
+  data->selected = std::move(instance_stats);
+  EvictIdleInstanceStats(now_ms);
+}
+
+void PolarisMeshSelector::RecordSelectedBackups(const ClientContextPtr& context,
+                                                const std::vector<polaris::Instance>& instances) {
+  uint64_t now_ms = trpc::time::GetMilliSeconds();
+  SelectionData* data = GetOrCreateSelectionData(context);
+  // The in-flight requests of the previous backup request which is never reported are released
+  for (const auto& previous : data->backups) {
+    previous->ReleaseInflight();
+  }
+  data->backups.clear();
+  data->losers.clear();
+  for (const auto& instance : instances) {
+    InstanceStatsPtr instance_stats = instance_stats_.GetOrCreate(instance, now_ms);
+    instance_stats->inflight.fetch_add(1, std::memory_order_relaxed);
+    data->backups.push_back(std::move(instance_stats));
+  }
+  EvictIdleInstanceStats(now_ms);
+}
+
+void PolarisMeshSelector::EvictIdleInstanceStats(uint64_t now_ms) {
+  uint64_t last_evict_ms = last_evict_ms_.load(std::memory_order_relaxed);
+  if (now_ms > last_evict_ms + kInstanceStatsEvictIntervalMs &&
+      last_evict_ms_.compare_exchange_strong(last_evict_ms, now_ms, std::memory_order_relaxed)) {
+    instance_stats_.EvictIdle(now_ms, kInstanceStatsIdleMs);
+  }
+}
+
+int PolarisMeshSelector::UpdateServiceCallResult(polaris::ServiceCallResult& result_req) {
+  // The context without the nearby router keeps its own circuit breaker, which is fed by the same call results, so
+  // that the failover, the latency routing and the spillover skip the instances broken by the SDK as well
+  if (nearby_free_consumer_api_) {
+    polaris::ReturnCode ret = nearby_free_consumer_api_->UpdateServiceCallResult(result_req);
+    if (ret != polaris::ReturnCode::kReturnOk) {
+      TRPC_FMT_ERROR("UpdateServiceCallResult without the nearby router failed, sdk returnCode:{}",
+                     static_cast<int32_t>(ret));
+    }
+  }
+  return consumer_api_->UpdateServiceCallResult(result_req);
+}
+
+bool PolarisMeshSelector::AcquireRetryBudget(const ClientContextPtr& context, const std::string& service_name) {
+  if (!retry_budget_.Enabled()) {
+    return true;
+  }
+  polaris::ServiceKey source_service_key;
+  GetSourceServiceKey(context, nullptr, source_service_key);
+  return retry_budget_.TryWithdraw(source_service_key.namespace_ + "/" + service_name);
+}
+
+std::string PolarisMeshSelector::GetServiceStatsKey(const ClientContextPtr& context, const std::string& service_name) {
+  polaris::ServiceKey source_service_key;
+  GetSourceServiceKey(context, nullptr, source_service_key);
+  return source_service_key.namespace_ + "/" + service_name;
+}
+
+bool PolarisMeshSelector::HasRetryBudget(const std::string& service) {
+  return !retry_budget_.Enabled() || retry_budget_.HasToken(service);
+}
+
+void PolarisMeshSelector::ConsumeRetryBudget(const std::string& service) {
+  if (retry_budget_.Enabled()) {
+    retry_budget_.Withdraw(service);
+  }
+}
+
+RetryBudgetState PolarisMeshSelector::GetRetryBudgetState(const std::string& service_namespace,
+                                                          const std::string& service_name) const {
+  return retry_budget_.GetState(service_namespace + "/" + service_name);
+}
+
+uint64_t PolarisMeshSelector::GetRecommendedTimeout(const std::string& service_namespace,
+                                                    const std::string& service_name, const std::string& method) {
+  return timeout_advisor_.GetTimeout(service_namespace + "/" + service_name + "/" + method,
+                                     trpc::time::GetMilliSeconds());
+}
+
+void PolarisMeshSelector::ReportRetryBudget() {
+  MetricsPtr metrics = MetricsFactory::GetInstance()->Get(retry_budget_.GetConfig().metrics_name);
+  if (!metrics) {
+    return;
+  }
+
+  for (const auto& [service, state] : retry_budget_.TakeStates()) {
+    SingleAttrMetricsInfo info;
+    info.dimension = service;
+    info.name = "polarismesh_retry_budget_tokens";
+    info.policy = MetricsPolicy::SET;
+    info.value = state.tokens;
+    metrics->SingleAttrReport(info);
+
+    info.name = "polarismesh_retry_budget_retries";
+    info.policy = MetricsPolicy::SUM;
+    info.value = static_cast<double>(state.retries);
+    metrics->SingleAttrReport(info);
+
+    info.name = "polarismesh_retry_budget_rejected";
+    info.value = static_cast<double>(state.rejected);
+    metrics->SingleAttrReport(info);
+  }
+}
+
+ExcludedInstances PolarisMeshSelector::GetExcludedInstances(const SelectorInfo* info, bool& retry) {
+  retry = false;
+  // The instances excluded by the user are parsed only if they are set
+  ExcludedInstances excluded;
+  std::string value = GetValueFromContextOrExtend(info->context, info->extend_select_info, kExcludedInstancesKey);
+  if (!value.empty()) {
+    excluded = ParseExcludedInstances(value);
+  }
+
+  SelectionData* data = GetSelectionData(info->context);
+  if (data == nullptr) {
+    return excluded;
+  }
+  for (std::size_t i = 0; i < data->failed.size; ++i) {
+    excluded.Add(data->failed.local_ids[i]);
+  }
+  // The previous selection of the context is not reported, the context is reused by a retry without reporting the
+  // failure (e.g. the request is timeout)
+  if (data->selected) {
+    excluded.Add(data->selected->local_id);
+  }
+  retry = data->failed.size > 0 || data->selected != nullptr;
+  return excluded;
+}
+
+void PolarisMeshSelector::ExcludeInstance(const ClientContextPtr& context, uint64_t local_id) {
+  GetOrCreateSelectionData(context)->failed.Add(local_id);
+}
+
+InstanceStatsPtr PolarisMeshSelector::TakeCalledInstance(const ClientContextPtr& context, bool& inflight) {
+  inflight = true;
+  SelectionData* data = GetSelectionData(context);
+  if (data == nullptr) {
+    return nullptr;
+  }
+  // Each selection is reported once
+  if (data->selected) {
+    InstanceStatsPtr instance_stats = std::move(data->selected);
+    data->selected = nullptr;
+    return instance_stats;
+  }
+
+  const std::string& ip = context->GetIp();
+  int port = context->GetPort();
+  if (!data->backups.empty()) {
+    // The reported one of the backup request is the called address, the others lose to it and are released
+    InstanceStatsPtr called;
+    for (auto& instance_stats : data->backups) {
+      if (!called && instance_stats->Match(ip, port)) {
+        called = std::move(instance_stats);
+      } else {
+        instance_stats->ReleaseInflight();
+        data->losers.push_back(std::move(instance_stats));
+      }
+    }
+    data->backups.clear();
+    return called;
+  }
+
+  // The loser of the backup request is reported after the winner, it is not in flight any more
+  for (auto it = data->losers.begin(); it != data->losers.end(); ++it) {
+    if ((*it)->Match(ip, port)) {
+      InstanceStatsPtr instance_stats = std::move(*it);
+      data->losers.erase(it);
+      inflight = false;
+      return instance_stats;
+    }
+  }
+  return nullptr;
+}
+
+uint64_t PolarisMeshSelector::Subscribe(const std::string& service_name, const std::string& service_namespace,
+                                        InstanceDeltaCallback callback) {
+  if (!init_) {
+    TRPC_FMT_ERROR("No init yet");
+    return 0;
+  }
+
+  polaris::ServiceKey service_key{service_namespace, service_name};
+  uint64_t subscription_id = instance_watcher_.AddSubscriber(service_key, std::move(callback));
+  // Deliver the current instances to the new subscriber as soon as possible
+  CheckSubscription(service_key);
+  return subscription_id;
+}
+
+bool PolarisMeshSelector::Unsubscribe(uint64_t subscription_id) {
+  return instance_watcher_.RemoveSubscriber(subscription_id);
+}
+
+void PolarisMeshSelector::CheckSubscriptions() {
+  if (!init_) {
+    return;
+  }
+
+  for (const auto& service_key : instance_watcher_.GetWatchedServices()) {
+    CheckSubscription(service_key);
+  }
+}
+
+void PolarisMeshSelector::CheckSubscription(const polaris::ServiceKey& service_key) {
+  // The fetch, the diff and the callbacks are done under the lock
+  std::scoped_lock<std::recursive_mutex> lock(subscription_mutex_);
+  polaris::GetInstancesRequest request(service_key);
+  request.SetTimeout(timeout_);
+  polaris::InstancesResponse* response = nullptr;
+  polaris::ReturnCode ret = consumer_api_->GetAllInstances(request, response);
+  if (ret != polaris::ReturnCode::kReturnOk) {
+    TRPC_FMT_ERROR("GetAllInstances failed, sdk returnCode:{}, service_name:{}, service_namespace:{}",
+                   static_cast<int32_t>(ret), service_key.name_, service_key.namespace_);
+    if (response != nullptr) {
+      delete response;
+    }
+    return;
+  }
+
+  // The subscribers manage the connections like the callers of SelectBatch, they only see the subset as well
+  if (subsetter_.Enabled()) {
+    ApplySubset(service_key, response->GetRevision(), response->GetInstances());
+  }
+  if (flap_damper_.Enabled()) {
+    std::vector<TrpcEndpointInfo> endpoints;
+    ConvertInstancesNoIsolated(response->GetInstances(), endpoints);
+    std::string damper_key = "watch:" + service_key.namespace_ + "/" + service_key.name_;
+    uint64_t generation = flap_damper_.Apply(damper_key, endpoints, trpc::time::GetMilliSeconds());
+    instance_watcher_.OnEndpointsUpdate(service_key, "damped:" + std::to_string(generation), endpoints);
+  } else {
+    instance_watcher_.OnInstancesUpdate(service_key, response->GetRevision(), response->GetInstances());
+  }
+  delete response;
+}
+
+void PolarisMeshSelector::ObserveSlowStart(const polaris::ServiceKey& service_key, const std::string& revision,
+                                           uint64_t now_ms) {
+  polaris::GetInstancesRequest request(service_key);
+  request.SetTimeout(timeout_);
+  polaris::InstancesResponse* response = nullptr;
+  polaris::ReturnCode ret = consumer_api_->GetAllInstances(request, response);
+  if (ret != polaris::ReturnCode::kReturnOk) {
+    TRPC_FMT_ERROR("GetAllInstances failed, sdk returnCode:{}, service_name:{}, service_namespace:{}",
+                   static_cast<int32_t>(ret), service_key.name_, service_key.namespace_);
+    if (response != nullptr) {
+      delete response;
+    }
+    return;
+  }
+  // Recorded under the revision of the routing result, so that all the instances are fetched once per revision
+  slow_start_weigher_.ObserveInstances(service_key, revision, response->GetInstances(), now_ms);
+  delete response;
+}
+
+void PolarisMeshSelector::ApplySubset(const polaris::ServiceKey& service_key, const std::string& revision,
+                                      std::vector<polaris::Instance>& instances) {
+  InstanceSubsetPtr subset = subsetter_.GetSubset(service_key, revision);
+  if (subset == nullptr) {
+    // The subset is always picked from all the instances of the service, whatever the policy or the routing result
+    // is, so that the membership seen by the subsetter does not change between the calls of different policies
+    polaris::GetInstancesRequest request(service_key);
+    request.SetTimeout(timeout_);
+    polaris::InstancesResponse* response = nullptr;
+    polaris::ReturnCode ret = consumer_api_->GetAllInstances(request, response);
+    if (ret != polaris::ReturnCode::kReturnOk) {
+      TRPC_FMT_ERROR("GetAllInstances failed, sdk returnCode:{}, service_name:{}, service_namespace:{}",
+                     static_cast<int32_t>(ret), service_key.name_, service_key.namespace_);
+      if (response != nullptr) {
+        delete response;
+      }
+      return;
+    }
+    subset = subsetter_.UpdateSubset(service_key, response->GetRevision(), response->GetInstances());
+    delete response;
+  }
+
+  std::vector<polaris::Instance> subset_instances;
+  for (const auto& instance : instances) {
+    if (subset->Contains(instance.GetLocalId())) {
+      subset_instances.push_back(instance);
+    }
+  }
+  // Use the routing result if none of the subset is routed, e.g. the subset is all in other zones
+  if (!subset_instances.empty()) {
+    instances.swap(subset_instances);
+  }
+}
+
+void PolarisMeshSelector::ApplyLocalityBreaker(const SelectorInfo* info, polaris::InstancesResponse* discovery_rsp) {
+  // All the instances are still returned to the callers which manage the connections or check the instances
+  if (info->policy == SelectorPolicy::ALL) {
+    return;
+  }
+
+  polaris::ServiceKey service_key{discovery_rsp->GetServiceNamespace(), info->name};
+  std::string service = service_key.namespace_ + "/" + service_key.name_;
+  uint64_t now_ms = trpc::time::GetMilliSeconds();
+  if (!locality_breaker_.HasOpen(service, now_ms)) {
+    return;
+  }
+
+  std::vector<polaris::Instance>& instances = discovery_rsp->GetInstances();
+  std::vector<polaris::Instance> available = locality_breaker_.FilterAvailable(service, instances, now_ms);
+  if (available.empty()) {
+    available = GetFailoverInstances(info, service_key, discovery_rsp->GetRevision(), instances, now_ms);
+  }
+  // Use the routing result if no instance is available at any level, the circuit breaker of the SDK still works
+  if (!available.empty()) {
+    instances.swap(available);
+  }
+}
+
+PolarisMeshSelector::RoutedCandidatesPtr PolarisMeshSelector::GetRoutedCandidates(
+    const SelectorInfo* info, const polaris::ServiceKey& service_key, const std::string& revision, uint64_t now_ms) {
+  polaris::ServiceKey source_service_key;
+  GetSourceServiceKey(info->context, info->extend_select_info, source_service_key);
+  polaris::GetInstancesRequest request(service_key);
+  request.SetTimeout(timeout_);
+  std::string cache_key = service_key.namespace_ + "/" + service_key.name_ + "|";
+  FillRoutingRequest(info, source_service_key, request, &cache_key);
+
+  {
+    std::scoped_lock<std::mutex> lock(routed_candidates_mutex_);
+    auto it = routed_candidates_.find(cache_key);
+    if (it != routed_candidates_.end() && it->second->revision == revision && it->second->expire_ms > now_ms) {
+      return it->second;
+    }
+  }
+
+  polaris::InstancesResponse* response = nullptr;
+  polaris::ReturnCode ret = nearby_free_consumer_api_->GetInstances(request, response);
+  if (ret != polaris::ReturnCode::kReturnOk) {
+    TRPC_FMT_ERROR("GetInstances without the nearby router failed, sdk returnCode:{}, service_name:{}, "
+                   "service_namespace:{}",
+                   static_cast<int32_t>(ret), service_key.name_, service_key.namespace_);
+    if (response != nullptr) {
+      delete response;
+    }
+    return nullptr;
+  }
+
+  auto candidates = std::make_shared<RoutedCandidates>();
+  candidates->revision = revision;
+  candidates->expire_ms = now_ms + kRoutedCandidatesTtlMs;
+  candidates->instances.swap(response->GetInstances());
+  delete response;
+  for (std::size_t i = 0; i < candidates->instances.size(); ++i) {
+    const polaris::Instance& instance = candidates->instances[i];
+    candidates->campuses[MakeCampusLocality(instance.GetRegion(), instance.GetZone(), instance.GetCampus())].push_back(
+        i);
+  }
+
+  std::scoped_lock<std::mutex> lock(routed_candidates_mutex_);
+  if (routed_candidates_.size() >= kMaxRoutedCandidatesNum) {
+    routed_candidates_.clear();
+  }
+  routed_candidates_[cache_key] = candidates;
+  return candidates;
+}
+
+std::vector<polaris::Instance> PolarisMeshSelector::GetFailoverInstances(const SelectorInfo* info,
+                                                                         const polaris::ServiceKey& service_key,
+                                                                         const std::string& revision,
+                                                                         const std::vector<polaris::Instance>& routed,
+                                                                         uint64_t now_ms) {
+  std::vector<polaris::Instance> failover;
+  if (routed.empty()) {
+    return failover;
+  }
+
+  // The nearby router does not go beyond the max match level, neither does the failover
+  const std::string& max_match_level = plugin_config_.selector_config.consumer_config.service_router_config
+                                           .router_plugin_config.nearby_based_router_config.max_match_level;
+  if (max_match_level == "zone" || max_match_level == "campus") {
+    return failover;
+  }
+
+  // The candidates are routed by the rules, the sets and the canary like the routed instances
+  RoutedCandidatesPtr candidates = GetRoutedCandidates(info, service_key, revision, now_ms);
+  if (candidates == nullptr) {
+    return failover;
+  }
+  std::string service = service_key.namespace_ + "/" + service_key.name_;
+
+  // The next level of the zone is the region, then all the regions
+  const std::string& region = routed[0].GetRegion();
+  for (const auto& instance : candidates->instances) {
+    if (instance.GetRegion() == region) {
+      failover.push_back(instance);
+    }
+  }
+  failover = locality_breaker_.FilterAvailable(service, failover, now_ms);
+  if (failover.empty() && max_match_level == "none") {
+    failover = locality_breaker_.FilterAvailable(service, candidates->instances, now_ms);
+  }
+  if (!failover.empty()) {
+    TRPC_FMT_DEBUG("Fail over to the next nearby level, service_name:{}, service_namespace:{}, instance num:{}",
+                   service_key.name_, service_key.namespace_, failover.size());
+  }
+  return failover;
+}
+
+void PolarisMeshSelector::ApplyLatencyRouting(const SelectorInfo* info, polaris::InstancesResponse* discovery_rsp) {
+  std::vector<polaris::Instance>& instances = discovery_rsp->GetInstances();
+  const std::string& max_match_level = plugin_config_.selector_config.consumer_config.service_router_config
+                                           .router_plugin_config.nearby_based_router_config.max_match_level;
+  if (instances.empty() || max_match_level == "campus") {
+    return;
+  }
+
+  // The localities are ranked among the rule routing result, so the latency routing never goes out of it
+  polaris::ServiceKey service_key{discovery_rsp->GetServiceNamespace(), info->name};
+  uint64_t now_ms = trpc::time::GetMilliSeconds();
+  RoutedCandidatesPtr candidates = GetRoutedCandidates(info, service_key, discovery_rsp->GetRevision(), now_ms);
+  if (candidates == nullptr) {
+    return;
+  }
+
+  std::string service = service_key.namespace_ + "/" + service_key.name_;
+  bool has_open = locality_breaker_.Enabled() && locality_breaker_.HasOpen(service, now_ms);
+  const polaris::Instance& routed = instances[0];
+  std::vector<std::string> localities;
+  for (const auto& [locality, indexes] : candidates->campuses) {
+    const polaris::Instance& instance = candidates->instances[indexes[0]];
+    if ((max_match_level == "region" || max_match_level == "zone") && instance.GetRegion() != routed.GetRegion()) {
+      continue;
+    }
+    if (max_match_level == "zone" && instance.GetZone() != routed.GetZone()) {
+      continue;
+    }
+    // The instances of a campus are in the same zone, and in the same set of the rule routing result
+    std::string set_name = has_open ? GetInstanceSetName(instance) : "";
+    if (has_open &&
+        (locality_breaker_.IsOpen(service, MakeZoneLocality(instance.GetRegion(), instance.GetZone()), now_ms) ||
+         (!set_name.empty() && locality_breaker_.IsOpen(service, MakeSetLocality(set_name), now_ms)))) {
+      continue;
+    }
+    if (indexes.size() >= plugin_config_.selector_config.latency_router_config.min_healthy_instances) {
+      localities.push_back(locality);
+    }
+  }
+
+  std::string locality = latency_router_.Choose(service, localities, now_ms);
+  if (locality.empty()) {
+    return;
+  }
+
+  // The routed instances of the locality are preferred, the others of the locality are from the rule routing result
+  std::vector<polaris::Instance> locality_instances;
+  for (const auto& instance : instances) {
+    if (MakeCampusLocality(instance.GetRegion(), instance.GetZone(), instance.GetCampus()) == locality) {
+      locality_instances.push_back(instance);
+    }
+  }
+  if (locality_instances.size() == instances.size()) {
+    return;
+  }
+  if (locality_instances.empty()) {
+    for (std::size_t index : candidates->campuses.at(locality)) {
+      locality_instances.push_back(candidates->instances[index]);
+    }
+  }
+  instances.swap(locality_instances);
+}
+
+void PolarisMeshSelector::ApplySpillover(const SelectorInfo* info, polaris::InstancesResponse* discovery_rsp) {
+  std::vector<polaris::Instance>& instances = discovery_rsp->GetInstances();
+  const naming::SpilloverConfig& config = plugin_config_.selector_config.spillover_config;
+  const std::string& max_match_level = plugin_config_.selector_config.consumer_config.service_router_config
+                                           .router_plugin_config.nearby_based_router_config.max_match_level;
+  if (instances.empty() || max_match_level == "zone" || max_match_level == "campus") {
+    return;
+  }
+
+  uint64_t local_inflight = 0;
+  std::set<std::string> local_zones;
+  for (const auto& instance : instances) {
+    InstanceStatsPtr instance_stats = instance_stats_.Find(instance.GetLocalId());
+    if (instance_stats) {
+      local_inflight += instance_stats->GetInflight();
+    }
+    local_zones.insert(MakeZoneLocality(instance.GetRegion(), instance.GetZone()));
+  }
+  // The other zones are not discovered while the routed zone is lightly loaded
+  if (local_inflight < static_cast<uint64_t>(config.min_inflight) * instances.size()) {
+    return;
+  }
+
+  // The other zones are taken from the rule routing result, so the spillover never goes out of it
+  polaris::ServiceKey service_key{discovery_rsp->GetServiceNamespace(), info->name};
+  uint64_t now_ms = trpc::time::GetMilliSeconds();
+  RoutedCandidatesPtr candidates = GetRoutedCandidates(info, service_key, discovery_rsp->GetRevision(), now_ms);
+  if (candidates == nullptr) {
+    return;
+  }
+
+  std::string service = service_key.namespace_ + "/" + service_key.name_;
+  bool has_open = locality_breaker_.Enabled() && locality_breaker_.HasOpen(service, now_ms);
+  const polaris::Instance& routed = instances[0];
+  std::vector<std::size_t> remote;
+  uint64_t remote_inflight = 0;
+  for (const auto& [locality, indexes] : candidates->campuses) {
+    const polaris::Instance& instance = candidates->instances[indexes[0]];
+    std::string zone = MakeZoneLocality(instance.GetRegion(), instance.GetZone());
+    if (local_zones.count(zone) > 0) {
+      continue;
+    }
+    if (max_match_level == "region" && instance.GetRegion() != routed.GetRegion()) {
+      continue;
+    }
+    std::string set_name = has_open ? GetInstanceSetName(instance) : "";
+    if (has_open && (locality_breaker_.IsOpen(service, zone, now_ms) ||
+                     (!set_name.empty() && locality_breaker_.IsOpen(service, MakeSetLocality(set_name), now_ms)))) {
+      continue;
+    }
+    for (std::size_t index : indexes) {
+      InstanceStatsPtr instance_stats = instance_stats_.Find(candidates->instances[index].GetLocalId());
+      if (instance_stats) {
+        remote_inflight += instance_stats->GetInflight();
+      }
+      remote.push_back(index);
+    }
+  }
+
+  uint32_t ratio = CalculateSpilloverRatio(config, local_inflight, instances.size(), remote_inflight, remote.size());
+  if (HitSpilloverRatio(ratio)) {
+    // The remote instances are copied only for the spilled requests
+    std::vector<polaris::Instance> remote_instances;
+    remote_instances.reserve(remote.size());
+    for (std::size_t index : remote) {
+      remote_instances.push_back(candidates->instances[index]);
+    }
+    instances.swap(remote_instances);
+  }
+}
+
+uint64_t PolarisMeshSelector::ApplyFlapDamping(const SelectorInfo* info, polaris::InstancesResponse* discovery_rsp,
+                                               std::vector<TrpcEndpointInfo>& endpoints) {
+  // The damping state is kept per routing result like the routed candidates, so that the callers routed to different
+  // instances of the service do not share it. All the instances are returned to the ALL policy without routing
+  polaris::ServiceKey service_key{discovery_rsp->GetServiceNamespace(), info->name};
+  std::string damper_key = service_key.namespace_ + "/" + service_key.name_ + "/" +
+                           std::to_string(static_cast<int>(info->policy)) + "|";
+  if (info->policy != SelectorPolicy::ALL) {
+    polaris::ServiceKey source_service_key;
+    GetSourceServiceKey(info->context, info->extend_select_info, source_service_key);
+    polaris::GetInstancesRequest request(service_key);
+    FillRoutingRequest(info, source_service_key, request, &damper_key);
+  }
+  return flap_damper_.Apply(damper_key, endpoints, trpc::time::GetMilliSeconds());
+}
+
 bool PolarisMeshSelector::SetCircuitBreakWhiteList(const std::vector<int>& framework_retcodes) {
   auto& writer = circuitbreak_whitelist_.Writer();
   writer.clear();
@@ -14,7 +14,9 @@
 #pragma once
 
 #include <any>
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -28,6 +30,16 @@
 
 #include "trpc/naming/common/common_defs.h"
 #include "trpc/naming/polarismesh/common.h"
+#include "trpc/naming/polarismesh/polarismesh_adaptive_timeout.h"
+#include "trpc/naming/polarismesh/polarismesh_flap_damper.h"
+#include "trpc/naming/polarismesh/polarismesh_instance_stats.h"
+#include "trpc/naming/polarismesh/polarismesh_instance_watcher.h"
+#include "trpc/naming/polarismesh/polarismesh_latency_router.h"
+#include "trpc/naming/polarismesh/polarismesh_load_balancer.h"
+#include "trpc/naming/polarismesh/polarismesh_locality_breaker.h"
+#include "trpc/naming/polarismesh/polarismesh_retry_budget.h"
+#include "trpc/naming/polarismesh/polarismesh_spillover.h"
+#include "trpc/naming/polarismesh/polarismesh_subsetter.h"
 #include "trpc/naming/polarismesh/readers_writer_data.h"
 #include "trpc/naming/selector.h"
 
@@ -51,6 +63,8 @@ uint32_t GetPolarisMeshSelectorPluginID();
 /// - replicate_index (uint32_t)
 /// - metadata (std::map<std::string, std::string>)
 /// - include_unhealthy (boolean)
+/// - backup_prefer_other_zone (boolean)
+/// - excluded_instances (comma separated local ids of the instances, the failed instances are excluded as well)
 /// @param context Client/Server context to store the filter data, can be either serverContext or clientContext.
 /// @param key_value_pairs A variadic list of key-value pairs to set in the context's filter data.
 template <typename T, typename... Args>
@@ -78,6 +92,8 @@ void SetSelectorExtendInfo(T& context, Args&&... key_value_pairs) {
 /// - replicate_index (uint32_t)
 /// - metadata (std::map<std::string, std::string>)
 /// - include_unhealthy (boolean)
+/// - backup_prefer_other_zone (boolean)
+/// - excluded_instances (comma separated local ids of the instances set by the user)
 /// @param context Client/Server context to retrieve the filter data from, can be either serverContext or clientContext.
 /// @param key The key of the property to retrieve.
 /// @return The value of the specified property if found, or an empty string if not found.
@@ -162,9 +178,15 @@ std::unique_ptr<std::map<std::string, std::string>> GetFilterMetadataOfNaming(T&
 
 }  // namespace naming::polarismesh
 
+/// @brief The shared snapshot of SelectBatch result
+using EndpointsSnapshot = std::shared_ptr<const std::vector<TrpcEndpointInfo>>;
+
 /// @brief polarismesh service discovery plugin
 class PolarisMeshSelector : public Selector {
  public:
+  /// @brief The return code of SelectBatchIfModified when the result is unchanged
+  static constexpr int kSelectNotModified = 1;
+
   /// @brief The name of the plugin
   std::string Name() const override { return kPolarisPluginName; }
 
@@ -176,11 +198,11 @@ class PolarisMeshSelector : public Selector {
 
   /// @brief In the internal implementation of the plugin, it needs to be used when the thread needs to be created.
   /// You can use this interface uniformly
-  void Start() noexcept override {}
+  void Start() noexcept override;
 
   /// @brief When there is a thread in the internal implementation of the plugin, the interface of the stop thread
   /// needs to be implemented
-  void Stop() noexcept override {}
+  void Stop() noexcept override;
 
   /// @brief Various resources to destroy specific plugin
   void Destroy() noexcept override;
@@ -194,9 +216,29 @@ class PolarisMeshSelector : public Selector {
   /// @brief Obtain the interface of node routing information according to strategy
   int SelectBatch(const SelectorInfo* info, std::vector<TrpcEndpointInfo>* endpoints) override;
 
+  /// @brief Obtain the node routing information according to strategy, only when it is changed since last_revision
+  /// @param info Select information, same as SelectBatch
+  /// @param last_revision The revision returned by the last call, empty for the first call
+  /// @param[out] revision The revision of the returned snapshot, it is always empty for the MULTIPLE policy
+  /// @param[out] endpoints The new snapshot, untouched when the result is unchanged
+  /// @return 0 with a new snapshot, kSelectNotModified if the instance set and the routing result are unchanged,
+  ///         -1 on failure
+  int SelectBatchIfModified(const SelectorInfo* info, const std::string& last_revision, std::string* revision,
+                            EndpointsSnapshot* endpoints);
+
   /// @brief Asynchronously obtain the interface of node routing information according to strategy
   Future<std::vector<TrpcEndpointInfo>> AsyncSelectBatch(const SelectorInfo* info) override;
 
+  /// @brief Select the replicas of the hash key in one call, which are the distinct successors of the hash key on the
+  ///        hash ring, the same as calling Select with replicate_index from 0 to replica_num - 1
+  /// @param info Select information, the hash key of the context is required, and the load balancing should be a
+  ///        consistent hash (e.g. ringHash)
+  /// @param replica_num The number of the replicas
+  /// @param[out] endpoints The replicas ordered by the replica index, fewer than replica_num if there are not enough
+  ///        instances
+  /// @return 0 on success, -1 on failure
+  int SelectReplicas(const SelectorInfo* info, uint32_t replica_num, std::vector<TrpcEndpointInfo>* endpoints);
+
   /// @brief Report interface on the result
   int ReportInvokeResult(const InvokeResult* result) override;
 
@@ -206,18 +248,85 @@ class PolarisMeshSelector : public Selector {
   /// @brief Set framework error codes melting white list
   bool SetCircuitBreakWhiteList(const std::vector<int>& framework_retcodes) override;
 
+  /// @brief Subscribe the instance changes of the service
+  /// @param service_name The name of the callee service
+  /// @param service_namespace The namespace of the callee service
+  /// @param callback Receives all the available instances first, and then the deltas between revisions
+  /// @return The subscription id, 0 if the plugin is not initialized
+  /// @note The revisions of the subscribed services are checked periodically after Start()
+  uint64_t Subscribe(const std::string& service_name, const std::string& service_namespace,
+                     InstanceDeltaCallback callback);
+
+  /// @brief Cancel the subscription
+  /// @return false if the subscription does not exist
+  bool Unsubscribe(uint64_t subscription_id);
+
+  /// @brief Check the revisions of the subscribed services and dispatch the deltas to the subscribers
+  void CheckSubscriptions();
+
+  /// @brief Acquire the retry budget of the callee service for a retry or a hedged request of the context
+  /// @return true if the request is admitted or the retry budget is not enabled, false if the budget is spent
+  bool AcquireRetryBudget(const ClientContextPtr& context, const std::string& service_name);
+
+  /// @brief Get the key of the callee service in the stats of the plugin, e.g. the retry budget and the timeout
+  /// advisor, which is "namespace/service_name"
+  std::string GetServiceStatsKey(const ClientContextPtr& context, const std::string& service_name);
+
+  /// @brief Whether the retry budget of the callee service admits a hedged request, without withdrawing a token
+  /// @param service The key of the callee service returned by GetServiceStatsKey
+  /// @return true if there is a token or the retry budget is not enabled
+  bool HasRetryBudget(const std::string& service);
+
+  /// @brief Withdraw a token of the retry budget of the callee service for a backup request which is sent
+  /// @param service The key of the callee service returned by GetServiceStatsKey
+  void ConsumeRetryBudget(const std::string& service);
+
+  /// @brief Get the state of the retry budget of the callee service
+  RetryBudgetState GetRetryBudgetState(const std::string& service_namespace, const std::string& service_name) const;
+
+  /// @brief Get the recommended timeout of the method of the callee service by its observed latency
+  /// @return The latency percentile times the factor of the adaptive timeout config, 0 if the adaptive timeout is not
+  ///         enabled or there are not enough latency samples
+  uint64_t GetRecommendedTimeout(const std::string& service_namespace, const std::string& service_name,
+                                 const std::string& method);
+
+  /// @brief Get the call stats of the instance selected by this plugin
+  /// @return nullptr if the instance has never been selected (or has been evicted)
+  InstanceStatsPtr GetInstanceStats(uint64_t local_id) const { return instance_stats_.Find(local_id); }
+
   /// @brief Setter function for plugin_config_
   void SetPluginConfig(const naming::PolarisMeshNamingConfig& config) { plugin_config_ = config; }
 
+  /// @brief Getter function for plugin_config_, which is adjusted by Init, e.g. the spillover is disabled by the strict
+  ///        nearby routing
+  const naming::PolarisMeshNamingConfig& GetPluginConfig() const { return plugin_config_; }
+
   /// @brief ServiceKey, the main tone
   /// @param[in] client_context_ptr Client context
   /// @param[out] service_key SERVICEKEY of the main tone
   void GetSourceServiceKey(const ClientContextPtr& client_context_ptr, const std::any* extend_select_info,
                            polaris::ServiceKey& service_key);
 
+ protected:
+  // Report the call result to the SDK, which feeds the circuit breaker and the load balancing of the SDK
+  virtual int UpdateServiceCallResult(polaris::ServiceCallResult& result_req);
+
  private:
-  // Get the specific implementation of the service node from the SDK GetoneInstance interface
-  int SelectImpl(const SelectorInfo* info, polaris::InstancesResponse*& polarismesh_response_info);
+  // Set up the subsetter by the config and the identity of the client
+  void InitSubsetter();
+
+  // Get the specific implementation of the service node from the SDK GetoneInstance interface, the replicas of the hash
+  // key are returned if replica_num is not 0
+  int SelectImpl(const SelectorInfo* info, polaris::InstancesResponse*& polarismesh_response_info,
+                 uint32_t replica_num = 0);
+
+  // Get the instances of SelectBatch from the SDK GetAllInstances/GetInstances interface
+  int SelectBatchImpl(const SelectorInfo* info, polaris::InstancesResponse*& discovery_rsp);
+
+  // Fill the routing labels of the context in the request of GetInstances, and append them to the routing key if it is
+  // not nullptr
+  void FillRoutingRequest(const SelectorInfo* info, const polaris::ServiceKey& source_service_key,
+                          polaris::GetInstancesRequest& discovery_req, std::string* routing_key = nullptr);
 
   // Set the main service information
   void FillMetadataOfSourceServiceInfo(const SelectorInfo* info, polaris::ServiceInfo& source_service_info);
@@ -234,6 +343,87 @@ class PolarisMeshSelector : public Selector {
   // Tries to get the value for the given "namespace" from the context.
   std::string GetNamespaceFromContextOrExtend(const ClientContextPtr& context, const std::any* extend_select_info);
 
+  // Whether to select by the load balancing of the plugin, instead of the SDK GetOneInstance interface
+  bool UsePluginLoadBalance(const SelectorInfo* info, const ExcludedInstances& excluded);
+
+  // Select an instance from the routing result of the SDK by the load balancing of the plugin
+  int SelectByPlugin(const SelectorInfo* info, const ExcludedInstances& excluded, TrpcEndpointInfo* endpoint);
+
+  // Record the selected instance in the stats table and carry its stats through the context
+  void RecordSelectedInstance(const ClientContextPtr& context, const polaris::Instance& instance);
+
+  // Record the instances selected for the backup request, the reported one is the called instance and the others are
+  // the losers
+  void RecordSelectedBackups(const ClientContextPtr& context, const std::vector<polaris::Instance>& instances);
+
+  // Evict the idle instance stats once in a while
+  void EvictIdleInstanceStats(uint64_t now_ms);
+
+  // Get the instances excluded from the selection of the context, e.g. the instances failed in the previous tries.
+  // retry is true if the context is tried before, the instances excluded by the user only do not make a retry
+  ExcludedInstances GetExcludedInstances(const SelectorInfo* info, bool& retry);
+
+  // Exclude the instance from the following selections of the context
+  void ExcludeInstance(const ClientContextPtr& context, uint64_t local_id);
+
+  // Take the stats of the instance which is selected and called by the context, return nullptr if it is not selected
+  // by this plugin or is reported already. inflight is false if the instance is a loser of the backup request, which is
+  // released already
+  InstanceStatsPtr TakeCalledInstance(const ClientContextPtr& context, bool& inflight);
+
+  // Report the states of the retry budgets to the metrics plugin
+  void ReportRetryBudget();
+
+  // Fetch the instances of the service from the SDK cache and feed them to the watcher
+  void CheckSubscription(const polaris::ServiceKey& service_key);
+
+  // Record the first seen time of all the instances of the service for the slow start, so that the instances routed
+  // later (e.g. after a zone failover) are not regarded as new
+  void ObserveSlowStart(const polaris::ServiceKey& service_key, const std::string& revision, uint64_t now_ms);
+
+  // Keep the instances of the SDK result which are in the subset of the client, the subset is picked from all the
+  // instances of the service
+  void ApplySubset(const polaris::ServiceKey& service_key, const std::string& revision,
+                   std::vector<polaris::Instance>& instances);
+
+  // Skip the instances of the SDK result which are in the broken zones or sets, and fail over to the next nearby level
+  // if all of them are broken
+  void ApplyLocalityBreaker(const SelectorInfo* info, polaris::InstancesResponse* discovery_rsp);
+
+  // The instances routed by the rules, the sets and the canary without the nearby router
+  struct RoutedCandidates {
+    // The revision of the service when they are routed
+    std::string revision;
+    // Fetched again after it, unit: ms
+    uint64_t expire_ms{0};
+    std::vector<polaris::Instance> instances;
+    // The indexes of the instances by the campus locality
+    std::unordered_map<std::string, std::vector<std::size_t>> campuses;
+  };
+  using RoutedCandidatesPtr = std::shared_ptr<const RoutedCandidates>;
+
+  // Get the instances of the service routed with the routing labels of the context but without the nearby router,
+  // which are cached per revision of the service
+  RoutedCandidatesPtr GetRoutedCandidates(const SelectorInfo* info, const polaris::ServiceKey& service_key,
+                                          const std::string& revision, uint64_t now_ms);
+
+  // Get the available instances of the service at the next nearby level of the routed instances
+  std::vector<polaris::Instance> GetFailoverInstances(const SelectorInfo* info, const polaris::ServiceKey& service_key,
+                                                      const std::string& revision,
+                                                      const std::vector<polaris::Instance>& routed, uint64_t now_ms);
+
+  // Route the SDK result to the locality with the lowest measured latency among the localities of the rule routing
+  // result within the max match level of the nearby router
+  void ApplyLatencyRouting(const SelectorInfo* info, polaris::InstancesResponse* discovery_rsp);
+
+  // Spill a part of the requests over to the other zones when the routed zone is more loaded than them
+  void ApplySpillover(const SelectorInfo* info, polaris::InstancesResponse* discovery_rsp);
+
+  // Apply the flap damping to the endpoints of SelectBatch per routing result, return the generation of the damped
+  // endpoints
+  uint64_t ApplyFlapDamping(const SelectorInfo* info, polaris::InstancesResponse* discovery_rsp,
+                            std::vector<TrpcEndpointInfo>& endpoints);
+
  private:
   bool init_{false};
 
@@ -254,6 +444,55 @@ class PolarisMeshSelector : public Selector {
   std::shared_ptr<polaris::Context> polarismesh_context_{nullptr};
   std::unique_ptr<polaris::ConsumerApi> consumer_api_{nullptr};
 
+  // Routes without the nearby router, created if the plugin chooses the localities by itself. The call results are
+  // reported to it as well, so that its circuit breaker is in line with the one of consumer_api_
+  std::unique_ptr<polaris::ConsumerApi> nearby_free_consumer_api_{nullptr};
+
+  // The routed candidates keyed by the service and the routing labels
+  std::mutex routed_candidates_mutex_;
+  std::unordered_map<std::string, RoutedCandidatesPtr> routed_candidates_;
+
+  // Per-instance stats indexed by the local id of the instance
+  InstanceStatsTable instance_stats_;
+
+  // Last time the idle instance stats are evicted, unit: ms
+  std::atomic<uint64_t> last_evict_ms_{0};
+
+  // Subscriptions of the instance changes
+  InstanceWatcher instance_watcher_;
+
+  // Serializes the checks of the subscriptions from the periodic task and Subscribe, so that a snapshot fetched earlier
+  // never overwrites a later one, and the deltas are delivered in order. It is reentrant for the callbacks which
+  // subscribe again
+  std::recursive_mutex subscription_mutex_;
+
+  // Slow start of the newly discovered instances
+  SlowStartWeigher slow_start_weigher_;
+
+  // Flap damping of the endpoints returned by SelectBatch and delivered to the subscribers
+  FlapDamper flap_damper_;
+
+  // Client side subsetting of the callee services
+  Subsetter subsetter_;
+
+  // Circuit breaking of the zones and sets of the callee services
+  LocalityBreaker locality_breaker_;
+
+  // Latency-aware routing of the callee services
+  LatencyRouter latency_router_;
+
+  // Retry budgets of the callee services
+  RetryBudget retry_budget_;
+
+  // Timeout recommendations of the methods of the callee services
+  TimeoutAdvisor timeout_advisor_;
+
+  // The periodic task id to check the subscriptions
+  uint64_t watch_task_id_{0};
+
+  // The periodic task id to report the retry budgets
+  uint64_t retry_budget_task_id_{0};
+
   struct PolarisRuleRouteRaw {
     explicit PolarisRuleRouteRaw(polaris::ServiceData* data) : rule_route_data(data) {
       rule_route_data->IncrementRef();
@@ -0,0 +1,184 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_selector_filter.h"
+
+#include <string>
+#include <utility>
+
+#include "trpc/codec/trpc/trpc.pb.h"
+#include "trpc/common/config/trpc_config.h"
+#include "trpc/naming/polarismesh/config/polarismesh_naming_conf.h"
+#include "trpc/naming/polarismesh/polarismesh_selector.h"
+#include "trpc/naming/selector_factory.h"
+#include "trpc/util/log/logging.h"
+#include "trpc/util/string_helper.h"
+#include "trpc/util/time.h"
+
+namespace trpc {
+
+namespace {
+
+// The key of the hedging delay in the selector extend info, which is set if the request is hedged by this filter
+constexpr char kHedgingDelayKey[] = "hedging_delay";
+
+}  // namespace
+
+int PolarisMeshSelectorFilter::Init() {
+  naming::SelectorConfig config;
+  if (TrpcConfig::GetInstance()->GetPluginConfig<naming::SelectorConfig>("selector", "polarismesh", config)) {
+    SetConfig(config);
+  }
+
+  return selector_flow_->Init();
+}
+
+void PolarisMeshSelectorFilter::SetConfig(const naming::SelectorConfig& config) {
+  hedging_policy_.SetConfig(config.hedging_config);
+  apply_adaptive_timeout_ = config.adaptive_timeout_config.enable && config.adaptive_timeout_config.apply_timeout;
+}
+
+void PolarisMeshSelectorFilter::operator()(FilterStatus& status, FilterPoint point, const ClientContextPtr& context) {
+  if (!hedging_policy_.Enabled() && !apply_adaptive_timeout_) {
+    selector_flow_->RunFilter(status, point, context);
+    return;
+  }
+
+  if (point == FilterPoint::CLIENT_PRE_RPC_INVOKE) {
+    // The hedging delay is decided after the timeout is lowered
+    if (apply_adaptive_timeout_) {
+      ApplyAdaptiveTimeout(context);
+    }
+    if (hedging_policy_.Enabled()) {
+      StartHedging(context);
+    }
+    selector_flow_->RunFilter(status, point, context);
+  } else if (point == FilterPoint::CLIENT_POST_RPC_INVOKE) {
+    // The workflow reports the winner
+    selector_flow_->RunFilter(status, point, context);
+    if (hedging_policy_.Enabled()) {
+      FinishHedging(context);
+    }
+  } else {
+    selector_flow_->RunFilter(status, point, context);
+  }
+}
+
+void PolarisMeshSelectorFilter::ApplyAdaptiveTimeout(const ClientContextPtr& context) {
+  auto selector = static_pointer_cast<PolarisMeshSelector>(SelectorFactory::GetInstance()->Get("polarismesh"));
+  if (selector == nullptr) {
+    return;
+  }
+
+  polaris::ServiceKey source_service_key;
+  selector->GetSourceServiceKey(context, nullptr, source_service_key);
+  uint64_t timeout =
+      selector->GetRecommendedTimeout(source_service_key.namespace_, context->GetCalleeName(), context->GetFuncName());
+  // The static timeout is an upper bound
+  if (timeout > 0 && timeout < context->GetTimeout()) {
+    context->SetTimeout(static_cast<uint32_t>(timeout));
+  }
+}
+
+void PolarisMeshSelectorFilter::StartHedging(const ClientContextPtr& context) {
+  // The backup request set by the user is kept as it is
+  if (context->GetBackupRequestRetryInfo() != nullptr) {
+    return;
+  }
+
+  auto selector = static_pointer_cast<PolarisMeshSelector>(SelectorFactory::GetInstance()->Get("polarismesh"));
+  if (selector == nullptr) {
+    return;
+  }
+
+  // The latencies and the retry budget are kept by the same key of the callee service as the other stats
+  std::string service = selector->GetServiceStatsKey(context, context->GetCalleeName());
+  uint64_t delay = hedging_policy_.GetDelay(service, trpc::time::GetMilliSeconds());
+  if (delay == 0) {
+    return;
+  }
+
+  // The backup request is a retry in advance, which shares the retry budget of the service with the retries. The token
+  // is withdrawn only if the backup request is sent, when the first request does not return within the delay
+  if (!selector->HasRetryBudget(service)) {
+    return;
+  }
+
+  context->SetBackupRequestDelay(static_cast<uint32_t>(delay));
+  naming::polarismesh::SetSelectorExtendInfo(context, std::make_pair(kHedgingDelayKey, std::to_string(delay)));
+  if (hedging_policy_.GetConfig().prefer_other_zone) {
+    naming::polarismesh::SetSelectorExtendInfo(context, std::make_pair("backup_prefer_other_zone", "true"));
+  }
+}
+
+void PolarisMeshSelectorFilter::FinishHedging(const ClientContextPtr& context) {
+  auto selector = static_pointer_cast<PolarisMeshSelector>(SelectorFactory::GetInstance()->Get("polarismesh"));
+  if (selector == nullptr) {
+    return;
+  }
+
+  std::string service = selector->GetServiceStatsKey(context, context->GetCalleeName());
+  uint64_t now_ms = trpc::time::GetMilliSeconds();
+  uint64_t send_ms = context->GetSendTimestampUs() / 1000;
+  uint64_t elapsed = now_ms > send_ms ? now_ms - send_ms : 0;
+  if (context->GetStatus().OK()) {
+    // When the request is hedged, the elapsed time is a lower bound of the latency of the first request, which keeps
+    // the delay from being dragged down by the backup requests
+    hedging_policy_.RecordLatency(service, elapsed, now_ms);
+  }
+
+  std::string delay_str = naming::polarismesh::GetSelectorExtendInfo(context, kHedgingDelayKey);
+  auto* retry_info = context->GetBackupRequestRetryInfo();
+  if (delay_str.empty() || retry_info == nullptr || retry_info->backup_addrs.size() < 2) {
+    return;
+  }
+  uint64_t delay = trpc::util::Convert<uint64_t, std::string>(delay_str);
+  // The first request returns before the delay, the backup request is not sent
+  if (elapsed < delay) {
+    return;
+  }
+
+  selector->ConsumeRetryBudget(service);
+
+  // Without a winner (e.g. all the requests fail or time out), the called address was reported as failed by the
+  // workflow, and the other requests are released by that report
+  if (!context->GetStatus().OK() || retry_info->succ_rsp_node_index < 0) {
+    return;
+  }
+
+  // Report the losers as canceled, they are found by the instances recorded when the backup request is selected. The
+  // canceled calls are not reported to the SDK, so that they are not counted as successes nor failures
+  std::string winner_ip = context->GetIp();
+  int winner_port = context->GetPort();
+  for (std::size_t i = 0; i < retry_info->backup_addrs.size(); ++i) {
+    if (static_cast<int>(i) == retry_info->succ_rsp_node_index) {
+      continue;
+    }
+    const auto& addr = retry_info->backup_addrs[i].addr;
+    context->SetAddr(addr.ip, addr.port);
+
+    InvokeResult result;
+    result.name = context->GetCalleeName();
+    result.framework_result = TrpcRetCode::TRPC_CLIENT_CANCELED_ERR;
+    result.interface_result = 0;
+    result.cost_time = i == 0 ? elapsed : elapsed - delay;
+    result.context = context;
+    if (selector->ReportInvokeResult(&result) != 0) {
+      TRPC_FMT_DEBUG("Report canceled hedging request failed, service_name:{}, addr:{}:{}", result.name, addr.ip,
+                     addr.port);
+    }
+  }
+  context->SetAddr(winner_ip, winner_port);
+}
+
+}  // namespace trpc
@@ -17,12 +17,17 @@
 #include <string>
 #include <vector>
 
+#include "trpc/client/client_context.h"
 #include "trpc/filter/filter.h"
+#include "trpc/naming/polarismesh/polarismesh_hedging.h"
 #include "trpc/naming/selector_workflow.h"
 
 namespace trpc {
 
 /// @brief polarismesh Service Discovery Filter
+/// @note With hedging enabled, a backup request is sent to another instance if the request does not return in the
+///       observed latency percentile of the callee service, the loser only releases its in-flight request. With the
+///       adaptive timeout applied, the timeout of the request is lowered to the recommended timeout of the method
 class PolarisMeshSelectorFilter : public MessageClientFilter {
  public:
   PolarisMeshSelectorFilter() { selector_flow_ = std::make_unique<SelectorWorkFlow>("polarismesh", true, true); }
@@ -30,7 +35,11 @@ class PolarisMeshSelectorFilter : public MessageClientFilter {
   ~PolarisMeshSelectorFilter() override {}
 
   /// @brief initialization
-  int Init() override { return selector_flow_->Init(); }
+  int Init() override;
+
+  /// @brief Set the config of the hedging and the adaptive timeout, which is read from the selector config of the
+  ///        plugin by Init
+  void SetConfig(const naming::SelectorConfig& config);
 
   /// @brief Filter name
   std::string Name() override { return "polarismesh"; }
@@ -45,12 +54,25 @@ class PolarisMeshSelectorFilter : public MessageClientFilter {
   }
 
   /// @brief Trigger the corresponding treatment at the buried point
-  void operator()(FilterStatus& status, FilterPoint point, const ClientContextPtr& context) override {
-    selector_flow_->RunFilter(status, point, context);
-  }
+  void operator()(FilterStatus& status, FilterPoint point, const ClientContextPtr& context) override;
+
+ private:
+  // Lower the timeout of the request to the recommended timeout of the method
+  void ApplyAdaptiveTimeout(const ClientContextPtr& context);
+
+  // Set the backup request of the hedging before selecting
+  void StartHedging(const ClientContextPtr& context);
+
+  // Record the latency and report the loser of the hedging after the winner is reported
+  void FinishHedging(const ClientContextPtr& context);
 
  private:
   std::unique_ptr<SelectorWorkFlow> selector_flow_;
+
+  HedgingPolicy hedging_policy_;
+
+  // Whether to set the recommended timeout to the requests
+  bool apply_adaptive_timeout_{false};
 };
 
 using PolarisMeshSelectorFilterPtr = RefPtr<PolarisMeshSelectorFilter>;
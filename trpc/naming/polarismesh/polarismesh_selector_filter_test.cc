@@ -72,6 +72,7 @@ class PolarisMeshSelectorFilterTest : public polaris::MockServerConnectorTest {
     YAML::Node root = YAML::Load(trpc::buildPolarisMeshNamingConfig(default_Switch));
     YAML::Node selector_node = root["selector"];
     trpc::naming::SelectorConfig selector_config = selector_node["polarismesh"].as<trpc::naming::SelectorConfig>();
+    CustomizeSelectorConfig(selector_config);
 
     selector_node["polarismesh"]["global"]["serverConnector"]["protocol"] = server_connector_plugin_name_;
     // Set local regional information that is the main service, and visit the nearest visit
@@ -112,6 +113,9 @@ class PolarisMeshSelectorFilterTest : public polaris::MockServerConnectorTest {
     cb->mutable_namespace_()->set_value("xxx");
   }
 
+  // Customize the plugin config of the selector before it is initialized
+  virtual void CustomizeSelectorConfig(trpc::naming::SelectorConfig& selector_config) {}
+
   void InitServiceNormalData() {
     polaris::FakeServer::InstancesResponse(instances_response_, service_key_);
     v1::Service* service = instances_response_.mutable_service();
@@ -249,4 +253,102 @@ TEST_F(PolarisMeshSelectorFilterTest, operator_select_multi) {
                                     .addr.port);
 }
 
+TEST_F(PolarisMeshSelectorFilterTest, operator_select_multi_prefer_other_zone) {
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              RegisterEventHandler(::testing::Eq(service_key_), ::testing::_, ::testing::_, ::testing::_, ::testing::_))
+      .Times(::testing::Exactly(2))
+      .WillRepeatedly(::testing::DoAll(::testing::Invoke(this, &PolarisMeshSelectorFilterTest::MockFireEventHandler),
+                                       ::testing::Return(polaris::kReturnOk)));
+  ProtocolPtr request = std::make_shared<MockProtocol>();
+  auto context = trpc::MakeRefCounted<ClientContext>();
+  context->SetRequest(request);
+  ServiceProxyOption option;
+  option.name = "test";
+  option.target = service_key_.name_;
+  option.name_space = service_key_.namespace_;
+  option.selector_name = "polarismesh";
+  context->SetServiceProxyOption(&option);
+  context->SetBackupRequestDelay(10);
+  // Extra candidates are asked from the SDK, but only the selected number of nodes are returned
+  ::trpc::naming::polarismesh::SetSelectorExtendInfo(context, std::make_pair("backup_prefer_other_zone", "true"));
+  FilterStatus status;
+  selector_filter_->operator()(status, FilterPoint::CLIENT_PRE_RPC_INVOKE, context);
+  ASSERT_EQ(status, FilterStatus::CONTINUE);
+  ASSERT_EQ(context->GetBackupRequestRetryInfo()->backup_addrs.size(), 2);
+  ASSERT_NE(context->GetBackupRequestRetryInfo()->backup_addrs[0].addr.port,
+            context->GetBackupRequestRetryInfo()->backup_addrs[1].addr.port);
+
+  selector_filter_->operator()(status, FilterPoint::CLIENT_POST_RPC_INVOKE, context);
+  ASSERT_EQ(status, FilterStatus::CONTINUE);
+}
+
+class PolarisMeshSelectorFilterAdaptiveTimeoutTest : public PolarisMeshSelectorFilterTest {
+ protected:
+  void CustomizeSelectorConfig(trpc::naming::SelectorConfig& selector_config) override {
+    selector_config.adaptive_timeout_config.enable = true;
+    selector_config.adaptive_timeout_config.apply_timeout = true;
+    selector_config.adaptive_timeout_config.percentile = 99;
+    selector_config.adaptive_timeout_config.factor = 200;
+    selector_config.adaptive_timeout_config.min_samples = 10;
+    selector_config.adaptive_timeout_config.min_timeout = 10;
+  }
+};
+
+TEST_F(PolarisMeshSelectorFilterAdaptiveTimeoutTest, ApplyAdaptiveTimeout) {
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              RegisterEventHandler(::testing::Eq(service_key_), ::testing::_, ::testing::_, ::testing::_, ::testing::_))
+      .Times(::testing::Exactly(2))
+      .WillRepeatedly(::testing::DoAll(::testing::Invoke(this, &PolarisMeshSelectorFilterTest::MockFireEventHandler),
+                                       ::testing::Return(polaris::kReturnOk)));
+  auto filter = std::make_shared<PolarisMeshSelectorFilter>();
+  ASSERT_EQ(0, filter->Init());
+  trpc::naming::SelectorConfig config;
+  config.adaptive_timeout_config.enable = true;
+  config.adaptive_timeout_config.apply_timeout = true;
+  filter->SetConfig(config);
+
+  ProtocolPtr request = std::make_shared<MockProtocol>();
+  ServiceProxyOption option;
+  option.name = "test";
+  option.target = service_key_.name_;
+  option.name_space = service_key_.namespace_;
+  option.selector_name = "polarismesh";
+  auto make_context = [&](uint32_t timeout) {
+    auto context = trpc::MakeRefCounted<ClientContext>();
+    context->SetRequest(request);
+    context->SetServiceProxyOption(&option);
+    context->SetFuncName("/trpc.test.helloworld.Greeter/SayHello");
+    context->SetTimeout(timeout);
+    return context;
+  };
+
+  // The static timeout is kept before there are enough latency samples
+  FilterStatus status;
+  auto context = make_context(1000);
+  (*filter)(status, FilterPoint::CLIENT_PRE_RPC_INVOKE, context);
+  ASSERT_EQ(status, FilterStatus::CONTINUE);
+  ASSERT_EQ(1000, context->GetTimeout());
+
+  for (int i = 0; i < 10; ++i) {
+    trpc::InvokeResult result;
+    result.name = service_key_.name_;
+    result.framework_result = trpc::TrpcRetCode::TRPC_INVOKE_SUCCESS;
+    result.interface_result = 0;
+    result.cost_time = 40;
+    result.context = make_context(1000);
+    ASSERT_EQ(0, selector_->ReportInvokeResult(&result));
+  }
+
+  // Lowered to the latency percentile times the factor
+  context = make_context(1000);
+  (*filter)(status, FilterPoint::CLIENT_PRE_RPC_INVOKE, context);
+  ASSERT_GE(context->GetTimeout(), 80);
+  ASSERT_LE(context->GetTimeout(), 90);
+
+  // The static timeout is an upper bound
+  context = make_context(50);
+  (*filter)(status, FilterPoint::CLIENT_PRE_RPC_INVOKE, context);
+  ASSERT_EQ(50, context->GetTimeout());
+}
+
 }  // namespace trpc
@@ -16,6 +16,8 @@
 #include <pthread.h>
 #include <stdint.h>
 
+#include <set>
+
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "polaris/model/constants.h"
@@ -43,6 +45,23 @@ class MockProtocol : public Protocol {
   virtual bool ZeroCopyEncode(NoncontiguousBuffer& buff) { return true; };
 };
 
+// Records the call results reported to the SDK
+class ReportRecordingSelector : public PolarisMeshSelector {
+ public:
+  struct Report {
+    std::string instance_id;
+    polaris::CallRetStatus ret_status;
+  };
+
+  std::vector<Report> reports;
+
+ protected:
+  int UpdateServiceCallResult(polaris::ServiceCallResult& result_req) override {
+    reports.push_back(Report{result_req.GetInstanceId(), result_req.GetRetStatus()});
+    return PolarisMeshSelector::UpdateServiceCallResult(result_req);
+  }
+};
+
 class PolarisSelectTest : public polaris::MockServerConnectorTest {
  protected:
   virtual void SetUp() {
@@ -67,6 +86,7 @@ class PolarisSelectTest : public polaris::MockServerConnectorTest {
     YAML::Node root = YAML::Load(trpc::buildPolarisMeshNamingConfig(default_Switch));
     YAML::Node selector_node = root["selector"];
     trpc::naming::SelectorConfig selector_config = selector_node["polarismesh"].as<trpc::naming::SelectorConfig>();
+    CustomizeSelectorConfig(selector_config);
 
     selector_node["polarismesh"]["global"]["serverConnector"]["protocol"] = server_connector_plugin_name_;
     // Set local regional information that is the main service, and visit the nearest visit
@@ -85,10 +105,11 @@ class PolarisSelectTest : public polaris::MockServerConnectorTest {
     naming_config.orig_selector_config = orig_selector_config;
     naming_config.Display();
 
-    trpc::RefPtr<trpc::PolarisMeshSelector> p = MakeRefCounted<trpc::PolarisMeshSelector>();
+    trpc::RefPtr<ReportRecordingSelector> p = MakeRefCounted<ReportRecordingSelector>();
     trpc::SelectorFactory::GetInstance()->Register(p);
     selector_ = static_pointer_cast<PolarisMeshSelector>(trpc::SelectorFactory::GetInstance()->Get("polarismesh"));
     EXPECT_EQ(p.get(), selector_.get());
+    recording_selector_ = p;
 
     selector_->SetPluginConfig(naming_config);
     ASSERT_EQ(0, selector_->Init());
@@ -102,6 +123,9 @@ class PolarisSelectTest : public polaris::MockServerConnectorTest {
     cb->mutable_namespace_()->set_value("xxx");
   }
 
+  // Customize the plugin config of the selector before it is initialized
+  virtual void CustomizeSelectorConfig(trpc::naming::SelectorConfig& selector_config) {}
+
   void InitServiceNormalData() {
     polaris::FakeServer::InstancesResponse(instances_response_, service_key_);
     v1::Service* service = instances_response_.mutable_service();
@@ -165,6 +189,27 @@ class PolarisSelectTest : public polaris::MockServerConnectorTest {
     polaris::FakeServer::RoutingResponse(routing_response_, service_key_);
   }
 
+  void InitServiceHashRingData() {
+    polaris::FakeServer::InstancesResponse(instances_response_, service_key_);
+    v1::Service* service = instances_response_.mutable_service();
+    (*service->mutable_metadata())["internal-enable-nearby"] = "true";
+    // Node 1 to Node 6: Healthy Shenzhen nodes
+    for (int i = 1; i <= 6; i++) {
+      ::v1::Instance* instance = instances_response_.mutable_instances()->Add();
+      instance->mutable_namespace_()->set_value(service_key_.namespace_);
+      instance->mutable_service()->set_value(service_key_.name_);
+      instance->mutable_id()->set_value("instance_" + std::to_string(i));
+      instance->mutable_host()->set_value("host" + std::to_string(i));
+      instance->mutable_port()->set_value(8080 + i);
+      instance->mutable_healthy()->set_value(true);
+      instance->mutable_weight()->set_value(100);
+      instance->mutable_location()->mutable_region()->set_value("华南");
+      instance->mutable_location()->mutable_zone()->set_value("深圳");
+      instance->mutable_location()->mutable_campus()->set_value("深圳-蛇口");
+    }
+    polaris::FakeServer::RoutingResponse(routing_response_, service_key_);
+  }
+
   void InitServiceSetData() {
     polaris::FakeServer::InstancesResponse(instances_response_, service_key_);
     for (int i = 1; i <= 2; i++) {
@@ -268,14 +313,19 @@ class PolarisSelectTest : public polaris::MockServerConnectorTest {
     pthread_t tid;
     pthread_create(&tid, NULL, AsyncEventUpdate, event_data);
     handler_list_.push_back(handler);
+    if (data_type == polaris::kServiceDataInstances) {
+      instances_handler_ = handler;
+    }
     event_thread_list_.push_back(tid);
   }
 
  protected:
   trpc::PolarisMeshSelectorPtr selector_;
+  trpc::RefPtr<ReportRecordingSelector> recording_selector_;
   v1::DiscoverResponse instances_response_;
   v1::DiscoverResponse routing_response_;
   v1::DiscoverResponse circuit_breaker_pb_response_;
+  polaris::ServiceEventHandler* instances_handler_{nullptr};
   polaris::ServiceKey service_key_;
   std::string persist_dir_;
   std::vector<pthread_t> event_thread_list_;
@@ -357,6 +407,529 @@ TEST_F(PolarisSelectTest, SelectNormal) {
   ASSERT_EQ(0, selector_->Select(&selectInfo, &endpoint));
 }
 
+TEST_F(PolarisSelectTest, ReportByLocalId) {
+  InitServiceNormalData();
+
+  ProtocolPtr request = std::make_shared<MockProtocol>();
+  auto context = trpc::MakeRefCounted<trpc::ClientContext>();
+  context->SetRequest(request);
+  trpc::naming::polarismesh::SetSelectorExtendInfo(context, std::make_pair("namespace", service_key_.namespace_));
+  trpc::SelectorInfo selectInfo;
+  selectInfo.name = service_key_.name_;
+  selectInfo.context = context;
+  selectInfo.load_balance_name = polaris::kLoadBalanceTypeDefaultConfig;
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              RegisterEventHandler(::testing::Eq(service_key_), ::testing::_, ::testing::_, ::testing::_, ::testing::_))
+      .Times(::testing::Exactly(2))
+      .WillRepeatedly(::testing::DoAll(::testing::Invoke(this, &PolarisSelectTest::MockFireEventHandler),
+                                       ::testing::Return(polaris::kReturnOk)));
+
+  trpc::TrpcEndpointInfo endpoint;
+  ASSERT_EQ(0, selector_->Select(&selectInfo, &endpoint));
+  // The selected instance is carried by the context, and counted as in flight
+  trpc::InstanceStatsPtr stats = selector_->GetInstanceStats(endpoint.id);
+  ASSERT_TRUE(stats != nullptr);
+  ASSERT_EQ(1, stats->GetInflight());
+  ASSERT_EQ(0, stats->total_calls.load());
+
+  trpc::InvokeResult result;
+  result.name = service_key_.name_;
+  result.framework_result = trpc::TrpcRetCode::TRPC_INVOKE_SUCCESS;
+  result.interface_result = 0;
+  result.cost_time = 100;
+  result.context = context;
+  // Report by the instance id of the selection, the call is recorded to the selected instance
+  context->SetAddr(endpoint.host, endpoint.port);
+  ASSERT_EQ(0, selector_->ReportInvokeResult(&result));
+  ASSERT_EQ(0, stats->GetInflight());
+  ASSERT_EQ(1, stats->total_calls.load());
+  ASSERT_EQ(100, stats->total_delay.load());
+
+  // The selection is reported once, the report without selection falls back to host and port
+  ASSERT_EQ(0, selector_->ReportInvokeResult(&result));
+  ASSERT_EQ(1, stats->total_calls.load());
+
+  // Select again with the same context, the unreported selection is replaced and released
+  selectInfo.load_balance_name = polaris::kLoadBalanceTypeSimpleHash;
+  context->SetHashKey("1");
+  ASSERT_EQ(0, selector_->Select(&selectInfo, &endpoint));
+  context->SetHashKey("0");
+  trpc::TrpcEndpointInfo other;
+  ASSERT_EQ(0, selector_->Select(&selectInfo, &other));
+  ASSERT_NE(endpoint.id, other.id);
+  ASSERT_EQ(0, selector_->GetInstanceStats(endpoint.id)->GetInflight());
+  ASSERT_EQ(1, selector_->GetInstanceStats(other.id)->GetInflight());
+}
+
+TEST_F(PolarisSelectTest, ReportBackupRequestLoser) {
+  InitServiceNormalData();
+
+  ProtocolPtr request = std::make_shared<MockProtocol>();
+  auto context = trpc::MakeRefCounted<trpc::ClientContext>();
+  context->SetRequest(request);
+  trpc::naming::polarismesh::SetSelectorExtendInfo(context, std::make_pair("namespace", service_key_.namespace_));
+  trpc::SelectorInfo selectInfo;
+  selectInfo.name = service_key_.name_;
+  selectInfo.context = context;
+  selectInfo.policy = trpc::SelectorPolicy::MULTIPLE;
+  selectInfo.select_num = 2;
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              RegisterEventHandler(::testing::Eq(service_key_), ::testing::_, ::testing::_, ::testing::_, ::testing::_))
+      .Times(::testing::Exactly(2))
+      .WillRepeatedly(::testing::DoAll(::testing::Invoke(this, &PolarisSelectTest::MockFireEventHandler),
+                                       ::testing::Return(polaris::kReturnOk)));
+
+  // Node 1 and Node 2 are selected for the backup request, both are counted as in flight
+  std::vector<trpc::TrpcEndpointInfo> endpoints;
+  ASSERT_EQ(0, selector_->SelectBatch(&selectInfo, &endpoints));
+  ASSERT_EQ(2, endpoints.size());
+  trpc::InstanceStatsPtr loser = selector_->GetInstanceStats(endpoints[0].id);
+  trpc::InstanceStatsPtr winner = selector_->GetInstanceStats(endpoints[1].id);
+  ASSERT_TRUE(loser != nullptr && winner != nullptr);
+  ASSERT_EQ(1, loser->GetInflight());
+  ASSERT_EQ(1, winner->GetInflight());
+
+  // The backup request wins, it is recorded and the first request is released
+  trpc::InvokeResult result;
+  result.name = service_key_.name_;
+  result.framework_result = trpc::TrpcRetCode::TRPC_INVOKE_SUCCESS;
+  result.interface_result = 0;
+  result.cost_time = 50;
+  result.context = context;
+  context->SetAddr(endpoints[1].host, endpoints[1].port);
+  ASSERT_EQ(0, selector_->ReportInvokeResult(&result));
+  ASSERT_EQ(0, winner->GetInflight());
+  ASSERT_EQ(1, winner->total_calls.load());
+  ASSERT_EQ(0, loser->GetInflight());
+  ASSERT_EQ(1, recording_selector_->reports.size());
+  ASSERT_EQ(winner->instance_id, recording_selector_->reports[0].instance_id);
+
+  // The loser is canceled, it is neither reported to the SDK nor counted by the plugin
+  result.framework_result = trpc::TrpcRetCode::TRPC_CLIENT_CANCELED_ERR;
+  result.cost_time = 60;
+  context->SetAddr(endpoints[0].host, endpoints[0].port);
+  ASSERT_EQ(0, selector_->ReportInvokeResult(&result));
+  ASSERT_EQ(1, recording_selector_->reports.size());
+  ASSERT_EQ(0, loser->GetInflight());
+  ASSERT_EQ(0, loser->total_calls.load());
+  ASSERT_EQ(0, selector_->ReportInvokeResult(&result));
+  ASSERT_EQ(1, recording_selector_->reports.size());
+
+  // A canceled request which is still in flight only releases its in-flight request
+  endpoints.clear();
+  ASSERT_EQ(0, selector_->SelectBatch(&selectInfo, &endpoints));
+  ASSERT_EQ(2, endpoints.size());
+  trpc::InstanceStatsPtr canceled = selector_->GetInstanceStats(endpoints[0].id);
+  ASSERT_EQ(1, canceled->GetInflight());
+  context->SetAddr(endpoints[0].host, endpoints[0].port);
+  ASSERT_EQ(0, selector_->ReportInvokeResult(&result));
+  ASSERT_EQ(0, canceled->GetInflight());
+  ASSERT_EQ(1, recording_selector_->reports.size());
+}
+
+TEST_F(PolarisSelectTest, SelectReplicas) {
+  InitServiceHashRingData();
+
+  ProtocolPtr request = std::make_shared<MockProtocol>();
+  auto context = trpc::MakeRefCounted<trpc::ClientContext>();
+  context->SetRequest(request);
+  trpc::naming::polarismesh::SetSelectorExtendInfo(context, std::make_pair("namespace", service_key_.namespace_));
+  trpc::SelectorInfo selectInfo;
+  selectInfo.name = service_key_.name_;
+  selectInfo.context = context;
+  selectInfo.load_balance_name = polaris::kLoadBalanceTypeRingHash;
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              RegisterEventHandler(::testing::Eq(service_key_), ::testing::_, ::testing::_, ::testing::_, ::testing::_))
+      .Times(::testing::Exactly(2))
+      .WillRepeatedly(::testing::DoAll(::testing::Invoke(this, &PolarisSelectTest::MockFireEventHandler),
+                                       ::testing::Return(polaris::kReturnOk)));
+
+  // The hash key is required
+  std::vector<trpc::TrpcEndpointInfo> replicas;
+  ASSERT_EQ(-1, selector_->SelectReplicas(&selectInfo, 2, &replicas));
+
+  context->SetHashKey("abc");
+  ASSERT_EQ(-1, selector_->SelectReplicas(&selectInfo, 0, &replicas));
+  // Node 1 to Node 6 are the healthy nodes nearby, the replicas are distinct
+  constexpr uint32_t kReplicaNum = 5;
+  ASSERT_EQ(0, selector_->SelectReplicas(&selectInfo, kReplicaNum, &replicas));
+  ASSERT_EQ(kReplicaNum, replicas.size());
+  for (uint32_t i = 0; i < kReplicaNum; ++i) {
+    for (uint32_t j = i + 1; j < kReplicaNum; ++j) {
+      ASSERT_NE(replicas[i].host, replicas[j].host);
+    }
+  }
+
+  // Each replica is the one selected by the hash key with the same replicate index
+  for (uint32_t i = 0; i < kReplicaNum; ++i) {
+    auto replica_context = trpc::MakeRefCounted<trpc::ClientContext>();
+    replica_context->SetRequest(request);
+    replica_context->SetHashKey("abc");
+    trpc::naming::polarismesh::SetSelectorExtendInfo(replica_context,
+                                                     std::make_pair("namespace", service_key_.namespace_),
+                                                     std::make_pair("replicate_index", std::to_string(i)));
+    selectInfo.context = replica_context;
+    trpc::TrpcEndpointInfo endpoint;
+    ASSERT_EQ(0, selector_->Select(&selectInfo, &endpoint));
+    ASSERT_EQ(endpoint.host, replicas[i].host);
+    ASSERT_EQ(endpoint.port, replicas[i].port);
+  }
+}
+
+TEST_F(PolarisSelectTest, SelectByP2C) {
+  InitServiceNormalData();
+
+  ProtocolPtr request = std::make_shared<MockProtocol>();
+  auto context = trpc::MakeRefCounted<trpc::ClientContext>();
+  context->SetRequest(request);
+  trpc::naming::polarismesh::SetSelectorExtendInfo(context, std::make_pair("namespace", service_key_.namespace_));
+  trpc::SelectorInfo selectInfo;
+  selectInfo.name = service_key_.name_;
+  selectInfo.context = context;
+  selectInfo.load_balance_name = trpc::kLoadBalanceTypeP2C;
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              RegisterEventHandler(::testing::Eq(service_key_), ::testing::_, ::testing::_, ::testing::_, ::testing::_))
+      .Times(::testing::Exactly(2))
+      .WillRepeatedly(::testing::DoAll(::testing::Invoke(this, &PolarisSelectTest::MockFireEventHandler),
+                                       ::testing::Return(polaris::kReturnOk)));
+
+  // Node 1 and Node 2 are the healthy nodes nearby, the one with less in-flight requests is selected
+  trpc::TrpcEndpointInfo first;
+  ASSERT_EQ(0, selector_->Select(&selectInfo, &first));
+  ASSERT_TRUE(first.host == "host1" || first.host == "host2");
+
+  auto other_context = trpc::MakeRefCounted<trpc::ClientContext>();
+  other_context->SetRequest(request);
+  trpc::naming::polarismesh::SetSelectorExtendInfo(other_context,
+                                                   std::make_pair("namespace", service_key_.namespace_));
+  selectInfo.context = other_context;
+  trpc::TrpcEndpointInfo second;
+  ASSERT_EQ(0, selector_->Select(&selectInfo, &second));
+  ASSERT_NE(first.host, second.host);
+}
+
+TEST_F(PolarisSelectTest, RetryExcludesFailedInstance) {
+  InitServiceNormalData();
+
+  ProtocolPtr request = std::make_shared<MockProtocol>();
+  auto context = trpc::MakeRefCounted<trpc::ClientContext>();
+  context->SetRequest(request);
+  trpc::naming::polarismesh::SetSelectorExtendInfo(context, std::make_pair("namespace", service_key_.namespace_));
+  trpc::SelectorInfo selectInfo;
+  selectInfo.name = service_key_.name_;
+  selectInfo.context = context;
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              RegisterEventHandler(::testing::Eq(service_key_), ::testing::_, ::testing::_, ::testing::_, ::testing::_))
+      .Times(::testing::Exactly(2))
+      .WillRepeatedly(::testing::DoAll(::testing::Invoke(this, &PolarisSelectTest::MockFireEventHandler),
+                                       ::testing::Return(polaris::kReturnOk)));
+
+  // Node 1 and Node 2 are the healthy nodes nearby
+  trpc::TrpcEndpointInfo first;
+  ASSERT_EQ(0, selector_->Select(&selectInfo, &first));
+
+  trpc::InvokeResult result;
+  result.name = service_key_.name_;
+  result.framework_result = trpc::TrpcRetCode::TRPC_CLIENT_CONNECT_ERR;
+  result.interface_result = 0;
+  result.cost_time = 100;
+  result.context = context;
+  context->SetAddr(first.host, first.port);
+  ASSERT_EQ(0, selector_->ReportInvokeResult(&result));
+  ASSERT_EQ(1, selector_->GetInstanceStats(first.id)->failed_calls.load());
+
+  // The retry goes to the other node
+  for (int i = 0; i < 10; ++i) {
+    trpc::TrpcEndpointInfo retry;
+    ASSERT_EQ(0, selector_->Select(&selectInfo, &retry));
+    ASSERT_NE(first.host, retry.host);
+    context->SetAddr(retry.host, retry.port);
+    result.framework_result = trpc::TrpcRetCode::TRPC_INVOKE_SUCCESS;
+    ASSERT_EQ(0, selector_->ReportInvokeResult(&result));
+  }
+
+  // The previous selection which is never reported is skipped by the retry too
+  auto other_context = trpc::MakeRefCounted<trpc::ClientContext>();
+  other_context->SetRequest(request);
+  trpc::naming::polarismesh::SetSelectorExtendInfo(other_context,
+                                                   std::make_pair("namespace", service_key_.namespace_));
+  selectInfo.context = other_context;
+  trpc::TrpcEndpointInfo unreported;
+  ASSERT_EQ(0, selector_->Select(&selectInfo, &unreported));
+  trpc::TrpcEndpointInfo retry;
+  ASSERT_EQ(0, selector_->Select(&selectInfo, &retry));
+  ASSERT_NE(unreported.host, retry.host);
+
+  // All the routed nodes are excluded, one of them is still selected
+  auto excluded_context = trpc::MakeRefCounted<trpc::ClientContext>();
+  excluded_context->SetRequest(request);
+  trpc::naming::polarismesh::SetSelectorExtendInfo(
+      excluded_context, std::make_pair("namespace", service_key_.namespace_),
+      std::make_pair("excluded_instances", std::to_string(unreported.id) + "," + std::to_string(retry.id)));
+  selectInfo.context = excluded_context;
+  trpc::TrpcEndpointInfo endpoint;
+  ASSERT_EQ(0, selector_->Select(&selectInfo, &endpoint));
+  ASSERT_TRUE(endpoint.host == "host1" || endpoint.host == "host2");
+}
+
+class PolarisSelectStrictNearbyTest : public PolarisSelectTest {
+ protected:
+  void CustomizeSelectorConfig(trpc::naming::SelectorConfig& selector_config) override {
+    selector_config.spillover_config.enable = true;
+    selector_config.consumer_config.service_router_config.router_plugin_config.nearby_based_router_config
+        .strict_nearby = true;
+  }
+};
+
+TEST_F(PolarisSelectStrictNearbyTest, DisableSpillover) {
+  ASSERT_FALSE(selector_->GetPluginConfig().selector_config.spillover_config.enable);
+}
+
+class PolarisSelectConcurrencyLimitTest : public PolarisSelectTest {
+ protected:
+  void CustomizeSelectorConfig(trpc::naming::SelectorConfig& selector_config) override {
+    selector_config.concurrency_limit_config.enable = true;
+    selector_config.concurrency_limit_config.initial_limit = 1;
+  }
+};
+
+TEST_F(PolarisSelectConcurrencyLimitTest, SkipLimitedInConfiguredLoadBalancer) {
+  InitServiceNormalData();
+
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              RegisterEventHandler(::testing::Eq(service_key_), ::testing::_, ::testing::_, ::testing::_, ::testing::_))
+      .Times(::testing::Exactly(2))
+      .WillRepeatedly(::testing::DoAll(::testing::Invoke(this, &PolarisSelectTest::MockFireEventHandler),
+                                       ::testing::Return(polaris::kReturnOk)));
+  auto select = [&](const std::string& load_balance_name, trpc::TrpcEndpointInfo* endpoint) {
+    ProtocolPtr request = std::make_shared<MockProtocol>();
+    auto context = trpc::MakeRefCounted<trpc::ClientContext>();
+    context->SetRequest(request);
+    trpc::naming::polarismesh::SetSelectorExtendInfo(context, std::make_pair("namespace", service_key_.namespace_));
+    trpc::SelectorInfo selectInfo;
+    selectInfo.name = service_key_.name_;
+    selectInfo.context = context;
+    selectInfo.load_balance_name = load_balance_name;
+    return selector_->Select(&selectInfo, endpoint);
+  };
+
+  // The weighted random skips the instance at its limit
+  trpc::TrpcEndpointInfo first;
+  trpc::TrpcEndpointInfo second;
+  ASSERT_EQ(0, select(polaris::kLoadBalanceTypeDefaultConfig, &first));
+  ASSERT_EQ(0, select(polaris::kLoadBalanceTypeDefaultConfig, &second));
+  ASSERT_NE(first.id, second.id);
+
+  // Another load balancer of the SDK is not replaced by the weighted random of the plugin
+  trpc::TrpcEndpointInfo endpoint;
+  ASSERT_EQ(0, select(polaris::kLoadBalanceTypeRingHash, &endpoint));
+  trpc::InstanceStatsPtr stats = selector_->GetInstanceStats(endpoint.id);
+  ASSERT_TRUE(stats != nullptr);
+  uint64_t inflight = stats->GetInflight();
+  ASSERT_EQ(0, select(polaris::kLoadBalanceTypeRingHash, &endpoint));
+  ASSERT_EQ(stats->local_id, selector_->GetInstanceStats(endpoint.id)->local_id);
+  ASSERT_EQ(inflight + 1, stats->GetInflight());
+}
+
+class PolarisSelectAdaptiveTimeoutTest : public PolarisSelectTest {
+ protected:
+  void CustomizeSelectorConfig(trpc::naming::SelectorConfig& selector_config) override {
+    selector_config.adaptive_timeout_config.enable = true;
+    selector_config.adaptive_timeout_config.factor = 100;
+    selector_config.adaptive_timeout_config.min_samples = 1;
+  }
+};
+
+TEST_F(PolarisSelectAdaptiveTimeoutTest, RecordInvokeTimeoutOnly) {
+  ProtocolPtr request = std::make_shared<MockProtocol>();
+  auto context = trpc::MakeRefCounted<trpc::ClientContext>();
+  context->SetRequest(request);
+  context->SetFuncName("/trpc.test.helloworld.Greeter/SayHello");
+  context->SetTimeout(1000);
+  context->SetAddr("127.0.0.1", 10001);
+  trpc::naming::polarismesh::SetSelectorExtendInfo(context, std::make_pair("namespace", service_key_.namespace_));
+  trpc::InvokeResult result;
+  result.name = service_key_.name_;
+  result.interface_result = 0;
+  result.cost_time = 20;
+  result.context = context;
+
+  // The full-link timeout is cut by the caller, it is not observed
+  result.framework_result = trpc::TrpcRetCode::TRPC_CLIENT_FULL_LINK_TIMEOUT_ERR;
+  selector_->ReportInvokeResult(&result);
+  ASSERT_EQ(0, selector_->GetRecommendedTimeout(service_key_.namespace_, service_key_.name_,
+                                                "/trpc.test.helloworld.Greeter/SayHello"));
+
+  // The timed out call is observed at its timeout
+  result.framework_result = trpc::TrpcRetCode::TRPC_CLIENT_INVOKE_TIMEOUT_ERR;
+  selector_->ReportInvokeResult(&result);
+  ASSERT_GE(selector_->GetRecommendedTimeout(service_key_.namespace_, service_key_.name_,
+                                             "/trpc.test.helloworld.Greeter/SayHello"),
+            1000);
+}
+
+class PolarisSelectRetryBudgetTest : public PolarisSelectTest {
+ protected:
+  void CustomizeSelectorConfig(trpc::naming::SelectorConfig& selector_config) override {
+    // A single token, which is not earned back by the successful calls
+    selector_config.retry_budget_config.enable = true;
+    selector_config.retry_budget_config.ratio = 0;
+    selector_config.retry_budget_config.max_tokens = 1;
+  }
+};
+
+TEST_F(PolarisSelectRetryBudgetTest, RejectRetryOverBudget) {
+  InitServiceNormalData();
+
+  ProtocolPtr request = std::make_shared<MockProtocol>();
+  auto context = trpc::MakeRefCounted<trpc::ClientContext>();
+  context->SetRequest(request);
+  trpc::naming::polarismesh::SetSelectorExtendInfo(context, std::make_pair("namespace", service_key_.namespace_));
+  trpc::SelectorInfo selectInfo;
+  selectInfo.name = service_key_.name_;
+  selectInfo.context = context;
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              RegisterEventHandler(::testing::Eq(service_key_), ::testing::_, ::testing::_, ::testing::_, ::testing::_))
+      .Times(::testing::Exactly(2))
+      .WillRepeatedly(::testing::DoAll(::testing::Invoke(this, &PolarisSelectTest::MockFireEventHandler),
+                                       ::testing::Return(polaris::kReturnOk)));
+
+  trpc::TrpcEndpointInfo first;
+  ASSERT_EQ(0, selector_->Select(&selectInfo, &first));
+  trpc::InvokeResult result;
+  result.name = service_key_.name_;
+  result.framework_result = trpc::TrpcRetCode::TRPC_CLIENT_CONNECT_ERR;
+  result.interface_result = 0;
+  result.cost_time = 100;
+  result.context = context;
+  context->SetAddr(first.host, first.port);
+  ASSERT_EQ(0, selector_->ReportInvokeResult(&result));
+
+  // The instances excluded by the user do not make a retry
+  auto excluded_context = trpc::MakeRefCounted<trpc::ClientContext>();
+  excluded_context->SetRequest(request);
+  trpc::naming::polarismesh::SetSelectorExtendInfo(excluded_context,
+                                                   std::make_pair("namespace", service_key_.namespace_),
+                                                   std::make_pair("excluded_instances", std::to_string(first.id)));
+  selectInfo.context = excluded_context;
+  trpc::TrpcEndpointInfo endpoint;
+  ASSERT_EQ(0, selector_->Select(&selectInfo, &endpoint));
+  ASSERT_NE(first.host, endpoint.host);
+  RetryBudgetState state = selector_->GetRetryBudgetState(service_key_.namespace_, service_key_.name_);
+  ASSERT_DOUBLE_EQ(1, state.tokens);
+  ASSERT_EQ(0, state.retries);
+
+  // The retry after the failure takes the token
+  selectInfo.context = context;
+  trpc::TrpcEndpointInfo retry;
+  ASSERT_EQ(0, selector_->Select(&selectInfo, &retry));
+  ASSERT_NE(first.host, retry.host);
+  context->SetAddr(retry.host, retry.port);
+  ASSERT_EQ(0, selector_->ReportInvokeResult(&result));
+  state = selector_->GetRetryBudgetState(service_key_.namespace_, service_key_.name_);
+  ASSERT_DOUBLE_EQ(0, state.tokens);
+  ASSERT_EQ(1, state.retries);
+
+  // The budget is spent, the next retry is rejected locally
+  ASSERT_EQ(-1, selector_->Select(&selectInfo, &endpoint));
+  ASSERT_EQ(trpc::TrpcRetCode::TRPC_CLIENT_LIMITED_ERR, context->GetStatus().GetFrameworkRetCode());
+  state = selector_->GetRetryBudgetState(service_key_.namespace_, service_key_.name_);
+  ASSERT_EQ(1, state.rejected);
+}
+
+TEST_F(PolarisSelectTest, Subscribe) {
+  InitServiceNormalData();
+  instances_response_.mutable_service()->mutable_revision()->set_value("revision_1");
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              RegisterEventHandler(::testing::Eq(service_key_), ::testing::_, ::testing::_, ::testing::_, ::testing::_))
+      .Times(::testing::AtLeast(1))
+      .WillRepeatedly(::testing::DoAll(::testing::Invoke(this, &PolarisSelectTest::MockFireEventHandler),
+                                       ::testing::Return(polaris::kReturnOk)));
+
+  std::vector<trpc::InstanceDelta> deltas;
+  uint64_t id = selector_->Subscribe(service_key_.name_, service_key_.namespace_,
+                                     [&deltas](const trpc::InstanceDelta& delta) { deltas.push_back(delta); });
+  ASSERT_NE(0, id);
+  // The first delta contains all the available instances: remove the isolated node and the node with weight 0
+  ASSERT_EQ(1, deltas.size());
+  ASSERT_EQ(4, deltas[0].added.size());
+
+  // Unchanged revision, no delta
+  selector_->CheckSubscriptions();
+  ASSERT_EQ(1, deltas.size());
+
+  // Remove node 1, change the weight of node 2
+  instances_response_.mutable_service()->mutable_revision()->set_value("revision_2");
+  instances_response_.mutable_instances()->DeleteSubrange(0, 1);
+  instances_response_.mutable_instances(0)->mutable_weight()->set_value(50);
+  ASSERT_TRUE(instances_handler_ != nullptr);
+  instances_handler_->OnEventUpdate(service_key_, polaris::kServiceDataInstances,
+                                    polaris::ServiceData::CreateFromPb(&instances_response_, polaris::kDataIsSyncing));
+  selector_->CheckSubscriptions();
+  ASSERT_EQ(2, deltas.size());
+  ASSERT_EQ("revision_2", deltas[1].revision);
+  ASSERT_TRUE(deltas[1].added.empty());
+  ASSERT_EQ(1, deltas[1].removed.size());
+  ASSERT_EQ("host1", deltas[1].removed[0].host);
+  ASSERT_EQ(1, deltas[1].modified.size());
+  ASSERT_EQ(50, deltas[1].modified[0].weight);
+
+  ASSERT_TRUE(selector_->Unsubscribe(id));
+  ASSERT_FALSE(selector_->Unsubscribe(id));
+}
+
+class PolarisSelectSubsetTest : public PolarisSelectTest {
+ protected:
+  void CustomizeSelectorConfig(trpc::naming::SelectorConfig& selector_config) override {
+    selector_config.subset_config.enable = true;
+    selector_config.subset_config.subset_size = 3;
+    selector_config.subset_config.client_id = "0";
+  }
+};
+
+TEST_F(PolarisSelectSubsetTest, SameSubsetForAllCallers) {
+  InitServiceHashRingData();
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              RegisterEventHandler(::testing::Eq(service_key_), ::testing::_, ::testing::_, ::testing::_, ::testing::_))
+      .Times(::testing::AtLeast(1))
+      .WillRepeatedly(::testing::DoAll(::testing::Invoke(this, &PolarisSelectTest::MockFireEventHandler),
+                                       ::testing::Return(polaris::kReturnOk)));
+
+  // The subscribers only see the subset
+  std::vector<trpc::InstanceDelta> deltas;
+  uint64_t id = selector_->Subscribe(service_key_.name_, service_key_.namespace_,
+                                     [&deltas](const trpc::InstanceDelta& delta) { deltas.push_back(delta); });
+  ASSERT_NE(0, id);
+  ASSERT_EQ(1, deltas.size());
+  ASSERT_EQ(3, deltas[0].added.size());
+  std::set<std::string> subset_hosts;
+  for (const auto& endpoint : deltas[0].added) {
+    subset_hosts.insert(endpoint.host);
+  }
+  ASSERT_EQ(3, subset_hosts.size());
+
+  auto context = trpc::MakeRefCounted<trpc::ClientContext>();
+  context->SetRequest(std::make_shared<MockProtocol>());
+  trpc::naming::polarismesh::SetSelectorExtendInfo(context, std::make_pair("namespace", service_key_.namespace_));
+  trpc::SelectorInfo select_info;
+  select_info.name = service_key_.name_;
+  select_info.context = context;
+
+  // The calls of the ALL policy and of the routed policies alternate, and all of them get the same subset
+  std::vector<trpc::SelectorPolicy> policies = {trpc::SelectorPolicy::ALL, trpc::SelectorPolicy::IDC,
+                                                trpc::SelectorPolicy::ALL};
+  for (auto policy : policies) {
+    select_info.policy = policy;
+    std::vector<trpc::TrpcEndpointInfo> endpoints;
+    ASSERT_EQ(0, selector_->SelectBatch(&select_info, &endpoints));
+    ASSERT_EQ(3, endpoints.size());
+    for (const auto& endpoint : endpoints) {
+      ASSERT_EQ(1, subset_hosts.count(endpoint.host));
+    }
+  }
+  ASSERT_TRUE(selector_->Unsubscribe(id));
+}
+
 TEST_F(PolarisSelectTest, SelectAllNormal) {
   InitServiceNormalData();
 
@@ -432,6 +1005,51 @@ TEST_F(PolarisSelectTest, SelectBatchNormal) {
   ASSERT_EQ(3, include_unhealthy_endpoints.size());  // Node 1, node 2 and node 4
 }
 
+TEST_F(PolarisSelectTest, SelectBatchIfModified) {
+  InitServiceNormalData();
+  instances_response_.mutable_service()->mutable_revision()->set_value("revision_1");
+
+  ProtocolPtr request = std::make_shared<MockProtocol>();
+  auto context = trpc::MakeRefCounted<trpc::ClientContext>();
+  context->SetRequest(request);
+  trpc::naming::polarismesh::SetSelectorExtendInfo(context, std::make_pair("namespace", service_key_.namespace_));
+  trpc::SelectorInfo selectInfo;
+  selectInfo.name = service_key_.name_;
+  selectInfo.context = context;
+  selectInfo.policy = trpc::SelectorPolicy::ALL;
+
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              RegisterEventHandler(::testing::Eq(service_key_), ::testing::_, ::testing::_, ::testing::_, ::testing::_))
+      .Times(1)
+      .WillRepeatedly(::testing::DoAll(::testing::Invoke(this, &PolarisSelectTest::MockFireEventHandler),
+                                       ::testing::Return(polaris::kReturnOk)));
+
+  std::string revision;
+  trpc::EndpointsSnapshot endpoints;
+  ASSERT_EQ(0, selector_->SelectBatchIfModified(&selectInfo, "", &revision, &endpoints));
+  ASSERT_FALSE(revision.empty());
+  ASSERT_TRUE(endpoints != nullptr);
+  ASSERT_EQ(4, endpoints->size());
+
+  // Unchanged
+  std::string new_revision;
+  trpc::EndpointsSnapshot new_endpoints;
+  ASSERT_EQ(trpc::PolarisMeshSelector::kSelectNotModified,
+            selector_->SelectBatchIfModified(&selectInfo, revision, &new_revision, &new_endpoints));
+  ASSERT_TRUE(new_revision.empty());
+  ASSERT_TRUE(new_endpoints == nullptr);
+
+  // Change the weight of node 1
+  instances_response_.mutable_service()->mutable_revision()->set_value("revision_2");
+  instances_response_.mutable_instances(0)->mutable_weight()->set_value(50);
+  ASSERT_TRUE(instances_handler_ != nullptr);
+  instances_handler_->OnEventUpdate(service_key_, polaris::kServiceDataInstances,
+                                    polaris::ServiceData::CreateFromPb(&instances_response_, polaris::kDataIsSyncing));
+  ASSERT_EQ(0, selector_->SelectBatchIfModified(&selectInfo, revision, &new_revision, &new_endpoints));
+  ASSERT_NE(revision, new_revision);
+  ASSERT_EQ(4, new_endpoints->size());
+}
+
 TEST_F(PolarisSelectTest, SelectSet) {
   InitServiceSetData();
 
@@ -466,6 +1084,46 @@ TEST_F(PolarisSelectTest, SelectSet) {
   ASSERT_EQ("host1", endpoints[0].host);
 }
 
+class PolarisSelectFlapDampingTest : public PolarisSelectTest {
+ protected:
+  void CustomizeSelectorConfig(trpc::naming::SelectorConfig& selector_config) override {
+    selector_config.flap_damping_config.enable = true;
+  }
+};
+
+TEST_F(PolarisSelectFlapDampingTest, DampPerRoutingResult) {
+  InitServiceSetData();
+
+  EXPECT_CALL(*polaris::MockServerConnectorTest::server_connector_,
+              RegisterEventHandler(::testing::Eq(service_key_), ::testing::_, ::testing::_, ::testing::_, ::testing::_))
+      .Times(::testing::Exactly(2))
+      .WillRepeatedly(::testing::DoAll(::testing::Invoke(this, &PolarisSelectTest::MockFireEventHandler),
+                                       ::testing::Return(polaris::kReturnOk)));
+
+  // Two callers of the same service are routed to disjoint sets
+  std::vector<std::string> set_names = {"app.sz.1", "app.sz.2"};
+  std::vector<std::string> hosts = {"host1", "host2"};
+  for (int round = 0; round < 2; ++round) {
+    for (std::size_t i = 0; i < set_names.size(); ++i) {
+      auto context = trpc::MakeRefCounted<trpc::ClientContext>();
+      context->SetRequest(std::make_shared<MockProtocol>());
+      trpc::naming::polarismesh::SetSelectorExtendInfo(context, std::make_pair("namespace", service_key_.namespace_),
+                                                       std::make_pair("callee_set_name", set_names[i]),
+                                                       std::make_pair("enable_set_force", "true"));
+      trpc::SelectorInfo select_info;
+      select_info.name = service_key_.name_;
+      select_info.context = context;
+      select_info.policy = trpc::SelectorPolicy::SET;
+
+      // Each caller is damped on its own routing result, the instances of the other set are never held for it
+      std::vector<trpc::TrpcEndpointInfo> endpoints;
+      ASSERT_EQ(0, selector_->SelectBatch(&select_info, &endpoints));
+      ASSERT_EQ(1, endpoints.size());
+      ASSERT_EQ(hosts[i], endpoints[0].host);
+    }
+  }
+}
+
 TEST_F(PolarisSelectTest, SelectCanary) {
   InitServiceCanaryData();
   // You must initialize the request before you can be selected
@@ -555,6 +1213,24 @@ TEST_F(PolarisSelectTest, ReportInvokeResult) {
   // ASSERT_EQ(0, selector_->ReportInvokeResult(&result));
 }
 
+TEST_F(PolarisSelectTest, ReportCanceledInvokeResult) {
+  ProtocolPtr request = std::make_shared<MockProtocol>();
+  auto context = trpc::MakeRefCounted<trpc::ClientContext>();
+  context->SetRequest(request);
+  trpc::naming::polarismesh::SetSelectorExtendInfo(context, std::make_pair("namespace", service_key_.namespace_));
+  context->SetAddr("127.0.0.1", 10001);
+
+  // A canceled request is never reported to the SDK
+  trpc::InvokeResult result;
+  result.name = service_key_.name_;
+  result.framework_result = trpc::TrpcRetCode::TRPC_CLIENT_CANCELED_ERR;
+  result.interface_result = 0;
+  result.cost_time = 100;
+  result.context = context;
+  ASSERT_EQ(0, selector_->ReportInvokeResult(&result));
+  ASSERT_TRUE(recording_selector_->reports.empty());
+}
+
 }  // namespace trpc
 
 class PolarisTestEnvironment : public testing::Environment {
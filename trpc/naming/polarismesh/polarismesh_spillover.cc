@@ -0,0 +1,48 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_spillover.h"
+
+#include <algorithm>
+#include <random>
+
+namespace trpc {
+
+uint32_t CalculateSpilloverRatio(const naming::SpilloverConfig& config, uint64_t local_inflight, std::size_t local_num,
+                                 uint64_t remote_inflight, std::size_t remote_num) {
+  if (local_num == 0 || remote_num == 0) {
+    return 0;
+  }
+
+  double local_load = static_cast<double>(local_inflight) / local_num;
+  double remote_load = static_cast<double>(remote_inflight) / remote_num;
+  // The local zone is preferred while it is lightly loaded or not much more loaded than the other zones
+  if (local_load < config.min_inflight || local_load * 100 <= remote_load * (100 + config.tolerance)) {
+    return 0;
+  }
+
+  // The load per instance if the in-flight requests were spread evenly over all the instances
+  double even_load = static_cast<double>(local_inflight + remote_inflight) / (local_num + remote_num);
+  double ratio = (local_load - even_load) * 100 / local_load;
+  return std::min(static_cast<uint32_t>(ratio), config.max_ratio);
+}
+
+bool HitSpilloverRatio(uint32_t ratio) {
+  if (ratio == 0) {
+    return false;
+  }
+  thread_local std::mt19937 engine(std::random_device{}());
+  return std::uniform_int_distribution<uint32_t>(0, 99)(engine) < ratio;
+}
+
+}  // namespace trpc
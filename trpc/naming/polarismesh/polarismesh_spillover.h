@@ -0,0 +1,36 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "trpc/naming/polarismesh/config/polarismesh_naming_conf.h"
+
+namespace trpc {
+
+/// @brief Get the ratio of the requests spilled over from the local zone to the other zones, which moves just enough
+///        requests to even the in-flight requests per instance of the zones
+/// @param local_inflight The in-flight requests of the local instances
+/// @param local_num The number of the local instances
+/// @param remote_inflight The in-flight requests of the instances in the other zones
+/// @param remote_num The number of the instances in the other zones
+/// @return The spillover ratio, range: [0, max_ratio], unit: percent
+uint32_t CalculateSpilloverRatio(const naming::SpilloverConfig& config, uint64_t local_inflight, std::size_t local_num,
+                                 uint64_t remote_inflight, std::size_t remote_num);
+
+/// @brief Decide whether a request is spilled over by the spillover ratio
+bool HitSpilloverRatio(uint32_t ratio);
+
+}  // namespace trpc
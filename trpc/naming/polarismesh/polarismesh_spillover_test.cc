@@ -0,0 +1,44 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_spillover.h"
+
+#include "gtest/gtest.h"
+
+namespace trpc {
+
+TEST(SpilloverTest, CalculateSpilloverRatio) {
+  naming::SpilloverConfig config;
+  config.enable = true;
+  config.tolerance = 20;
+  config.min_inflight = 2;
+  config.max_ratio = 50;
+
+  // No instance in the other zones
+  ASSERT_EQ(0, CalculateSpilloverRatio(config, 100, 2, 0, 0));
+  // Lightly loaded
+  ASSERT_EQ(0, CalculateSpilloverRatio(config, 2, 2, 0, 2));
+  // Within the tolerance
+  ASSERT_EQ(0, CalculateSpilloverRatio(config, 12, 2, 10, 2));
+  // The even load is 5, so that 1 / 6 of the local requests are spilled over
+  ASSERT_EQ(16, CalculateSpilloverRatio(config, 12, 2, 8, 2));
+  // Limited by the max ratio
+  ASSERT_EQ(50, CalculateSpilloverRatio(config, 100, 1, 0, 10));
+}
+
+TEST(SpilloverTest, HitSpilloverRatio) {
+  ASSERT_FALSE(HitSpilloverRatio(0));
+  ASSERT_TRUE(HitSpilloverRatio(100));
+}
+
+}  // namespace trpc
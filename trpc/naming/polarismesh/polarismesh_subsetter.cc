@@ -0,0 +1,121 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_subsetter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <utility>
+
+namespace trpc {
+
+std::vector<std::size_t> SelectSubset(std::size_t backend_count, std::size_t subset_size, uint64_t client_id) {
+  std::vector<std::size_t> order(backend_count);
+  std::iota(order.begin(), order.end(), 0);
+  if (subset_size == 0 || backend_count <= subset_size) {
+    return order;
+  }
+
+  std::size_t subset_count = backend_count / subset_size;
+  uint64_t round = client_id / subset_count;
+  // All the clients of a round shuffle the backends in the same order. The shuffle is implemented here instead of
+  // std::shuffle, whose algorithm is implementation-defined, so that clients built by different toolchains agree
+  std::mt19937_64 engine(round);
+  for (std::size_t i = backend_count - 1; i > 0; --i) {
+    std::swap(order[i], order[engine() % (i + 1)]);
+  }
+
+  std::size_t start = (client_id % subset_count) * subset_size;
+  std::vector<std::size_t> subset(order.begin() + start, order.begin() + start + subset_size);
+  std::sort(subset.begin(), subset.end());
+  return subset;
+}
+
+uint64_t MakeSubsetClientId(const std::string& identity) {
+  // A numeric identity (e.g. the ordinal of the client) is used as is, sequential ids balance the subsets exactly
+  bool numeric = !identity.empty() && identity.size() < 20 &&
+                 std::all_of(identity.begin(), identity.end(), [](unsigned char c) { return std::isdigit(c) != 0; });
+  if (numeric) {
+    return std::stoull(identity);
+  }
+
+  // FNV-1a, which is stable across platforms
+  uint64_t hash = 14695981039346656037ULL;
+  for (unsigned char c : identity) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+void Subsetter::SetConfig(const naming::SubsetConfig& config, uint64_t client_id) {
+  config_ = config;
+  client_id_ = client_id;
+}
+
+InstanceSubsetPtr Subsetter::GetSubset(const polaris::ServiceKey& service_key, const std::string& revision) const {
+  std::shared_lock<std::shared_mutex> lock(mutex_);
+  auto it = services_.find(service_key);
+  if (it == services_.end() || it->second.revision != revision) {
+    return nullptr;
+  }
+  return it->second.subset;
+}
+
+InstanceSubsetPtr Subsetter::UpdateSubset(const polaris::ServiceKey& service_key, const std::string& revision,
+                                          const std::vector<polaris::Instance>& instances) {
+  std::vector<std::string> members;
+  members.reserve(instances.size());
+  for (const auto& instance : instances) {
+    // Isolated instances or instances with weight 0 are not members
+    if (!instance.isIsolate() && instance.GetWeight() > 0) {
+      members.push_back(instance.GetId());
+    }
+  }
+  std::sort(members.begin(), members.end());
+
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  ServiceState& state = services_[service_key];
+  if (state.subset != nullptr && state.revision == revision) {
+    return state.subset;
+  }
+
+  if (state.subset == nullptr || state.members != members) {
+    state.subset_ids.clear();
+    for (std::size_t index : SelectSubset(members.size(), config_.subset_size, client_id_)) {
+      state.subset_ids.insert(members[index]);
+    }
+    state.members = std::move(members);
+  }
+
+  // The local ids are different between revisions
+  auto subset = std::make_shared<InstanceSubset>();
+  for (const auto& instance : instances) {
+    if (state.subset_ids.find(instance.GetId()) != state.subset_ids.end()) {
+      subset->local_ids.insert(instance.GetLocalId());
+    }
+  }
+  state.revision = revision;
+  state.subset = std::move(subset);
+  return state.subset;
+}
+
+void Subsetter::Clear() {
+  std::unique_lock<std::shared_mutex> lock(mutex_);
+  services_.clear();
+}
+
+}  // namespace trpc
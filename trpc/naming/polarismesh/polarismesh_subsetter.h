@@ -0,0 +1,91 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "polaris/model.h"
+
+#include "trpc/naming/polarismesh/config/polarismesh_naming_conf.h"
+
+namespace trpc {
+
+/// @brief Pick the subset of the client by deterministic subsetting: the clients are divided into rounds, the backends
+///        are shuffled by the round, and each client of the round takes a distinct slice of the shuffled backends, so
+///        that the connections are balanced across the clients
+/// @param backend_count The number of the backends, which are sorted in the same order by all clients
+/// @param subset_size The size of the subset
+/// @param client_id The id of the client
+/// @return The indexes of the backends in the subset
+std::vector<std::size_t> SelectSubset(std::size_t backend_count, std::size_t subset_size, uint64_t client_id);
+
+/// @brief Make the client id of the subsetting from the identity of the client
+uint64_t MakeSubsetClientId(const std::string& identity);
+
+/// @brief The subset of a service for a revision of the instances
+struct InstanceSubset {
+  /// The local ids of the instances in the subset
+  std::unordered_set<uint64_t> local_ids;
+
+  bool Contains(uint64_t local_id) const { return local_ids.find(local_id) != local_ids.end(); }
+};
+
+using InstanceSubsetPtr = std::shared_ptr<const InstanceSubset>;
+
+/// @brief Keeps the subset of the callee services
+/// @note The subset is recomputed only when the membership (the ids of the available instances) of the service
+///       changes, health or weight changes only refresh the local ids of the subset
+class Subsetter {
+ public:
+  void SetConfig(const naming::SubsetConfig& config, uint64_t client_id);
+
+  bool Enabled() const { return config_.enable && config_.subset_size > 0; }
+
+  uint64_t GetClientId() const { return client_id_; }
+
+  /// @brief Get the subset of the revision
+  /// @return nullptr if the subset of the revision is not built
+  InstanceSubsetPtr GetSubset(const polaris::ServiceKey& service_key, const std::string& revision) const;
+
+  /// @brief Build the subset of the revision
+  /// @param instances All the instances of the revision
+  InstanceSubsetPtr UpdateSubset(const polaris::ServiceKey& service_key, const std::string& revision,
+                                 const std::vector<polaris::Instance>& instances);
+
+  void Clear();
+
+ private:
+  struct ServiceState {
+    std::string revision;
+    // The sorted ids of the available instances
+    std::vector<std::string> members;
+    // The ids of the instances in the subset
+    std::unordered_set<std::string> subset_ids;
+    InstanceSubsetPtr subset;
+  };
+
+ private:
+  naming::SubsetConfig config_;
+  uint64_t client_id_{0};
+  mutable std::shared_mutex mutex_;
+  std::map<polaris::ServiceKey, ServiceState> services_;
+};
+
+}  // namespace trpc
@@ -0,0 +1,119 @@
+//
+//
+// Tencent is pleased to support the open source community by making tRPC available.
+//
+// Copyright (C) 2023 THL A29 Limited, a Tencent company.
+// All rights reserved.
+//
+// If you have downloaded a copy of the tRPC source code from Tencent,
+// please note that tRPC source code is licensed under the  Apache 2.0 License,
+// A copy of the Apache 2.0 License is included in this file.
+//
+//
+
+#include "trpc/naming/polarismesh/polarismesh_subsetter.h"
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace trpc {
+
+TEST(SubsetterTest, SelectSubset) {
+  // Not enough backends, all of them are selected
+  ASSERT_EQ(3, SelectSubset(3, 5, 100).size());
+  ASSERT_EQ(3, SelectSubset(3, 0, 100).size());
+
+  std::vector<std::size_t> subset = SelectSubset(100, 10, 12345);
+  ASSERT_EQ(10, subset.size());
+  // Deterministic
+  ASSERT_EQ(subset, SelectSubset(100, 10, 12345));
+}
+
+TEST(SubsetterTest, SubsetsAreBalanced) {
+  // The clients of a round cover every backend exactly once
+  std::vector<int> connections(100, 0);
+  for (uint64_t client_id = 0; client_id < 10; ++client_id) {
+    for (std::size_t index : SelectSubset(100, 10, client_id)) {
+      ++connections[index];
+    }
+  }
+  for (int count : connections) {
+    ASSERT_EQ(1, count);
+  }
+
+  // Sequential clients of several rounds are balanced
+  connections.assign(100, 0);
+  for (uint64_t client_id = 0; client_id < 50; ++client_id) {
+    for (std::size_t index : SelectSubset(100, 10, client_id)) {
+      ++connections[index];
+    }
+  }
+  for (int count : connections) {
+    ASSERT_EQ(5, count);
+  }
+}
+
+TEST(SubsetterTest, MakeSubsetClientId) {
+  ASSERT_EQ(42, MakeSubsetClientId("42"));
+  ASSERT_EQ(MakeSubsetClientId("127.0.0.1|app.server|100"), MakeSubsetClientId("127.0.0.1|app.server|100"));
+  ASSERT_NE(MakeSubsetClientId("127.0.0.1|app.server|100"), MakeSubsetClientId("127.0.0.1|app.server|101"));
+}
+
+TEST(SubsetterTest, RecomputedOnMembershipChange) {
+  naming::SubsetConfig config;
+  config.enable = true;
+  config.subset_size = 2;
+  Subsetter subsetter;
+  subsetter.SetConfig(config, 3);
+  ASSERT_TRUE(subsetter.Enabled());
+  ASSERT_EQ(3, subsetter.GetClientId());
+
+  polaris::ServiceKey service_key{"Test", "test.service"};
+  ASSERT_EQ(nullptr, subsetter.GetSubset(service_key, "rev1"));
+
+  std::vector<polaris::Instance> instances;
+  for (int i = 0; i < 6; ++i) {
+    instances.emplace_back("instance_" + std::to_string(i), "127.0.0.1", 10000 + i, 100);
+  }
+  InstanceSubsetPtr subset = subsetter.UpdateSubset(service_key, "rev1", instances);
+  ASSERT_EQ(2, subset->local_ids.size());
+  ASSERT_EQ(subset, subsetter.GetSubset(service_key, "rev1"));
+
+  std::vector<std::string> subset_ids;
+  for (const auto& instance : instances) {
+    if (subset->Contains(instance.GetLocalId())) {
+      subset_ids.push_back(instance.GetId());
+    }
+  }
+
+  // Same membership in a new revision (new local ids), the subset is kept
+  std::vector<polaris::Instance> same_members;
+  for (int i = 0; i < 6; ++i) {
+    same_members.emplace_back("instance_" + std::to_string(i), "127.0.0.1", 10000 + i, 50);
+  }
+  InstanceSubsetPtr same_subset = subsetter.UpdateSubset(service_key, "rev2", same_members);
+  ASSERT_EQ(nullptr, subsetter.GetSubset(service_key, "rev1"));
+  std::vector<std::string> same_subset_ids;
+  for (const auto& instance : same_members) {
+    if (same_subset->Contains(instance.GetLocalId())) {
+      same_subset_ids.push_back(instance.GetId());
+    }
+  }
+  ASSERT_EQ(subset_ids, same_subset_ids);
+
+  // An instance with weight 0 is not a member
+  std::vector<polaris::Instance> fewer_members;
+  for (int i = 0; i < 6; ++i) {
+    fewer_members.emplace_back("instance_" + std::to_string(i), "127.0.0.1", 10000 + i, i == 0 ? 0 : 100);
+  }
+  InstanceSubsetPtr new_subset = subsetter.UpdateSubset(service_key, "rev3", fewer_members);
+  ASSERT_EQ(2, new_subset->local_ids.size());
+  ASSERT_FALSE(new_subset->Contains(fewer_members[0].GetLocalId()));
+
+  subsetter.Clear();
+  ASSERT_EQ(nullptr, subsetter.GetSubset(service_key, "rev3"));
+}
+
+}  // namespace trpc
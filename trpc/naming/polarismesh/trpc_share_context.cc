@@ -13,16 +13,59 @@
 
 #include "trpc/naming/polarismesh/trpc_share_context.h"
 
+#include <sstream>
 #include <string>
+#include <vector>
 
 #include "polaris/context/context_impl.h"
 #include "polaris/log.h"
+#include "yaml-cpp/yaml.h"
 
 #include "trpc/naming/polarismesh/trpc_server_metric.h"
 #include "trpc/util/log/logging.h"
 
 namespace trpc {
 
+namespace {
+
+// Remove the nearby router from the chain of the service router node, the default chain is used if it is not set
+void RemoveNearbyRouterOfChain(YAML::Node service_router) {
+  std::vector<std::string> chain = trpc::naming::ServiceRouterConfig().chain;
+  if (service_router["chain"]) {
+    chain = service_router["chain"].as<std::vector<std::string>>();
+  }
+  std::vector<std::string> nearby_free_chain;
+  for (const auto& router : chain) {
+    // Named "nearbyRouter" or "nearbyBasedRouter"
+    if (router.compare(0, 6, "nearby") != 0) {
+      nearby_free_chain.push_back(router);
+    }
+  }
+  service_router["chain"] = nearby_free_chain;
+}
+
+}  // namespace
+
+std::string RemoveNearbyRouter(const std::string& selector_config) {
+  try {
+    YAML::Node node = YAML::Load(selector_config);
+    RemoveNearbyRouterOfChain(node["consumer"]["serviceRouter"]);
+    if (node["consumer"]["service"]) {
+      for (auto&& service : node["consumer"]["service"]) {
+        if (service["serviceRouter"]) {
+          RemoveNearbyRouterOfChain(service["serviceRouter"]);
+        }
+      }
+    }
+    std::stringstream strstream;
+    strstream << node;
+    return strstream.str();
+  } catch (const std::exception& ex) {
+    TRPC_FMT_ERROR("Remove the nearby router failed, error:{}", ex.what());
+    return "";
+  }
+}
+
 int TrpcShareContext::Init(const trpc::naming::PolarisMeshNamingConfig& config) {
   std::lock_guard<std::mutex> lock(mutex_);
   if (init_) {
@@ -48,6 +91,7 @@ int TrpcShareContext::Init(const trpc::naming::PolarisMeshNamingConfig& config)
     return -1;
   }
 
+  orig_selector_config_ = config.orig_selector_config;
   init_ = true;
   return 0;
 }
@@ -59,10 +103,35 @@ void TrpcShareContext::Destroy() {
     return;
   }
 
+  nearby_free_context_ = nullptr;
   polarismesh_context_ = nullptr;
   init_ = false;
 }
 
+std::shared_ptr<polaris::Context> TrpcShareContext::GetNearbyFreeContext() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!init_ || nearby_free_context_) {
+    return nearby_free_context_;
+  }
+
+  std::string selector_config = RemoveNearbyRouter(orig_selector_config_);
+  if (selector_config.empty()) {
+    return nullptr;
+  }
+  std::string err_msg;
+  std::shared_ptr<polaris::Config> polarismesh_config(polaris::Config::CreateFromString(selector_config, err_msg));
+  if (!polarismesh_config) {
+    TRPC_FMT_ERROR("Create polarismesh config without the nearby router failed, error:{}", err_msg);
+    return nullptr;
+  }
+  nearby_free_context_ = std::shared_ptr<polaris::Context>(
+      polaris::Context::Create(polarismesh_config.get(), polaris::ContextMode::kShareContext));
+  if (!nearby_free_context_) {
+    TRPC_FMT_ERROR("Create polarismesh context without the nearby router failed");
+  }
+  return nearby_free_context_;
+}
+
 polaris::ServerConnector* TrpcShareContext::GetServerConnector() {
   if (polarismesh_context_) {
     auto server_connector = polarismesh_context_->GetContextImpl()->GetServerConnector();
@@ -15,6 +15,7 @@
 
 #include <memory>
 #include <mutex>
+#include <string>
 
 #include "polaris/context.h"
 #include "polaris/plugin/server_connector/server_connector.h"
@@ -24,6 +25,10 @@
 
 namespace trpc {
 
+/// @brief Remove the nearby router from the service routing chains of the polarismesh selector config
+/// @return The config which routes by the rules, the sets and the canary only, empty if the config is invalid
+std::string RemoveNearbyRouter(const std::string& selector_config);
+
 /// @brief Maintain the shared type Polaris Context, which Context is used to create other SDK API interface objects
 class TrpcShareContext {
  public:
@@ -55,6 +60,13 @@ class TrpcShareContext {
   /// @return ServerConnector* References of the polarismesh Internal Server Connector object
   polaris::ServerConnector* GetServerConnector();
 
+  /// @brief Get the polarismesh context whose service routing skips the nearby router, which is created on the first
+  ///        call
+  /// @note The instances of the other localities are routed by the rules, the sets and the canary like the shared
+  ///       context, so that the plugin fails over or spills over to them within the routing rules
+  /// @return nullptr if it is not initialized or the creation fails
+  std::shared_ptr<polaris::Context> GetNearbyFreeContext();
+
  private:
   TrpcShareContext() = default;
 
@@ -62,6 +74,8 @@ class TrpcShareContext {
   bool init_{false};
   std::mutex mutex_;
   std::shared_ptr<polaris::Context> polarismesh_context_{nullptr};
+  std::string orig_selector_config_;
+  std::shared_ptr<polaris::Context> nearby_free_context_{nullptr};
 };
 
 }  // namespace trpc
@@ -13,7 +13,11 @@
 
 #include "trpc/naming/polarismesh/trpc_share_context.h"
 
+#include <string>
+#include <vector>
+
 #include "gtest/gtest.h"
+#include "yaml-cpp/yaml.h"
 
 #include "trpc/naming/polarismesh/config/polarismesh_naming_conf.h"
 
@@ -52,10 +56,46 @@ TEST(TrpcShareContext, InitAndDestory) {
   // After the creation is successful, neither of the Context and Server_Connector
   ASSERT_TRUE(trpc_share_context.GetPolarisContext() != nullptr);
   ASSERT_TRUE(trpc_share_context.GetServerConnector() != nullptr);
+  // The context without the nearby router is created once
+  auto nearby_free_context = trpc_share_context.GetNearbyFreeContext();
+  ASSERT_TRUE(nearby_free_context != nullptr);
+  ASSERT_TRUE(nearby_free_context != trpc_share_context.GetPolarisContext());
+  ASSERT_TRUE(nearby_free_context == trpc_share_context.GetNearbyFreeContext());
 
   // After destruction, the context you get is empty
   trpc_share_context.Destroy();
   ASSERT_TRUE(trpc_share_context.GetPolarisContext() == nullptr);
+  ASSERT_TRUE(trpc_share_context.GetNearbyFreeContext() == nullptr);
+}
+
+TEST(TrpcShareContext, RemoveNearbyRouter) {
+  ASSERT_TRUE(RemoveNearbyRouter("[,,,").empty());
+
+  // The default chain is used if it is not set
+  YAML::Node node = YAML::Load(RemoveNearbyRouter("global:\n  serverConnector:\n    protocol: grpc\n"));
+  ASSERT_EQ("grpc", node["global"]["serverConnector"]["protocol"].as<std::string>());
+  std::vector<std::string> chain = node["consumer"]["serviceRouter"]["chain"].as<std::vector<std::string>>();
+  std::vector<std::string> expected_chain{"ruleRouter", "setDivisionRouter", "canaryRouter"};
+  ASSERT_EQ(expected_chain, chain);
+
+  node = YAML::Load(RemoveNearbyRouter(
+      "consumer:\n"
+      "  serviceRouter:\n"
+      "    chain:\n"
+      "    - ruleBasedRouter\n"
+      "    - nearbyBasedRouter\n"
+      "  service:\n"
+      "  - name: test_service\n"
+      "    serviceRouter:\n"
+      "      chain:\n"
+      "      - nearbyRouter\n"
+      "      - canaryRouter\n"
+      "  - name: other_service\n"));
+  chain = node["consumer"]["serviceRouter"]["chain"].as<std::vector<std::string>>();
+  ASSERT_EQ(std::vector<std::string>{"ruleBasedRouter"}, chain);
+  chain = node["consumer"]["service"][0]["serviceRouter"]["chain"].as<std::vector<std::string>>();
+  ASSERT_EQ(std::vector<std::string>{"canaryRouter"}, chain);
+  ASSERT_FALSE(node["consumer"]["service"][1]["serviceRouter"]);
 }
 
 }  // namespace trpc